@@ -63,6 +63,14 @@ namespace Hypertable {
      */
     uint64_t get_thread_group() { return (m_event_ptr) ? m_event_ptr->thread_group : 0; }
 
+    /** Returns true if the request was sent with Header::FLAGS_BIT_BULK set,
+     * i.e. it is part of a batch job rather than a user-facing request
+     */
+    bool is_bulk() {
+      return m_event_ptr && m_event_ptr->header &&
+        (m_event_ptr->header->flags & Header::FLAGS_BIT_BULK) != 0;
+    }
+
   protected:
     EventPtr m_event_ptr;
   };
@@ -33,6 +33,7 @@
 #include "Common/HashMap.h"
 #include "Common/ReferenceCount.h"
 #include "Common/StringExt.h"
+#include "Common/Time.h"
 
 #include "ApplicationHandler.h"
 
@@ -41,36 +42,89 @@ namespace Hypertable {
   /**
    * Provides application work queue and worker threads.  It maintains a queue of requests and a pool
    * of threads that pull requests off the queue and carry them out.
+   *
+   * Requests of the same thread group are run one at a time, in order.  Only
+   * the oldest request of a group sits in the ready queue; the rest wait in
+   * the group's own FIFO until it completes, so a worker can always take the
+   * front of the ready queue without looking at what else is queued.
+   *
+   * There is a ready queue for interactive requests and one for bulk
+   * requests (see ApplicationHandler#is_bulk).  While both have work, workers
+   * take interactive_weight interactive requests for each bulk request.
    */
   class ApplicationQueue : public ReferenceCount {
 
-    class UsageRec {
+    class WorkRec;
+
+    class GroupRec {
     public:
-      UsageRec() : thread_group(0), running(false), outstanding(1) { return; }
-      uint64_t thread_group;
-      bool     running;
-      int      outstanding;
+      GroupRec(uint64_t group) : thread_group(group), busy(false) { return; }
+      uint64_t             thread_group;
+      /** true while one of the group's requests is ready or running */
+      bool                 busy;
+      std::list<WorkRec *> pending;
     };
 
-    typedef hash_map<uint64_t, UsageRec *> UsageRecMap;
+    typedef hash_map<uint64_t, GroupRec *> GroupRecMap;
 
     class WorkRec {
     public:
-      WorkRec(ApplicationHandler *ah) : handler(ah), usage(0) { return; }
+      WorkRec(ApplicationHandler *ah) : handler(ah), group(0), enqueue_time(0), priority_class(INTERACTIVE) { return; }
       ~WorkRec() { delete handler; }
       ApplicationHandler   *handler;
-      UsageRec             *usage;
+      GroupRec             *group;
+      uint64_t              enqueue_time;
+      int                   priority_class;
+    };
+
+  public:
+
+    enum { INTERACTIVE = 0, BULK = 1, PRIORITY_CLASSES = 2 };
+
+    /**
+     * Queue statistics for one priority class.  Wait times are in
+     * nanoseconds, measured from when a request is added until a worker
+     * picks it up.
+     */
+    struct Stats {
+      Stats() : depth(0), dequeued(0), total_wait(0), max_wait(0) { return; }
+      size_t   depth;
+      uint64_t dequeued;
+      uint64_t total_wait;
+      uint64_t max_wait;
     };
 
+  private:
+
     class ApplicationQueueState {
     public:
-      ApplicationQueueState() : queue(), usage_map(), queue_mutex(), usage_mutex(), cond(), shutdown(false) { return; }
-      std::list<WorkRec *> queue;
-      UsageRecMap         usage_map;
+      ApplicationQueueState() : group_map(), queue_mutex(), cond(), shutdown(false),
+        interactive_weight(4), interactive_run(0) { return; }
+      std::list<WorkRec *> ready[PRIORITY_CLASSES];
+      GroupRecMap         group_map;
       boost::mutex        queue_mutex;
-      boost::mutex        usage_mutex;
       boost::condition    cond;
       bool                shutdown;
+      int                 interactive_weight;
+      int                 interactive_run;
+      Stats               stats[PRIORITY_CLASSES];
+
+      bool ready_empty() { return ready[INTERACTIVE].empty() && ready[BULK].empty(); }
+
+      /**
+       * Picks the class to dequeue from.  Interactive requests go first
+       * unless interactive_weight of them in a row have been taken while
+       * bulk requests were waiting.
+       */
+      int next_class() {
+        if (!ready[INTERACTIVE].empty() &&
+            (ready[BULK].empty() || interactive_run < interactive_weight)) {
+          interactive_run++;
+          return INTERACTIVE;
+        }
+        interactive_run = 0;
+        return BULK;
+      }
     };
 
     class Worker {
@@ -83,55 +137,48 @@ namespace Hypertable {
 
       void operator()() {
         WorkRec *rec = 0;
-        std::list<WorkRec *>::iterator iter;
+        uint64_t wait;
 
         while (true) {
 
-          {  // !!! maybe ditch this block specifier
+          {
             boost::mutex::scoped_lock lock(m_state.queue_mutex);
 
-            while (m_state.queue.empty()) {
+            while (m_state.ready_empty()) {
               if (m_state.shutdown)
                 return;
               m_state.cond.wait(lock);
             }
 
-            {
-              boost::mutex::scoped_lock ulock(m_state.usage_mutex);
-
-              for (iter = m_state.queue.begin(); iter != m_state.queue.end(); iter++) {
-                rec = (*iter);
-                if (rec->usage == 0 || !rec->usage->running) {
-                  if (rec->usage)
-                    rec->usage->running = true;
-                  m_state.queue.erase(iter);
-                  break;
-                }
-                rec = 0;
-              }
-            }
-	    if (rec == 0) {
-	      if (m_state.shutdown)
-		return;
-	      m_state.cond.wait(lock);
-	      if (m_state.shutdown)
-		return;
-	    }
+            int pc = m_state.next_class();
+            Stats &stats = m_state.stats[pc];
+            rec = m_state.ready[pc].front();
+            m_state.ready[pc].pop_front();
+            stats.depth--;
+            stats.dequeued++;
+            wait = get_ts64() - rec->enqueue_time;
+            stats.total_wait += wait;
+            if (wait > stats.max_wait)
+              stats.max_wait = wait;
           }
 
-          if (rec) {
-            rec->handler->run();
-            if (rec->usage) {
-              boost::mutex::scoped_lock ulock(m_state.usage_mutex);
-              rec->usage->running = false;
-              rec->usage->outstanding--;
-              if (rec->usage->outstanding == 0) {
-                m_state.usage_map.erase(rec->usage->thread_group);
-                delete rec->usage;
-              }
+          rec->handler->run();
+
+          if (rec->group) {
+            boost::mutex::scoped_lock lock(m_state.queue_mutex);
+            GroupRec *group = rec->group;
+            if (!group->pending.empty()) {
+              WorkRec *next = group->pending.front();
+              m_state.ready[next->priority_class].push_back(next);
+              group->pending.pop_front();
+              m_state.cond.notify_one();
+            }
+            else {
+              m_state.group_map.erase(group->thread_group);
+              delete group;
             }
-            delete rec;
           }
+          delete rec;
         }
 
         HT_INFO("thread exit");
@@ -175,6 +222,7 @@ namespace Hypertable {
      * of the shutdown.
      */
     void shutdown() {
+      boost::mutex::scoped_lock lock(m_state.queue_mutex);
       m_state.shutdown = true;
       m_state.cond.notify_all();
     }
@@ -198,29 +246,61 @@ namespace Hypertable {
      * group ID is constructed in the Event object
      */
     void add(ApplicationHandler *app_handler) {
-      UsageRecMap::iterator uiter;
+      GroupRecMap::iterator giter;
       uint64_t thread_group = app_handler->get_thread_group();
       WorkRec *rec = new WorkRec(app_handler);
-      rec->usage = 0;
+
+      rec->enqueue_time = get_ts64();
+      if (app_handler->is_bulk())
+        rec->priority_class = BULK;
+
+      boost::mutex::scoped_lock lock(m_state.queue_mutex);
+
+      m_state.stats[rec->priority_class].depth++;
 
       if (thread_group != 0) {
-        boost::mutex::scoped_lock ulock(m_state.usage_mutex);
-        if ((uiter = m_state.usage_map.find(thread_group)) != m_state.usage_map.end()) {
-          rec->usage = (*uiter).second;
-          rec->usage->outstanding++;
-        }
+        if ((giter = m_state.group_map.find(thread_group)) != m_state.group_map.end())
+          rec->group = (*giter).second;
         else {
-          rec->usage = new UsageRec();
-          rec->usage->thread_group = thread_group;
-          m_state.usage_map[thread_group] = rec->usage;
+          rec->group = new GroupRec(thread_group);
+          m_state.group_map[thread_group] = rec->group;
+        }
+        if (rec->group->busy) {
+          rec->group->pending.push_back(rec);
+          return;
         }
+        rec->group->busy = true;
       }
 
-      {
-        boost::mutex::scoped_lock lock(m_state.queue_mutex);
-        m_state.queue.push_back(rec);
-        m_state.cond.notify_one();
-      }
+      m_state.ready[rec->priority_class].push_back(rec);
+      m_state.cond.notify_one();
+    }
+
+    /**
+     * Sets how many interactive requests are run for each bulk request
+     * while both kinds are waiting
+     *
+     * @param weight interactive requests per bulk request (at least 1)
+     */
+    void set_interactive_weight(int weight) {
+      boost::mutex::scoped_lock lock(m_state.queue_mutex);
+      m_state.interactive_weight = (weight > 0) ? weight : 1;
+    }
+
+    /**
+     * Gets the number of queued requests and the wait time statistics of a
+     * priority class
+     *
+     * @param priority_class INTERACTIVE or BULK
+     * @param stats filled in with the statistics
+     * @param reset if true, clears the counters after reading them
+     */
+    void get_stats(int priority_class, Stats &stats, bool reset=false) {
+      boost::mutex::scoped_lock lock(m_state.queue_mutex);
+      Stats &cs = m_state.stats[priority_class];
+      stats = cs;
+      if (reset)
+        cs.dequeued = cs.total_wait = cs.max_wait = 0;
     }
   };
   typedef boost::intrusive_ptr<ApplicationQueue> ApplicationQueuePtr;
@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include "BufferPool.h"
+
+using namespace Hypertable;
+
+
+BufferPool::BufferPool() : m_free_bytes(0), m_next_trim(0) {
+  for (int i=0; i<CLASS_COUNT; i++) {
+    m_free[i].reserve(CLASS_BYTES >> (MIN_CLASS_BITS + i));
+    m_unused[i] = 0;
+  }
+}
+
+
+BufferPool::~BufferPool() {
+  for (int i=0; i<CLASS_COUNT; i++) {
+    for (size_t j=0; j<m_free[i].size(); j++)
+      delete [] m_free[i][j];
+  }
+}
+
+
+uint8_t *BufferPool::allocate(size_t len) {
+  int sc = size_class(len);
+
+  if (sc < 0)
+    return new uint8_t [len];
+
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!m_free[sc].empty()) {
+      uint8_t *buf = m_free[sc].back();
+      m_free[sc].pop_back();
+      m_free_bytes -= (size_t)1 << (MIN_CLASS_BITS + sc);
+      if (m_unused[sc] > m_free[sc].size())
+        m_unused[sc] = m_free[sc].size();
+      return buf;
+    }
+  }
+  return new uint8_t [(size_t)1 << (MIN_CLASS_BITS + sc)];
+}
+
+
+void BufferPool::release(uint8_t *buf, size_t len) {
+  int sc = size_class(len);
+
+  if (sc >= 0) {
+    size_t buf_size = (size_t)1 << (MIN_CLASS_BITS + sc);
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_free[sc].size() < (CLASS_BYTES >> (MIN_CLASS_BITS + sc)) &&
+        m_free_bytes + buf_size <= POOL_BYTES) {
+      m_free[sc].push_back(buf);
+      m_free_bytes += buf_size;
+      return;
+    }
+  }
+  delete [] buf;
+}
+
+
+/**
+ * m_unused[i] is the smallest length free list i has had since the last
+ * trim, i.e. the number of its buffers nobody asked for in that time
+ */
+void BufferPool::trim(time_t now) {
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  if (now < m_next_trim)
+    return;
+
+  for (int i=0; i<CLASS_COUNT; i++) {
+    for (; m_unused[i] > 0; m_unused[i]--) {
+      delete [] m_free[i].back();
+      m_free[i].pop_back();
+      m_free_bytes -= (size_t)1 << (MIN_CLASS_BITS + i);
+    }
+    m_unused[i] = m_free[i].size();
+  }
+  m_next_trim = now + TRIM_SECONDS;
+}
+
+
+/**
+ * Returns the index of the smallest class that holds len bytes, or -1 if
+ * len is bigger than the largest class
+ */
+int BufferPool::size_class(size_t len) {
+  int sc = 0;
+  while (len > ((size_t)1 << (MIN_CLASS_BITS + sc))) {
+    if (++sc == CLASS_COUNT)
+      return -1;
+  }
+  return sc;
+}
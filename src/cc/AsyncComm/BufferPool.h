@@ -0,0 +1,81 @@
+/** -*- C++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_BUFFERPOOL_H
+#define HYPERTABLE_BUFFERPOOL_H
+
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "Common/ReferenceCount.h"
+
+namespace Hypertable {
+
+  /**
+   * Pool of message receive buffers, kept in power-of-two size classes from
+   * 2^MIN_CLASS_BITS to 2^MAX_CLASS_BITS bytes.  Each reactor has one; the
+   * buffers are filled by the reactor thread and released by whichever
+   * thread drops the last reference to the Event, so the pool is locked.
+   * Each class keeps at most CLASS_BYTES worth of free buffers, the whole
+   * pool at most POOL_BYTES, and larger buffers are not pooled at all.
+   * Buffers that stay unused for TRIM_SECONDS are freed by trim().
+   */
+  class BufferPool : public ReferenceCount {
+  public:
+    enum { MIN_CLASS_BITS = 10, MAX_CLASS_BITS = 23, CLASS_BYTES = 8388608,
+           POOL_BYTES = 16777216, TRIM_SECONDS = 60,
+           CLASS_COUNT = MAX_CLASS_BITS - MIN_CLASS_BITS + 1 };
+
+    BufferPool();
+    ~BufferPool();
+
+    /**
+     * Returns a buffer of at least len bytes.  It must be given back with
+     * release() and the same len.
+     */
+    uint8_t *allocate(size_t len);
+
+    void release(uint8_t *buf, size_t len);
+
+    /**
+     * Frees the buffers that have not been needed since the previous trim.
+     * Cheap to call often; it does nothing until TRIM_SECONDS have passed.
+     *
+     * @param now current time in seconds
+     */
+    void trim(time_t now);
+
+  private:
+    static int size_class(size_t len);
+
+    boost::mutex          m_mutex;
+    std::vector<uint8_t *> m_free[CLASS_COUNT];
+    size_t                m_unused[CLASS_COUNT];
+    size_t                m_free_bytes;
+    time_t                m_next_trim;
+  };
+
+  typedef boost::intrusive_ptr<BufferPool> BufferPoolPtr;
+
+}
+
+#endif // HYPERTABLE_BUFFERPOOL_H
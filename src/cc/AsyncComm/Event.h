@@ -31,6 +31,7 @@ extern "C" {
 #include "Common/String.h"
 #include "Common/ReferenceCount.h"
 
+#include "BufferPool.h"
 #include "Header.h"
 
 namespace Hypertable {
@@ -59,10 +60,13 @@ namespace Hypertable {
      * @param err error code associated with this event
      * @param h pointer to message data for MESSAGE events (<b>NOTE:</b> this object
      * takes ownership of this data and deallocates it when it gets destroyed)
+     * @param pool pool the message data was allocated from, if any; the data
+     * goes back to it when this object gets destroyed
      */
     Event(Type ct, int cid, struct sockaddr_in &a, int err=0,
-          Header::Common *h=0)
-      : type(ct), addr(a), conn_id(cid), error(err), header(h) {
+          Header::Common *h=0, BufferPool *pool=0)
+      : type(ct), addr(a), conn_id(cid), error(err), header(h),
+        buffer_pool(pool) {
       if (h != 0) {
         message = ((uint8_t *)header) + header->header_len;
         message_len = header->total_len - header->header_len;
@@ -91,10 +95,14 @@ namespace Hypertable {
       conn_id = 0;
     }
 
-    /** Destroys event.  Deallocates message data
+    /** Destroys event.  Deallocates message data or returns it to the
+     * buffer pool it came from
      */
     ~Event() {
-      delete [] header;
+      if (buffer_pool && header)
+        buffer_pool->release((uint8_t *)header, header->total_len);
+      else
+        delete [] header;
     }
 
     /** Type of event.  Can take one of values CONNECTION_ESTABLISHED,
@@ -135,6 +143,9 @@ namespace Hypertable {
      */
     uint64_t thread_group;
 
+    /** Pool that owns the message data, or 0 if it was allocated with new */
+    BufferPoolPtr buffer_pool;
+
     /** Generates a one-line string representation of the event.  For example:
      * <pre>
      *   Event: type=MESSAGE protocol=hyperspace id=2 gid=0 header_len=16 total_len=20 from=127.0.0.1:38040
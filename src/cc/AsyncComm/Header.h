@@ -39,9 +39,15 @@ namespace Hypertable {
 
     static const uint8_t FLAGS_BIT_REQUEST          = 0x01;
     static const uint8_t FLAGS_BIT_IGNORE_RESPONSE  = 0x02;
+    static const uint8_t FLAGS_BIT_BULK             = 0x04;
+    static const uint8_t FLAGS_BIT_COMPRESSED       = 0x08;
+    static const uint8_t FLAGS_BIT_ACCEPTS_COMPRESSED = 0x10;
 
     static const uint8_t FLAGS_MASK_REQUEST         = 0xFE;
     static const uint8_t FLAGS_MASK_IGNORE_RESPONSE = 0xFD;
+    static const uint8_t FLAGS_MASK_BULK            = 0xFB;
+    static const uint8_t FLAGS_MASK_COMPRESSED      = 0xF7;
+    static const uint8_t FLAGS_MASK_ACCEPTS_COMPRESSED = 0xEF;
 
     static const char *protocol_strs[PROTOCOL_MAX];
 
@@ -86,9 +86,14 @@ namespace Hypertable {
      */
     void encode(uint8_t **bufp);
 
-    /** Sets the flags member of the header builder.  Currently this is only
-     * used internally by the Comm layer and the 0th bit is a flag that
-     * indicates whether the message is a request or a response.
+    /** Sets the flags member of the header builder.  The 0th bit is a flag
+     * that indicates whether the message is a request or a response and is
+     * set by the Comm layer.  FLAGS_BIT_BULK marks a request as bulk work
+     * that a server's ApplicationQueue may run behind interactive requests.
+     * FLAGS_BIT_COMPRESSED marks a request whose variable-length payload is
+     * a compressed block (see RangeServerProtocol::create_request_update).
+     * FLAGS_BIT_ACCEPTS_COMPRESSED is set on update responses by servers
+     * that take compressed update payloads.
      *
      * @param flags new set of flags
      */
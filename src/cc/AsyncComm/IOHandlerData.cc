@@ -142,7 +142,7 @@ bool IOHandlerData::handle_event(struct epoll_event *event) {
         else {
           m_got_header = true;
           m_message_header_remaining = 0;
-          m_message = new uint8_t [m_message_header.total_len];
+          m_message = m_reactor_ptr->get_buffer_pool()->allocate(m_message_header.total_len);
           memcpy(m_message, &m_message_header, sizeof(Header::Common));
           m_message_ptr = m_message + sizeof(Header::Common);
           m_message_remaining = (m_message_header.total_len) - sizeof(Header::Common);
@@ -176,10 +176,10 @@ bool IOHandlerData::handle_event(struct epoll_event *event) {
               HT_WARNF("Received response for non-pending event (id=%d,version=%d,total_len=%d)",
                           id, ((Header::Common *)m_message)->version, ((Header::Common *)m_message)->total_len);
             }
-            delete [] m_message;
+            m_reactor_ptr->get_buffer_pool()->release(m_message, m_message_header.total_len);
           }
           else
-            deliver_event(new Event(Event::MESSAGE, m_id, m_addr, Error::OK, (Header::Common *)m_message), dh);
+            deliver_event(new Event(Event::MESSAGE, m_id, m_addr, Error::OK, (Header::Common *)m_message, m_reactor_ptr->get_buffer_pool()), dh);
           reset_incoming_message_state();
         }
 	if (eof)
@@ -267,7 +267,7 @@ bool IOHandlerData::handle_event(struct kevent *event) {
           m_got_header = true;
           available -= nread;
           m_message_header_remaining = 0;
-          m_message = new uint8_t [m_message_header.total_len];
+          m_message = m_reactor_ptr->get_buffer_pool()->allocate(m_message_header.total_len);
           memcpy(m_message, &m_message_header, sizeof(Header::Common));
           m_message_ptr = m_message + sizeof(Header::Common);
           m_message_remaining = (m_message_header.total_len) - sizeof(Header::Common);
@@ -304,10 +304,10 @@ bool IOHandlerData::handle_event(struct kevent *event) {
             if ((((Header::Common *)m_message)->flags & Header::FLAGS_BIT_IGNORE_RESPONSE) == 0) {
               HT_WARNF("Received response for non-pending event (id=%d)", id);
             }
-            delete [] m_message;
+            m_reactor_ptr->get_buffer_pool()->release(m_message, m_message_header.total_len);
           }
           else
-            deliver_event(new Event(Event::MESSAGE, m_id, m_addr, Error::OK, (Header::Common *)m_message), dh);
+            deliver_event(new Event(Event::MESSAGE, m_id, m_addr, Error::OK, (Header::Common *)m_message, m_reactor_ptr->get_buffer_pool()), dh);
           reset_incoming_message_state();
         }
         else {
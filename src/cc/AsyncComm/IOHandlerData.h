@@ -52,6 +52,11 @@ namespace Hypertable {
       m_id = atomic_inc_return(&ms_next_connection_id);
     }
 
+    virtual ~IOHandlerData() {
+      if (m_message)
+        m_reactor_ptr->get_buffer_pool()->release(m_message, m_message_header.total_len);
+    }
+
     void reset_incoming_message_state() {
       m_got_header = false;
       m_message_header_remaining = sizeof(Header::Common);
@@ -56,7 +56,7 @@ const int Reactor::WRITE_READY  = 0x02;
 /**
  *
  */
-Reactor::Reactor() : m_mutex(), m_interrupt_in_progress(false) {
+Reactor::Reactor() : m_mutex(), m_interrupt_in_progress(false), m_buffer_pool(new BufferPool()) {
   struct sockaddr_in addr;
 
 #if defined(__linux__)
@@ -182,6 +182,8 @@ void Reactor::handle_timeouts(PollTimeout &next_timeout) {
       expired_timers[i].handler->handle(event_ptr);
   }
 
+  m_buffer_pool->trim(now.sec);
+
   {
     boost::mutex::scoped_lock lock(m_mutex);
 
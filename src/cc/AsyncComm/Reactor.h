@@ -29,6 +29,7 @@
 
 #include "Common/ReferenceCount.h"
 
+#include "BufferPool.h"
 #include "PollTimeout.h"
 #include "RequestCache.h"
 #include "ExpireTimer.h"
@@ -89,6 +90,11 @@ namespace Hypertable {
 
     void handle_timeouts(PollTimeout &next_timeout);
 
+    /**
+     * Returns the pool that incoming messages on this reactor are read into
+     */
+    BufferPool *get_buffer_pool() { return m_buffer_pool.get(); }
+
 #if defined(__linux__)
     int poll_fd;
 #elif defined (__APPLE__)
@@ -106,6 +112,7 @@ namespace Hypertable {
     bool            m_interrupt_in_progress;
     boost::xtime    m_next_wakeup;
     std::set<IOHandler *> m_removed_handlers;
+    BufferPoolPtr   m_buffer_pool;
   };
   typedef boost::intrusive_ptr<Reactor> ReactorPtr;
 
@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cmath>
+#include <cstdio>
+
+#include "key_generator.h"
+
+using namespace Hypertable;
+
+
+KeyGenerator::KeyGenerator(Distribution dist, uint64_t key_space,
+                           uint32_t seed)
+  : m_dist(dist), m_key_space(key_space ? key_space : 1), m_sequence(0),
+    m_rand(seed ? seed : 1), m_theta(0.99), m_alpha(0.0), m_zetan(0.0),
+    m_eta(0.0) {
+
+  if (m_dist == ZIPFIAN) {
+    double zeta2 = zeta(2, m_theta);
+    m_zetan = zeta(m_key_space, m_theta);
+    m_alpha = 1.0 / (1.0 - m_theta);
+    m_eta = (1.0 - pow(2.0 / m_key_space, 1.0 - m_theta))
+        / (1.0 - zeta2 / m_zetan);
+  }
+}
+
+
+uint32_t KeyGenerator::random32() {
+  // xorshift64*
+  m_rand ^= m_rand >> 12;
+  m_rand ^= m_rand << 25;
+  m_rand ^= m_rand >> 27;
+  return (uint32_t)((m_rand * 2685821657736338717ULL) >> 32);
+}
+
+
+uint64_t KeyGenerator::next() {
+
+  if (m_dist == SEQUENTIAL)
+    return m_sequence++ % m_key_space;
+
+  if (m_dist == UNIFORM)
+    return ((((uint64_t)random32()) << 32) | random32()) % m_key_space;
+
+  /**
+   * Gray et al, "Quickly Generating Billion-Record Synthetic Databases".
+   * The rank is hashed so that the hot rows aren't all adjacent.
+   */
+  double u = random_double();
+  double uz = u * m_zetan;
+  uint64_t rank;
+
+  if (uz < 1.0)
+    rank = 0;
+  else if (uz < 1.0 + pow(0.5, m_theta))
+    rank = 1;
+  else
+    rank = (uint64_t)(m_key_space * pow(m_eta * u - m_eta + 1.0, m_alpha));
+
+  if (rank >= m_key_space)
+    rank = m_key_space - 1;
+
+  // FNV-1a over the rank bytes
+  uint64_t hash = 14695981039346656037ULL;
+  for (int i=0; i<8; i++) {
+    hash ^= (rank >> (i*8)) & 0xff;
+    hash *= 1099511628211ULL;
+  }
+  return hash % m_key_space;
+}
+
+
+void KeyGenerator::next_row(char *buf) {
+  sprintf(buf, "%020llu", (Llu)next());
+}
+
+
+double KeyGenerator::zeta(uint64_t n, double theta) {
+  double sum = 0.0;
+  for (uint64_t i=1; i<=n; i++)
+    sum += 1.0 / pow((double)i, theta);
+  return sum;
+}
+
+
+bool KeyGenerator::parse_distribution(const String &name, Distribution *distp) {
+  if (name == "sequential")
+    *distp = SEQUENTIAL;
+  else if (name == "uniform")
+    *distp = UNIFORM;
+  else if (name == "zipfian")
+    *distp = ZIPFIAN;
+  else
+    return false;
+  return true;
+}
+
+
+const char *KeyGenerator::distribution_name(Distribution dist) {
+  switch (dist) {
+  case SEQUENTIAL: return "sequential";
+  case UNIFORM:    return "uniform";
+  case ZIPFIAN:    return "zipfian";
+  }
+  return "unknown";
+}
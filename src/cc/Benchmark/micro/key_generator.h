@@ -0,0 +1,79 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_KEYGENERATOR_H
+#define HYPERTABLE_KEYGENERATOR_H
+
+#include <vector>
+
+#include "Common/String.h"
+
+namespace Hypertable {
+
+  /**
+   * Generates synthetic row keys for the micro benchmarks.  Rows are drawn
+   * from a key space of a fixed size, either in order, uniformly at
+   * random, or from a zipfian distribution (theta 0.99, the YCSB default)
+   * whose popular rows are scattered over the key space rather than
+   * clustered at the start of it.
+   */
+  class KeyGenerator {
+  public:
+    enum Distribution { SEQUENTIAL, UNIFORM, ZIPFIAN };
+
+    KeyGenerator(Distribution dist, uint64_t key_space, uint32_t seed);
+
+    /**
+     * Returns the index of the next row in [0, key_space)
+     */
+    uint64_t next();
+
+    /**
+     * Writes the next row key into buf as a fixed width, zero padded
+     * decimal string
+     *
+     * @param buf buffer of at least 21 bytes
+     */
+    void next_row(char *buf);
+
+    uint32_t random32();
+
+    static bool parse_distribution(const String &name, Distribution *distp);
+    static const char *distribution_name(Distribution dist);
+
+  private:
+    double zeta(uint64_t n, double theta);
+    double random_double() { return (double)random32() / 4294967296.0; }
+
+    Distribution m_dist;
+    uint64_t m_key_space;
+    uint64_t m_sequence;
+    uint64_t m_rand;
+    double   m_theta;
+    double   m_alpha;
+    double   m_zetan;
+    double   m_eta;
+  };
+
+}
+
+#endif // HYPERTABLE_KEYGENERATOR_H
@@ -0,0 +1,643 @@
+/**
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+extern "C" {
+#include <time.h>
+}
+
+#include <boost/algorithm/string.hpp>
+
+#include "AsyncComm/ConnectionManager.h"
+#include "AsyncComm/ReactorFactory.h"
+
+#include "Common/ByteString.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Properties.h"
+#include "Common/String.h"
+#include "Common/System.h"
+#include "Common/Usage.h"
+
+#include "DfsBroker/Lib/Client.h"
+
+#include "Hypertable/Lib/BlockCompressionCodec.h"
+#include "Hypertable/Lib/BlockCompressionHeader.h"
+#include "Hypertable/Lib/CompressorFactory.h"
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/Timestamp.h"
+
+#include "Hypertable/RangeServer/CellCache.h"
+#include "Hypertable/RangeServer/CellStoreV0.h"
+#include "Hypertable/RangeServer/FileBlockCache.h"
+#include "Hypertable/RangeServer/Global.h"
+#include "Hypertable/RangeServer/MergeScanner.h"
+#include "Hypertable/RangeServer/ScanContext.h"
+
+#include "key_generator.h"
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  const char *usage[] = {
+    "usage: micro_benchmark [options]",
+    "",
+    "  options:",
+    "    --benchmarks=<list>     Comma separated list of benchmarks to run, out of",
+    "                            key, cellcache, mergescanner, cellstore, blockcache",
+    "                            and codec (default: all)",
+    "    --distributions=<list>  Comma separated list of key distributions, out of",
+    "                            sequential, uniform and zipfian (default: all)",
+    "    --count=<n>             Number of cells per benchmark (default: 200000)",
+    "    --value-size=<n>        Size of each value in bytes (default: 100)",
+    "    --compressor=<type>     CellStore compressor (default: lzo)",
+    "    --merge-ways=<list>     Comma separated list of source counts for the",
+    "                            mergescanner benchmark (default: 4,16)",
+    "    --config=<file>         Read config properties from <file>",
+    "    --dir=<dir>             DFS directory for CellStore files",
+    "                            (default: /micro_benchmark)",
+    "    --output=<file>         Write results to <file> (default: stdout)",
+    "    --seed=<n>              Random number generator seed (default: 1)",
+    "",
+    "  Runs the RangeServer data structures in isolation against synthetic",
+    "  keys and reports one tab separated line per benchmark with the op count,",
+    "  ops/s, bytes/s and per-op latency percentiles in nanoseconds.  The",
+    "  cellstore benchmark reads and writes through the DFS broker configured",
+    "  in the config file, which should be the local broker.",
+    "",
+    (const char *)0
+  };
+
+  const char *DEFAULT_BENCHMARKS = "key,cellcache,mergescanner,cellstore,blockcache,codec";
+  const char *DEFAULT_DISTRIBUTIONS = "sequential,uniform,zipfian";
+  const char *DEFAULT_MERGE_WAYS = "4,16";
+  const char *CODECS[] = { "none", "zlib", "lzo", "quicklz", "bmz", 0 };
+  const char CODEC_MAGIC[10] = { '-','-','-','-','-','-','-','-','-','-' };
+
+  enum {
+    BATCH_SIZE = 32,
+    VALUE_POOL_SIZE = 64,
+    CELLSTORE_BLOCKSIZE = 65536,
+    CODEC_BLOCKSIZE = 65536,
+    CACHE_BLOCK_SIZE = 65536,
+    CACHE_BLOCKS = 1024,          // 64MB cache ...
+    CACHE_KEY_SPACE = 2048        // ... over a 128MB working set
+  };
+
+  /**
+   * Accumulates timings for one benchmark.  Timing every call to something
+   * as small as Key::load would mostly measure the clock, so ops are timed
+   * in batches and each batch contributes its mean per-op latency as one
+   * sample.  Time outside of batches (setup, verification) isn't counted.
+   */
+  class Recorder {
+  public:
+    Recorder() : m_ops(0), m_bytes(0), m_elapsed_ns(0) { }
+
+    void start() { clock_gettime(CLOCK_MONOTONIC, &m_start); }
+
+    void stop(size_t ops, size_t bytes) {
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      uint64_t ns = (uint64_t)(now.tv_sec - m_start.tv_sec) * 1000000000ULL
+          + now.tv_nsec - m_start.tv_nsec;
+      m_elapsed_ns += ns;
+      m_ops += ops;
+      m_bytes += bytes;
+      if (ops)
+        m_samples.push_back(ns / ops);
+    }
+
+    void report(FILE *out, const char *benchmark, const char *dist,
+                const String &extra = "") {
+      double secs = (double)m_elapsed_ns / 1000000000.0;
+      std::sort(m_samples.begin(), m_samples.end());
+      fprintf(out, "%s\t%s\t%llu\t%.6f\t%.1f\t%.1f\t%llu\t%llu\t%llu\t%llu\t%llu\t%s\n",
+              benchmark, dist, (Llu)m_ops, secs,
+              secs > 0.0 ? (double)m_ops / secs : 0.0,
+              secs > 0.0 ? (double)m_bytes / secs : 0.0,
+              (Llu)percentile(0.50), (Llu)percentile(0.90),
+              (Llu)percentile(0.99), (Llu)percentile(0.999),
+              (Llu)(m_samples.empty() ? 0 : m_samples.back()),
+              extra.empty() ? "-" : extra.c_str());
+      fflush(out);
+    }
+
+  private:
+    uint64_t percentile(double p) {
+      if (m_samples.empty())
+        return 0;
+      size_t i = (size_t)(p * (m_samples.size() - 1) + 0.5);
+      return m_samples[i];
+    }
+
+    struct timespec m_start;
+    uint64_t m_ops;
+    uint64_t m_bytes;
+    uint64_t m_elapsed_ns;
+    std::vector<uint64_t> m_samples;
+  };
+
+  /**
+   * Synthetic cells, in generation order.  Every key gets a distinct
+   * timestamp, so keys are unique even when the distribution repeats rows.
+   */
+  struct CellSet {
+    CellSet() : key_buf(0), value_buf(0) { }
+    DynamicBuffer key_buf;
+    DynamicBuffer value_buf;
+    std::vector<ByteString> keys;
+    std::vector<ByteString> values;
+    std::vector<const char *> rows;
+  };
+
+  void
+  generate_cells(KeyGenerator &gen, size_t count, size_t value_size,
+                 CellSet &cells) {
+    std::vector<size_t> key_offsets, value_offsets;
+    char row[32];
+    String value;
+    Key key;
+
+    key_offsets.reserve(count);
+    for (size_t i=0; i<count; i++) {
+      gen.next_row(row);
+      key_offsets.push_back(cells.key_buf.fill());
+      create_key_and_append(cells.key_buf, FLAG_INSERT, row, 1, "qualifier",
+                            (int64_t)(i + 1));
+    }
+
+    for (size_t i=0; i<VALUE_POOL_SIZE; i++) {
+      value.clear();
+      for (size_t j=0; j<value_size; j++)
+        value += (char)(' ' + (gen.random32() % 95));
+      value_offsets.push_back(cells.value_buf.fill());
+      append_as_byte_string(cells.value_buf, value.data(), value.length());
+    }
+
+    // the buffers have stopped growing, so pointers into them are stable
+    for (size_t i=0; i<count; i++) {
+      cells.keys.push_back(ByteString(cells.key_buf.base + key_offsets[i]));
+      cells.values.push_back(ByteString(cells.value_buf.base
+          + value_offsets[i % VALUE_POOL_SIZE]));
+      key.load(cells.keys.back());
+      cells.rows.push_back(key.row);
+    }
+  }
+
+  struct LtCell {
+    LtCell(CellSet &cells) : m_cells(cells) { }
+    bool operator()(size_t a, size_t b) const {
+      return m_cells.keys[a] < m_cells.keys[b];
+    }
+    CellSet &m_cells;
+  };
+
+  size_t cell_length(const ByteString &key, const ByteString &value) {
+    return key.length() + value.length();
+  }
+
+  /**
+   * Drains a scanner, timing it in batches
+   */
+  size_t scan_all(CellListScanner *scanner, Recorder &rec) {
+    ByteString key, value;
+    size_t count = 0;
+    bool more = true;
+
+    while (more) {
+      size_t ops = 0, bytes = 0;
+      rec.start();
+      while (ops < BATCH_SIZE && (more = scanner->get(key, value))) {
+        bytes += cell_length(key, value);
+        scanner->forward();
+        ops++;
+      }
+      rec.stop(ops, bytes);
+      count += ops;
+    }
+    return count;
+  }
+
+  void check_count(const char *benchmark, size_t expected, size_t actual) {
+    if (expected != actual)
+      HT_THROWF(Error::FAILED_EXPECTATION, "%s returned %llu cells, expected "
+                "%llu", benchmark, (Llu)actual, (Llu)expected);
+  }
+
+
+  void bench_key(CellSet &cells, const char *dist, FILE *out) {
+    Recorder create_rec, load_rec;
+    DynamicBuffer buf(BATCH_SIZE * 64);
+    size_t count = cells.keys.size();
+    uint64_t checksum = 0;
+    Key key;
+
+    for (size_t i=0; i<count; i+=BATCH_SIZE) {
+      size_t n = std::min((size_t)BATCH_SIZE, count - i);
+      buf.clear();
+      create_rec.start();
+      for (size_t j=i; j<i+n; j++)
+        create_key_and_append(buf, FLAG_INSERT, cells.rows[j], 1, "qualifier",
+                              (int64_t)(j + 1));
+      create_rec.stop(n, buf.fill());
+    }
+
+    for (size_t i=0; i<count; i+=BATCH_SIZE) {
+      size_t n = std::min((size_t)BATCH_SIZE, count - i);
+      size_t bytes = 0;
+      load_rec.start();
+      for (size_t j=i; j<i+n; j++) {
+        key.load(cells.keys[j]);
+        checksum += key.timestamp;
+        bytes += cells.keys[j].length();
+      }
+      load_rec.stop(n, bytes);
+    }
+
+    if (checksum != (uint64_t)count * (count + 1) / 2)
+      HT_THROW(Error::FAILED_EXPECTATION, "Key::load returned bad timestamps");
+
+    create_rec.report(out, "key_create", dist);
+    load_rec.report(out, "key_load", dist);
+  }
+
+
+  void bench_cellcache(CellSet &cells, const char *dist, FILE *out) {
+    Recorder add_rec, scan_rec;
+    CellCachePtr cache = new CellCache();
+    ScanContextPtr scan_ctx = new ScanContext(0);
+    size_t count = cells.keys.size();
+
+    cache->lock();
+    for (size_t i=0; i<count; i+=BATCH_SIZE) {
+      size_t n = std::min((size_t)BATCH_SIZE, count - i);
+      size_t bytes = 0;
+      add_rec.start();
+      for (size_t j=i; j<i+n; j++) {
+        cache->add(cells.keys[j], cells.values[j], 0);
+        bytes += cell_length(cells.keys[j], cells.values[j]);
+      }
+      add_rec.stop(n, bytes);
+    }
+    cache->unlock();
+
+    CellListScanner *scanner = cache->create_scanner(scan_ctx);
+    check_count("cellcache_scan", count, scan_all(scanner, scan_rec));
+    delete scanner;
+
+    add_rec.report(out, "cellcache_add", dist);
+    scan_rec.report(out, "cellcache_scan", dist);
+  }
+
+
+  void bench_mergescanner(CellSet &cells, const char *dist, FILE *out,
+                          size_t ways) {
+    Recorder rec;
+    std::vector<CellCachePtr> caches(ways);
+    ScanContextPtr scan_ctx = new ScanContext(0);
+    size_t count = cells.keys.size();
+
+    for (size_t i=0; i<ways; i++) {
+      caches[i] = new CellCache();
+      caches[i]->lock();
+    }
+    for (size_t i=0; i<count; i++)
+      caches[i % ways]->add(cells.keys[i], cells.values[i], 0);
+
+    MergeScanner *scanner = new MergeScanner(scan_ctx, false);
+    for (size_t i=0; i<ways; i++) {
+      caches[i]->unlock();
+      scanner->add_scanner(caches[i]->create_scanner(scan_ctx));
+    }
+    check_count("mergescanner", count, scan_all(scanner, rec));
+    delete scanner;
+
+    rec.report(out, "mergescanner", dist, format("ways=%d", (int)ways));
+  }
+
+
+  void bench_cellstore(CellSet &cells, const char *dist, FILE *out,
+                       Filesystem *fs, const String &dir,
+                       const String &compressor) {
+    Recorder write_rec, scan_rec;
+    ScanContextPtr scan_ctx = new ScanContext(0);
+    String fname = dir + "/cs-" + dist;
+    size_t count = cells.keys.size();
+    std::vector<size_t> order(count);
+    Timestamp timestamp;
+
+    for (size_t i=0; i<count; i++)
+      order[i] = i;
+    std::sort(order.begin(), order.end(), LtCell(cells));
+
+    CellStoreV0Ptr writer = new CellStoreV0(fs);
+    if (writer->create(fname.c_str(), CELLSTORE_BLOCKSIZE, compressor,
+                       CellStore::BLOOM_FILTER_DISABLED) != Error::OK)
+      HT_THROWF(Error::FAILED_EXPECTATION, "Problem creating CellStore %s",
+                fname.c_str());
+
+    for (size_t i=0; i<count; i+=BATCH_SIZE) {
+      size_t n = std::min((size_t)BATCH_SIZE, count - i);
+      size_t bytes = 0;
+      write_rec.start();
+      for (size_t j=i; j<i+n; j++) {
+        size_t k = order[j];
+        writer->add(cells.keys[k], cells.values[k], 0);
+        bytes += cell_length(cells.keys[k], cells.values[k]);
+      }
+      write_rec.stop(n, bytes);
+    }
+
+    // finalize counts toward throughput but isn't a per-op latency
+    timestamp.logical = timestamp.real = count;
+    write_rec.start();
+    if (writer->finalize(timestamp) != Error::OK)
+      HT_THROWF(Error::FAILED_EXPECTATION, "Problem finalizing CellStore %s",
+                fname.c_str());
+    write_rec.stop(0, 0);
+    float ratio = writer->compression_ratio();
+    writer = 0;
+
+    CellStoreV0Ptr reader = new CellStoreV0(fs);
+    if (reader->open(fname.c_str(), 0, 0) != Error::OK ||
+        reader->load_index() != Error::OK)
+      HT_THROWF(Error::FAILED_EXPECTATION, "Problem opening CellStore %s",
+                fname.c_str());
+
+    CellListScanner *scanner = reader->create_scanner(scan_ctx);
+    check_count("cellstore_scan", count, scan_all(scanner, scan_rec));
+    delete scanner;
+    reader = 0;
+
+    fs->remove(fname);
+
+    write_rec.report(out, "cellstore_write", dist,
+                     format("compressor=%s,ratio=%.3f,threads=%d",
+                            compressor.c_str(), ratio,
+                            (int)Global::cellstore_compression_threads));
+    scan_rec.report(out, "cellstore_scan", dist,
+                    format("compressor=%s", compressor.c_str()));
+  }
+
+
+  void bench_blockcache(KeyGenerator::Distribution distribution, uint32_t seed,
+                        size_t count, const char *dist, FILE *out) {
+    Recorder rec;
+    FileBlockCache cache((uint64_t)CACHE_BLOCKS * CACHE_BLOCK_SIZE);
+    KeyGenerator gen(distribution, CACHE_KEY_SPACE, seed);
+    uint8_t *block;
+    uint32_t length;
+    uint64_t hits = 0;
+
+    for (size_t i=0; i<count; i+=BATCH_SIZE) {
+      size_t n = std::min((size_t)BATCH_SIZE, count - i);
+      rec.start();
+      for (size_t j=0; j<n; j++) {
+        uint32_t offset = (uint32_t)gen.next() * CACHE_BLOCK_SIZE;
+        if (cache.checkout(0, offset, &block, &length))
+          hits++;
+        else {
+          // a miss pays for the allocation, as it would for a DFS read
+          block = new uint8_t [CACHE_BLOCK_SIZE];
+          if (!cache.insert_and_checkout(0, offset, block, CACHE_BLOCK_SIZE)) {
+            delete [] block;
+            continue;
+          }
+        }
+        cache.checkin(0, offset);
+      }
+      rec.stop(n, 0);
+    }
+
+    rec.report(out, "blockcache", dist,
+               format("hit_rate=%.4f", (double)hits / (double)count));
+  }
+
+
+  void bench_codec(CellSet &cells, const char *dist, FILE *out) {
+    std::vector<DynamicBuffer *> blocks;
+    DynamicBuffer *block = 0;
+
+    // serialize the cells into CellStore sized blocks
+    for (size_t i=0; i<cells.keys.size(); i++) {
+      if (block == 0 || block->fill() >= CODEC_BLOCKSIZE) {
+        block = new DynamicBuffer(CODEC_BLOCKSIZE + 1024);
+        blocks.push_back(block);
+      }
+      block->add(cells.keys[i].ptr, cells.keys[i].length());
+      block->add(cells.values[i].ptr, cells.values[i].length());
+    }
+
+    for (size_t c=0; CODECS[c]; c++) {
+      Recorder deflate_rec, inflate_rec;
+      BlockCompressionCodecPtr codec;
+      DynamicBuffer zbuf(0), output(0);
+      uint64_t input_bytes = 0, output_bytes = 0;
+
+      try {
+        codec = CompressorFactory::create_block_codec(CODECS[c]);
+      }
+      catch (Exception &e) {
+        HT_ERROR_OUT << "Skipping " << CODECS[c] << " codec - " << e << HT_END;
+        continue;
+      }
+
+      for (size_t i=0; i<blocks.size(); i++) {
+        BlockCompressionHeader header(CODEC_MAGIC);
+        deflate_rec.start();
+        codec->deflate(*blocks[i], zbuf, header);
+        deflate_rec.stop(1, blocks[i]->fill());
+        input_bytes += blocks[i]->fill();
+        output_bytes += zbuf.fill();
+
+        inflate_rec.start();
+        codec->inflate(zbuf, output, header);
+        inflate_rec.stop(1, blocks[i]->fill());
+
+        if (output.fill() != blocks[i]->fill() ||
+            memcmp(output.base, blocks[i]->base, output.fill()))
+          HT_THROWF(Error::FAILED_EXPECTATION, "%s codec round trip mismatch",
+                    CODECS[c]);
+      }
+
+      String extra = format("ratio=%.3f", input_bytes
+                            ? (double)output_bytes / (double)input_bytes : 0.0);
+      deflate_rec.report(out, (String("codec_deflate_") + CODECS[c]).c_str(),
+                         dist, extra);
+      inflate_rec.report(out, (String("codec_inflate_") + CODECS[c]).c_str(),
+                         dist, extra);
+    }
+
+    foreach(DynamicBuffer *buf, blocks)
+      delete buf;
+  }
+
+  bool contains(const std::vector<String> &list, const char *name) {
+    return std::find(list.begin(), list.end(), String(name)) != list.end();
+  }
+
+} // local namespace
+
+
+int main(int argc, char **argv) {
+  std::vector<String> benchmarks, distributions, merge_ways;
+  String benchmarks_arg = DEFAULT_BENCHMARKS;
+  String distributions_arg = DEFAULT_DISTRIBUTIONS;
+  String merge_ways_arg = DEFAULT_MERGE_WAYS;
+  String config_file, output_file;
+  String dir = "/micro_benchmark";
+  String compressor = "lzo";
+  size_t count = 200000;
+  size_t value_size = 100;
+  uint32_t seed = 1;
+  FILE *out = stdout;
+  PropertiesPtr props_ptr;
+  ConnectionManagerPtr conn_mgr;
+  DfsBroker::Client *dfs_client = 0;
+
+  for (int i=1; i<argc; i++) {
+    if (!strncmp(argv[i], "--benchmarks=", 13))
+      benchmarks_arg = &argv[i][13];
+    else if (!strncmp(argv[i], "--distributions=", 16))
+      distributions_arg = &argv[i][16];
+    else if (!strncmp(argv[i], "--count=", 8))
+      count = strtoul(&argv[i][8], 0, 0);
+    else if (!strncmp(argv[i], "--value-size=", 13))
+      value_size = strtoul(&argv[i][13], 0, 0);
+    else if (!strncmp(argv[i], "--compressor=", 13))
+      compressor = &argv[i][13];
+    else if (!strncmp(argv[i], "--merge-ways=", 13))
+      merge_ways_arg = &argv[i][13];
+    else if (!strncmp(argv[i], "--config=", 9))
+      config_file = &argv[i][9];
+    else if (!strncmp(argv[i], "--dir=", 6))
+      dir = &argv[i][6];
+    else if (!strncmp(argv[i], "--output=", 9))
+      output_file = &argv[i][9];
+    else if (!strncmp(argv[i], "--seed=", 7))
+      seed = atoi(&argv[i][7]);
+    else
+      Usage::dump_and_exit(usage);
+  }
+
+  if (count == 0)
+    Usage::dump_and_exit(usage);
+
+  boost::split(benchmarks, benchmarks_arg, boost::is_any_of(","));
+  boost::split(distributions, distributions_arg, boost::is_any_of(","));
+  boost::split(merge_ways, merge_ways_arg, boost::is_any_of(","));
+
+  foreach(const String &ways, merge_ways) {
+    if (atoi(ways.c_str()) <= 0) {
+      cerr << "error: invalid merge way count '" << ways << "'" << endl;
+      return 1;
+    }
+  }
+
+  foreach(const String &name, distributions) {
+    KeyGenerator::Distribution distribution;
+    if (!KeyGenerator::parse_distribution(name, &distribution)) {
+      cerr << "error: unknown distribution '" << name << "'" << endl;
+      return 1;
+    }
+  }
+
+  System::initialize(System::locate_install_dir(argv[0]));
+  ReactorFactory::initialize(1);
+
+  if (config_file == "")
+    config_file = System::install_dir + "/conf/hypertable.cfg";
+
+  try {
+    props_ptr = new Properties(config_file);
+
+    Global::block_cache = new FileBlockCache(props_ptr->get_int64(
+        "Hypertable.RangeServer.BlockCache.MaxMemory", 200000000LL));
+    Global::cellstore_compression_threads = props_ptr->get_int(
+        "Hypertable.RangeServer.CellStore.CompressionThreads", 2);
+
+    if (contains(benchmarks, "cellstore")) {
+      conn_mgr = new ConnectionManager();
+      dfs_client = new DfsBroker::Client(conn_mgr, props_ptr);
+      if (!dfs_client->wait_for_connection(15)) {
+        cerr << "error: timed out waiting for DFS broker (leave cellstore "
+            "out of --benchmarks to run without one)" << endl;
+        return 1;
+      }
+      dfs_client->mkdirs(dir);
+    }
+
+    if (output_file != "" && (out = fopen(output_file.c_str(), "w")) == 0) {
+      cerr << "error: unable to open '" << output_file << "' for writing - "
+           << strerror(errno) << endl;
+      return 1;
+    }
+
+    fprintf(out, "#benchmark\tdistribution\tops\telapsed_s\tops_per_s\t"
+            "bytes_per_s\tp50_ns\tp90_ns\tp99_ns\tp999_ns\tmax_ns\textra\n");
+
+    foreach(const String &name, distributions) {
+      KeyGenerator::Distribution distribution;
+      KeyGenerator::parse_distribution(name, &distribution);
+      KeyGenerator gen(distribution, count, seed);
+      CellSet cells;
+
+      generate_cells(gen, count, value_size, cells);
+
+      if (contains(benchmarks, "key"))
+        bench_key(cells, name.c_str(), out);
+      if (contains(benchmarks, "cellcache"))
+        bench_cellcache(cells, name.c_str(), out);
+      if (contains(benchmarks, "mergescanner")) {
+        foreach(const String &ways, merge_ways)
+          bench_mergescanner(cells, name.c_str(), out, atoi(ways.c_str()));
+      }
+      if (contains(benchmarks, "cellstore"))
+        bench_cellstore(cells, name.c_str(), out, dfs_client, dir, compressor);
+      if (contains(benchmarks, "blockcache"))
+        bench_blockcache(distribution, seed, count, name.c_str(), out);
+      if (contains(benchmarks, "codec"))
+        bench_codec(cells, name.c_str(), out);
+    }
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+
+  if (out != stdout)
+    fclose(out);
+
+  return 0;
+}
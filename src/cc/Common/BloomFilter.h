@@ -0,0 +1,138 @@
+/**
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hypertable. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef HYPERTABLE_BLOOMFILTER_H
+#define HYPERTABLE_BLOOMFILTER_H
+
+#include <cmath>
+#include <vector>
+
+#include "Error.h"
+#include "Serialization.h"
+
+namespace Hypertable {
+
+/**
+ * A simple bloom filter.  Membership tests can yield false positives but
+ * never false negatives.  Bit positions are derived from a single 64-bit
+ * FNV-1a hash with double hashing, so callers that already have the hash
+ * of a key (e.g. collected while streaming keys) can insert it directly.
+ */
+class BloomFilter {
+public:
+  /**
+   * Constructs an empty filter sized for the given number of items
+   *
+   * @param items_estimate expected number of items to be inserted
+   * @param false_positive_prob desired false positive probability
+   */
+  BloomFilter(size_t items_estimate, float false_positive_prob = 0.01) {
+    double bits = -((double)items_estimate * std::log(false_positive_prob))
+                  / (M_LN2 * M_LN2);
+    m_num_bits = (bits < 64.0) ? 64 : (uint32_t)bits;
+    m_num_hashes = (items_estimate == 0) ? 1 :
+        (uint32_t)(((double)m_num_bits / items_estimate) * M_LN2 + 0.5);
+    if (m_num_hashes < 1)
+      m_num_hashes = 1;
+    else if (m_num_hashes > 16)
+      m_num_hashes = 16;
+    m_bits.resize((m_num_bits + 7) / 8, 0);
+  }
+
+  /**
+   * Constructs a filter from its serialized form
+   *
+   * @param bufp address of pointer to serialized filter (advanced)
+   * @param remainp address of remaining byte count (decremented)
+   */
+  BloomFilter(const uint8_t **bufp, size_t *remainp) {
+    m_num_hashes = Serialization::decode_i32(bufp, remainp);
+    m_num_bits = Serialization::decode_i32(bufp, remainp);
+    size_t len = (m_num_bits + 7) / 8;
+    if (m_num_hashes == 0 || len > *remainp)
+      HT_THROWF(Error::SERIALIZATION_INPUT_OVERRUN, "Bad bloom filter "
+                "(hashes=%u, bits=%u, remain=%lu)", m_num_hashes, m_num_bits,
+                (unsigned long)*remainp);
+    m_bits.assign(*bufp, *bufp + len);
+    *bufp += len;
+    *remainp -= len;
+  }
+
+  static uint64_t hash(const void *key, size_t len) {
+    const uint8_t *ptr = (const uint8_t *)key;
+    uint64_t h = 14695981039346656037ULL;
+    for (const uint8_t *end = ptr + len; ptr < end; ++ptr) {
+      h ^= *ptr;
+      h *= 1099511628211ULL;
+    }
+    // FNV leaves keys that differ only at the end close in the high bits,
+    // which give the probe stride; mix them down before splitting
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  void insert(const void *key, size_t len) { insert_hash(hash(key, len)); }
+
+  void insert_hash(uint64_t h) {
+    uint32_t h1 = (uint32_t)h, h2 = (uint32_t)(h >> 32) | 1;
+    for (uint32_t i = 0; i < m_num_hashes; ++i) {
+      uint32_t bit = (uint32_t)((h1 + (uint64_t)i * h2) % m_num_bits);
+      m_bits[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+    }
+  }
+
+  bool may_contain(const void *key, size_t len) const {
+    return may_contain_hash(hash(key, len));
+  }
+
+  bool may_contain_hash(uint64_t h) const {
+    uint32_t h1 = (uint32_t)h, h2 = (uint32_t)(h >> 32) | 1;
+    for (uint32_t i = 0; i < m_num_hashes; ++i) {
+      uint32_t bit = (uint32_t)((h1 + (uint64_t)i * h2) % m_num_bits);
+      if ((m_bits[bit >> 3] & (1 << (bit & 7))) == 0)
+        return false;
+    }
+    return true;
+  }
+
+  size_t encoded_length() const { return 8 + m_bits.size(); }
+
+  void encode(uint8_t **bufp) const {
+    Serialization::encode_i32(bufp, m_num_hashes);
+    Serialization::encode_i32(bufp, m_num_bits);
+    memcpy(*bufp, &m_bits[0], m_bits.size());
+    *bufp += m_bits.size();
+  }
+
+  uint32_t get_num_hashes() const { return m_num_hashes; }
+  uint32_t get_num_bits() const { return m_num_bits; }
+
+private:
+  uint32_t m_num_hashes;
+  uint32_t m_num_bits;
+  std::vector<uint8_t> m_bits;
+};
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_BLOOMFILTER_H
@@ -94,12 +94,17 @@ private: // helpers
   }
 
 public: // API
+  /**
+   * Constructs an arena.  The first page is allocated lazily, so an arena
+   * that never gets used costs no more than the object itself.
+   *
+   * @param page_sz size of each page in bytes
+   */
   CharArena(size_t page_sz = DEFAULT_PAGE_SZ) :
             m_cur_page(0), m_page_sz(page_sz), m_pages(0),
             m_total(0), m_alloced(0) {
     assert(page_sz > sizeof(Page));
-    m_cur_page = alloc_page(page_sz);
-    m_page_limit = m_cur_page->remain();
+    m_page_limit = page_sz - sizeof(Page);
   }
   ~CharArena() { free(); }
 
@@ -117,6 +122,25 @@ public: // API
     return m_cur_page->alloc(sz);
   }
 
+  /**
+   * Allocates a block suitably aligned to hold pointers
+   */
+  char *
+  alloc_aligned(size_t sz) {
+    const size_t align = sizeof(void *);
+
+    if (m_cur_page && sz <= m_page_limit) {
+      size_t pad = (align - ((size_t)m_cur_page->alloc_end & (align - 1)))
+                   & (align - 1);
+      if (sz + pad <= m_cur_page->remain()) {
+        m_alloced += sz + pad;
+        return m_cur_page->alloc(sz + pad) + pad;
+      }
+    }
+    char *ptr = alloc(sz + align - 1);
+    return (char *)(((size_t)ptr + align - 1) & ~(align - 1));
+  }
+
   char *
   dup(const char *s) {
     if (!s)
@@ -140,12 +164,18 @@ public: // API
     m_pages = m_total = m_alloced = 0;
   }
 
+  /** Returns the number of bytes handed out by alloc() */
+  size_t used() const { return m_alloced; }
+
+  /** Returns the number of bytes held in pages */
+  size_t total() const { return m_total; }
+
   std::ostream&
   dump_stat(std::ostream& out) const {
     out <<"pages="<< m_pages
       <<", bytes="<< m_total
       <<", alloc="<< m_alloced
-      <<"("<< m_alloced * 100. / m_total
+      <<"("<< (m_total ? m_alloced * 100. / m_total : 0.)
       <<"%)";
     return out;
   }
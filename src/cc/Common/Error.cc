@@ -126,6 +126,8 @@ namespace {
     { Error::RANGESERVER_ROW_OVERFLOW,         "RANGE SERVER row overflow" },
     { Error::RANGESERVER_TABLE_NOT_FOUND,      "RANGE SERVER table not found" },
     { Error::RANGESERVER_BAD_SCAN_SPEC,        "RANGE SERVER bad scan specification" },
+    { Error::RANGESERVER_RANGE_BUSY,           "RANGE SERVER range busy" },
+    { Error::RANGESERVER_THROTTLED,            "RANGE SERVER throttled" },
     { Error::HQL_BAD_LOAD_FILE_FORMAT,         "HQL bad load file format" },
     { Error::METALOG_BAD_RS_HEADER, "METALOG bad range server metalog header" },
     { Error::METALOG_BAD_M_HEADER,  "METALOG bad master metalog header" },
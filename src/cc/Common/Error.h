@@ -128,6 +128,8 @@ namespace Hypertable {
       RANGESERVER_ROW_OVERFLOW           = 0x00050011,
       RANGESERVER_TABLE_NOT_FOUND        = 0x00050012,
       RANGESERVER_BAD_SCAN_SPEC          = 0x00050013,
+      RANGESERVER_RANGE_BUSY             = 0x00050014,
+      RANGESERVER_THROTTLED              = 0x00050015,
 
       HQL_BAD_LOAD_FILE_FORMAT  = 0x00060001,
 
@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hypertable. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "Common/Compat.h"
+#include "Common/Config.h"
+#include "Common/Logger.h"
+#include "Common/BloomFilter.h"
+
+#include <cstdio>
+
+using namespace Hypertable;
+
+namespace {
+
+const size_t NUM_ITEMS = 100000;
+
+void make_key(char *buf, size_t len, const char *prefix, size_t i) {
+  snprintf(buf, len, "%s%010lu", prefix, (unsigned long)i);
+}
+
+void test_no_false_negatives(BloomFilter &filter) {
+  char key[32];
+  for (size_t i = 0; i < NUM_ITEMS; ++i) {
+    make_key(key, sizeof(key), "row", i);
+    HT_EXPECT(filter.may_contain(key, strlen(key)), -1);
+  }
+}
+
+void test_false_positive_rate(BloomFilter &filter) {
+  char key[32];
+  size_t false_positives = 0;
+  for (size_t i = 0; i < NUM_ITEMS; ++i) {
+    make_key(key, sizeof(key), "absent", i);
+    if (filter.may_contain(key, strlen(key)))
+      ++false_positives;
+  }
+  double rate = (double)false_positives / NUM_ITEMS;
+  HT_INFOF("false positive rate = %.4f", rate);
+  HT_EXPECT(rate < 0.02, -1);
+}
+
+void test_serialization(BloomFilter &filter) {
+  std::vector<uint8_t> buf(filter.encoded_length());
+  uint8_t *p = &buf[0];
+  filter.encode(&p);
+  HT_EXPECT((size_t)(p - &buf[0]) == filter.encoded_length(), -1);
+
+  const uint8_t *p2 = &buf[0];
+  size_t remain = buf.size();
+  BloomFilter decoded(&p2, &remain);
+  HT_EXPECT(remain == 0, -1);
+  HT_EXPECT(decoded.get_num_hashes() == filter.get_num_hashes(), -1);
+  HT_EXPECT(decoded.get_num_bits() == filter.get_num_bits(), -1);
+  test_no_false_negatives(decoded);
+}
+
+void test_bad_input(BloomFilter &filter) {
+  std::vector<uint8_t> buf(filter.encoded_length());
+  uint8_t *p = &buf[0];
+  filter.encode(&p);
+  try {
+    const uint8_t *p2 = &buf[0];
+    size_t remain = buf.size() - 1;
+    BloomFilter truncated(&p2, &remain);
+    HT_EXPECT(!"truncated filter decoded", -1);
+  }
+  catch (Exception &e) {
+    HT_INFO_OUT << e << HT_END;
+    HT_EXPECT(e.code() == Error::SERIALIZATION_INPUT_OVERRUN, -1);
+  }
+}
+
+} // local namespace
+
+int main(int ac, char *av[]) {
+  Config::init(ac, av);
+
+  try {
+    BloomFilter filter(NUM_ITEMS, 0.01);
+    char key[32];
+
+    for (size_t i = 0; i < NUM_ITEMS; ++i) {
+      make_key(key, sizeof(key), "row", i);
+      filter.insert(key, strlen(key));
+    }
+
+    test_no_false_negatives(filter);
+    test_false_positive_rate(filter);
+    test_serialization(filter);
+    test_bad_input(filter);
+  }
+  catch (Exception &e) {
+    HT_FATAL_OUT << e << HT_END;
+    return 1;
+  }
+  return 0;
+}
@@ -66,17 +66,25 @@ void CommitLog::initialize(Filesystem *fs, const String &log_dir, PropertiesPtr
   m_log_dir = log_dir;
   m_cur_fragment_length = 0;
   m_cur_fragment_num = 0;
+  m_pending_bytes = 0;
+  m_flush_in_progress = false;
 
   if (props_ptr) {
     m_max_fragment_size = props_ptr->get_int64("Hypertable.RangeServer.CommitLog.RollLimit", HYPERTABLE_RANGESERVER_COMMITLOG_ROLLLIMIT);
     compressor = props_ptr->get("Hypertable.RangeServer.CommitLog.Compressor", HYPERTABLE_RANGESERVER_COMMITLOG_COMPRESSOR);
+    m_group_commit_max_wait = props_ptr->get_int("Hypertable.RangeServer.CommitLog.GroupCommit.MaxWait", HYPERTABLE_RANGESERVER_COMMITLOG_GROUPCOMMIT_MAXWAIT);
+    m_group_commit_max_bytes = props_ptr->get_int("Hypertable.RangeServer.CommitLog.GroupCommit.MaxBytes", HYPERTABLE_RANGESERVER_COMMITLOG_GROUPCOMMIT_MAXBYTES);
   }
   else {
     m_max_fragment_size = HYPERTABLE_RANGESERVER_COMMITLOG_ROLLLIMIT;
     compressor = HYPERTABLE_RANGESERVER_COMMITLOG_COMPRESSOR;
+    m_group_commit_max_wait = HYPERTABLE_RANGESERVER_COMMITLOG_GROUPCOMMIT_MAXWAIT;
+    m_group_commit_max_bytes = HYPERTABLE_RANGESERVER_COMMITLOG_GROUPCOMMIT_MAXBYTES;
   }
 
   HT_INFOF("RollLimit = %lld", m_max_fragment_size);
+  HT_INFOF("GroupCommit.MaxWait = %d, GroupCommit.MaxBytes = %lu",
+           m_group_commit_max_wait, (Lu)m_group_commit_max_bytes);
 
   m_compressor = CompressorFactory::create_block_codec(compressor);
 
@@ -132,26 +140,116 @@ uint64_t CommitLog::get_timestamp() {
  *
  */
 int CommitLog::write(DynamicBuffer &buffer, uint64_t timestamp) {
+  boost::mutex::scoped_lock lock(m_mutex);
+  PendingWrite pw;
+
+  pw.table = 0;
+  pw.buffer = &buffer;
+  pw.timestamp = timestamp;
+
+  return group_commit(pw, lock);
+}
+
+
+
+/**
+ *
+ */
+int CommitLog::write(const TableIdentifier *table, DynamicBuffer &buffer, uint64_t timestamp) {
+  boost::mutex::scoped_lock lock(m_mutex);
+  PendingWrite pw;
+
+  pw.table = table;
+  pw.buffer = &buffer;
+  pw.timestamp = timestamp;
+
+  return group_commit(pw, lock);
+}
+
+
+
+/**
+ * Queues the write and waits for it to land.  The first writer to find
+ * no flush in progress becomes the leader and commits everything that has
+ * accumulated (up to GroupCommit.MaxBytes) with a single append.  The
+ * mutex is not held during the compress/append so that other writers can
+ * queue up behind it.
+ */
+int CommitLog::group_commit(PendingWrite &pw, boost::mutex::scoped_lock &lock) {
+  std::deque<PendingWrite *> group;
+  size_t group_bytes, amount;
+  uint64_t timestamp;
   int error;
-  BlockCompressionHeaderCommitLog header(MAGIC_DATA, timestamp);
-
-  /**
-   * Compress and write the commit block
-   */
-  if ((error = compress_and_write(buffer, &header, timestamp)) != Error::OK)
-    return error;
-
-  /**
-   * Roll the log
-   */
-  if (m_cur_fragment_length > m_max_fragment_size) {
-    boost::mutex::scoped_lock lock(m_mutex);
-    error = roll();
+
+  pw.error = Error::OK;
+  pw.done = false;
+
+  m_pending.push_back(&pw);
+  m_pending_bytes += pw.buffer->fill();
+
+  if (m_flush_in_progress && m_pending_bytes >= m_group_commit_max_bytes)
+    m_group_cond.notify_all();
+
+  while (!pw.done) {
+
+    if (m_flush_in_progress) {
+      m_group_cond.wait(lock);
+      continue;
+    }
+
+    m_flush_in_progress = true;
+
+    // Give the group a chance to fill
+    if (m_group_commit_max_wait > 0 && m_pending_bytes < m_group_commit_max_bytes) {
+      boost::xtime deadline;
+      boost::xtime_get(&deadline, boost::TIME_UTC);
+      deadline.sec += m_group_commit_max_wait / 1000;
+      deadline.nsec += (m_group_commit_max_wait % 1000) * 1000000;
+      if (deadline.nsec >= 1000000000) {
+        deadline.sec++;
+        deadline.nsec -= 1000000000;
+      }
+      while (m_pending_bytes < m_group_commit_max_bytes)
+        if (!m_group_cond.timed_wait(lock, deadline))
+          break;
+    }
+
+    group_bytes = 0;
+    while (!m_pending.empty() &&
+           (group.empty() || group_bytes + m_pending.front()->buffer->fill() <= m_group_commit_max_bytes)) {
+      group_bytes += m_pending.front()->buffer->fill();
+      group.push_back(m_pending.front());
+      m_pending.pop_front();
+    }
+    m_pending_bytes -= group_bytes;
+
+    lock.unlock();
+    error = compress_and_write(group, &amount, &timestamp);
+    lock.lock();
+
+    if (error == Error::OK) {
+      assert(timestamp != 0);
+      // groups can land out of timestamp order; the fragment keeps the newest
+      if (timestamp > m_last_timestamp)
+        m_last_timestamp = timestamp;
+      m_cur_fragment_length += amount;
+
+      // Roll the log
+      if (m_cur_fragment_length > m_max_fragment_size)
+        error = roll();
+    }
+
+    foreach (PendingWrite *gpw, group) {
+      gpw->error = error;
+      gpw->done = true;
+    }
+    group.clear();
+
+    m_flush_in_progress = false;
+    m_group_cond.notify_all();
   }
-  else
-    error = Error::OK;
 
-  return error;
+  return pw.error;
 }
 
 
@@ -176,12 +274,17 @@ int CommitLog::link_log(CommitLogBase *log_base, uint64_t timestamp) {
 
   try {
     boost::mutex::scoped_lock lock(m_mutex);
+
+    while (m_flush_in_progress)
+      m_group_cond.wait(lock);
+
     size_t amount = input.fill();
     StaticBuffer send_buf(input);
 
     m_fs->append(m_fd, send_buf, Filesystem::O_FLUSH);
     assert(timestamp != 0);
-    m_last_timestamp = timestamp;
+    if (timestamp > m_last_timestamp)
+      m_last_timestamp = timestamp;
     m_cur_fragment_length += amount;
 
     if ((error = roll()) != Error::OK)
@@ -208,6 +311,8 @@ int CommitLog::close() {
 
   try {
     boost::mutex::scoped_lock lock(m_mutex);
+    while (m_flush_in_progress)
+      m_group_cond.wait(lock);
     if (m_fd > 0)
       m_fs->close(m_fd);
   }
@@ -300,35 +405,82 @@ int CommitLog::roll() {
 
 
 /**
- *
+ * Compresses a commit group and writes it with a single flushed append.
+ * Runs of updates for the same table are merged into one block whose
+ * header carries the largest timestamp in the run, so that the fragment
+ * is never purged before all of its updates have been compacted.
  */
-int CommitLog::compress_and_write(DynamicBuffer &input, BlockCompressionHeader *header, uint64_t timestamp) {
-  int error = Error::OK;
-  EventPtr event_ptr;
+int CommitLog::compress_and_write(std::deque<PendingWrite *> &group, size_t *amountp, uint64_t *timestampp) {
+  DynamicBuffer input;
   DynamicBuffer zblock;
+  DynamicBuffer output;
+  DynamicBuffer *inputp;
+  uint64_t timestamp;
+  size_t i = 0, j;
+
+  *timestampp = 0;
 
-  // Compress block and kick off log write (protected by lock)
   try {
-    boost::mutex::scoped_lock lock(m_mutex);
 
-    m_compressor->deflate(input, zblock, *header);
+    while (i < group.size()) {
 
-    size_t amount = zblock.fill();
-    StaticBuffer send_buf(zblock);
+      timestamp = group[i]->timestamp;
+
+      if (group[i]->table == 0) {
+        inputp = group[i]->buffer;
+        j = i + 1;
+      }
+      else {
+        const TableIdentifier *table = group[i]->table;
+        size_t len = table->encoded_length();
+
+        for (j = i; j < group.size(); j++) {
+          const TableIdentifier *other = group[j]->table;
+          if (other == 0 || other->id != table->id ||
+              other->generation != table->generation)
+            break;
+          len += group[j]->buffer->fill();
+        }
+
+        input.clear();
+        input.ensure(len);
+        table->encode(&input.ptr);
+        for (size_t k = i; k < j; k++) {
+          input.add_unchecked(group[k]->buffer->base, group[k]->buffer->fill());
+          if (group[k]->timestamp > timestamp)
+            timestamp = group[k]->timestamp;
+        }
+        inputp = &input;
+      }
+
+      BlockCompressionHeaderCommitLog header(MAGIC_DATA, timestamp);
+
+      m_compressor->deflate(*inputp, zblock, header);
+
+      if (timestamp > *timestampp)
+        *timestampp = timestamp;
+
+      // common case of a single block needs no gathering
+      if (i == 0 && j == group.size())
+        break;
+
+      output.add(zblock.base, zblock.fill());
+      i = j;
+    }
+
+    DynamicBuffer &send = (output.fill() > 0) ? output : zblock;
+    *amountp = send.fill();
+    StaticBuffer send_buf(send);
 
     m_fs->append(m_fd, send_buf, Filesystem::O_FLUSH);
-    assert(timestamp != 0);
-    assert(timestamp != 0);
-    m_last_timestamp = timestamp;
-    m_cur_fragment_length += amount;
   }
   catch (Exception &e) {
     HT_ERRORF("Problem writing commit log: %s: %s",
               m_cur_fragment_fname.c_str(), e.what());
-    error = e.code();
+    return e.code();
   }
 
-  return error;
+  return Error::OK;
 }
 
 
@@ -32,6 +32,7 @@ extern "C" {
 #include <sys/time.h>
 }
 
+#include <boost/thread/condition.hpp>
 #include <boost/thread/mutex.hpp>
 
 #include "Common/DynamicBuffer.h"
@@ -66,6 +67,17 @@ namespace Hypertable {
    *<pre>
    * Hypertable.RangeServer.CommitLog.RollLimit
    *</pre>
+   *
+   * Writes are group committed.  Concurrent calls to #write are queued and
+   * a single writer (the "leader") appends everything that has accumulated
+   * with one flush, after which every queued writer is released with the
+   * result.  Consecutive update blocks for the same table are merged into a
+   * single compressed block.  The amount of time the leader waits for the
+   * group to fill and the maximum size of a group are controlled with:
+   *<pre>
+   * Hypertable.RangeServer.CommitLog.GroupCommit.MaxWait (milliseconds)
+   * Hypertable.RangeServer.CommitLog.GroupCommit.MaxBytes
+   *</pre>
    */
   class CommitLog : public CommitLogBase {
   public:
@@ -110,6 +122,18 @@ namespace Hypertable {
      */
     int write(DynamicBuffer &buffer, uint64_t timestamp);
 
+    /** Writes a block of updates for a table to the commit log.  The
+     * block is written as the encoded table identifier followed by the
+     * contents of buffer.  Updates for the same table that are group
+     * committed together get merged into a single block.
+     *
+     * @param table identifier of table to which the updates belong
+     * @param buffer key/value pairs to commit
+     * @param timestamp current commit log time obtained with a call to #get_timestamp
+     * @return Error::OK on success or error code on failure
+     */
+    int write(const TableIdentifier *table, DynamicBuffer &buffer, uint64_t timestamp);
+
     /** Links an external log into this log.
      *
      * @param log_base pointer to commit log object to link in
@@ -152,11 +176,26 @@ namespace Hypertable {
 
   private:
 
+    struct PendingWrite {
+      const TableIdentifier *table;
+      DynamicBuffer *buffer;
+      uint64_t timestamp;
+      int error;
+      bool done;
+    };
+
     void initialize(Filesystem *fs, const String &log_dir, PropertiesPtr &props_ptr, CommitLogBase *init_log);
     int roll();
-    int compress_and_write(DynamicBuffer &input, BlockCompressionHeader *header, uint64_t timestamp);
+    int group_commit(PendingWrite &pw, boost::mutex::scoped_lock &lock);
+    int compress_and_write(std::deque<PendingWrite *> &group, size_t *amountp, uint64_t *timestampp);
 
     boost::mutex            m_mutex;
+    boost::condition        m_group_cond;
+    std::deque<PendingWrite *> m_pending;
+    size_t                  m_pending_bytes;
+    bool                    m_flush_in_progress;
+    int                     m_group_commit_max_wait;
+    size_t                  m_group_commit_max_bytes;
     Filesystem             *m_fs;
     BlockCompressionCodec  *m_compressor;
     String                  m_cur_fragment_fname;
@@ -37,3 +37,6 @@ const uint32_t Hypertable::HYPERTABLE_DATA_TRANSFER_BLOCKSIZE = 65500;
 const int64_t Hypertable::HYPERTABLE_RANGESERVER_COMMITLOG_ROLLLIMIT = 100000000LL;
 
 const char *Hypertable::HYPERTABLE_RANGESERVER_COMMITLOG_COMPRESSOR = "lzo";
+
+const int Hypertable::HYPERTABLE_RANGESERVER_COMMITLOG_GROUPCOMMIT_MAXWAIT = 0;
+const uint32_t Hypertable::HYPERTABLE_RANGESERVER_COMMITLOG_GROUPCOMMIT_MAXBYTES = 4000000;
@@ -39,6 +39,9 @@ namespace Hypertable {
 
   extern const char *HYPERTABLE_RANGESERVER_COMMITLOG_COMPRESSOR;
 
+  extern const int HYPERTABLE_RANGESERVER_COMMITLOG_GROUPCOMMIT_MAXWAIT;
+  extern const uint32_t HYPERTABLE_RANGESERVER_COMMITLOG_GROUPCOMMIT_MAXBYTES;
+
 }
 
 #endif // HYPERTABLE_DEFAULTS_H
@@ -200,6 +200,10 @@ void HqlCommandInterpreter::execute_line(const String &line) {
       scan_spec.time_interval.second = state.scan.end_time;
       scan_spec.return_deletes = state.scan.return_deletes;
 
+      for (size_t i=0; i<state.scan.predicates.size(); i++)
+        scan_spec.predicates.push_back(CellPredicate(state.scan.predicates[i].first,
+            state.scan.predicates[i].second.c_str()));
+
       table_ptr = m_client->open_table(state.table_name);
 
       scanner_ptr = table_ptr->create_scanner(scan_spec);
@@ -264,7 +268,7 @@ void HqlCommandInterpreter::execute_line(const String &line) {
       }
       else {
         table_ptr = m_client->open_table(state.table_name);
-        mutator_ptr = table_ptr->create_mutator();
+        mutator_ptr = table_ptr->create_mutator(0, true);
       }
 
       if (!FileUtils::exists(state.input_file.c_str()))
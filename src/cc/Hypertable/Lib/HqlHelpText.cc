@@ -84,6 +84,7 @@ namespace {
     "    cell_predicate",
     "    | row_predicate",
     "    | timestamp_predicate",
+    "    | filter_predicate",
     "",
     "relop: '=' | '<' | '<=' | '>' | '>=' | '=^'",
     "",
@@ -102,6 +103,14 @@ namespace {
     "timestamp_predicate: ",
     "    [timestamp relop] TIMESTAMP relop timestamp",
     "",
+    "filter_predicate: ",
+    "    VALUE '=' 'value'",
+    "    | VALUE '=^' 'prefix'",
+    "    | VALUE REGEXP 'regex'",
+    "    | QUALIFIER '=^' 'prefix'",
+    "    | QUALIFIER REGEXP 'regex'",
+    "    | ROW REGEXP 'regex'",
+    "",
     "options_spec:",
     "    (REVS = revision_count",
     "    | LIMIT = row_count",
@@ -204,7 +213,9 @@ namespace {
     "    table_name '[' [start_row] \"..\" (end_row | ?? ) ']'",
     "",
     "This command will issue a 'drop range' command to the RangeServer",
-    "for the range specified with range_spec.",
+    "for the range specified with range_spec.  The RangeServer flushes the",
+    "range's cached updates to disk and stops serving it, after which the",
+    "range can be loaded by another RangeServer.",
     "",
     0
   };
@@ -266,6 +277,8 @@ namespace {
     "    IN_MEMORY",
     "    | BLOCKSIZE '=' value",
     "    | COMPRESSOR '=' string_literal",
+    "    | BLOOMFILTER '=' ('none' | 'rows' | 'rows+cols')",
+    "    | COMPACTION '=' ('merge' | 'tiered' | 'leveled' | 'timewindow')",
     "",
     0
   };
@@ -284,6 +297,7 @@ namespace {
     "    cell_predicate",
     "    | row_predicate",
     "    | timestamp_predicate",
+    "    | filter_predicate",
     "",
     "relop: '=' | '<' | '<=' | '>' | '>=' | '=^'",
     "",
@@ -302,6 +316,14 @@ namespace {
     "timestamp_predicate: ",
     "    [timestamp relop] TIMESTAMP relop timestamp",
     "",
+    "filter_predicate: ",
+    "    VALUE '=' 'value'",
+    "    | VALUE '=^' 'prefix'",
+    "    | VALUE REGEXP 'regex'",
+    "    | QUALIFIER '=^' 'prefix'",
+    "    | QUALIFIER REGEXP 'regex'",
+    "    | ROW REGEXP 'regex'",
+    "",
     "options_spec:",
     "    (REVS = revision_count",
     "    | LIMIT = row_count",
@@ -315,7 +337,9 @@ namespace {
     "",
     "The parser only accepts a single timestamp predicate.  The '=^' operator is the",
     "\"starts with\" operator.  It will return all rows that have the same prefix as the",
-    "operand.",
+    "operand.  Filter predicates are evaluated by the range servers, so cells that",
+    "don't match are never sent to the client.  Regular expressions are POSIX",
+    "extended regular expressions.",
     "",
     "EXAMPLES:",
     "",
@@ -333,6 +357,8 @@ namespace {
     "SELECT * FROM test WHERE CELL > \"old\",\"tag:abacate\";",
     "SELECT * FROM test WHERE CELL >= \"old\",\"tag:abacate\";",
     "SELECT * FROM test WHERE \"old\",\"tag:foo\" < CELL >= \"old\",\"tag:abacate\";",
+    "SELECT * FROM test WHERE ROW =^ 'b' AND VALUE REGEXP '^[0-9]+$';",
+    "SELECT * FROM test WHERE QUALIFIER =^ 'ab' AND VALUE = 'yes';",
     "SELECT * FROM test WHERE ( CELL = \"maui\",\"tag:abaisance\" OR CELL = \"foo\",\"tag:adage\" OR CELL = \"cow\",\"tag:Ab\" OR CELL =^ \"foo\",\"tag:acya\");",
     "",
     0
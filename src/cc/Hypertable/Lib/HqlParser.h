@@ -203,6 +203,7 @@ namespace Hypertable {
       int64_t current_timestamp;
       bool    current_timestamp_set;
       int current_relop;
+      std::vector<std::pair<uint8_t, String> > predicates;
     };
 
     class hql_interpreter_state {
@@ -405,6 +406,28 @@ namespace Hypertable {
       hql_interpreter_state &state;
     };
 
+    struct set_access_group_bloom_filter {
+      set_access_group_bloom_filter(hql_interpreter_state &state_)
+          : state(state_) { }
+      void operator()(char const *str, char const *end) const {
+        display_string("set_access_group_bloom_filter");
+        state.ag->bloom_filter = String(str, end-str);
+        trim_if(state.ag->bloom_filter, is_any_of("'\""));
+      }
+      hql_interpreter_state &state;
+    };
+
+    struct set_access_group_compaction {
+      set_access_group_compaction(hql_interpreter_state &state_)
+          : state(state_) { }
+      void operator()(char const *str, char const *end) const {
+        display_string("set_access_group_compaction");
+        state.ag->compaction = String(str, end-str);
+        trim_if(state.ag->compaction, is_any_of("'\""));
+      }
+      hql_interpreter_state &state;
+    };
+
     struct set_access_group_blocksize {
       set_access_group_blocksize(hql_interpreter_state &state_)
           : state(state_) { }
@@ -979,6 +1002,19 @@ namespace Hypertable {
       hql_interpreter_state &state;
     };
 
+    struct scan_add_predicate {
+      scan_add_predicate(hql_interpreter_state &state_, uint8_t type_)
+        : state(state_), type(type_) { }
+      void operator()(char const *str, char const *end) const {
+        display_string("scan_add_predicate");
+        // strip the enclosing quotes only; the pattern may contain quotes
+        state.scan.predicates.push_back(
+            std::make_pair(type, String(str + 1, (end - str) - 2)));
+      }
+      hql_interpreter_state &state;
+      uint8_t type;
+    };
+
     struct scan_set_return_deletes {
       scan_set_return_deletes(hql_interpreter_state &state_) : state(state_) { }
       void operator()(char const *str, char const *end) const {
@@ -1206,6 +1242,8 @@ namespace Hypertable {
           Token DELETE       = as_lower_d["delete"];
           Token VALUES       = as_lower_d["values"];
           Token COMPRESSOR   = as_lower_d["compressor"];
+          Token BLOOMFILTER  = as_lower_d["bloomfilter"];
+          Token COMPACTION   = as_lower_d["compaction"];
           Token STARTS       = as_lower_d["starts"];
           Token WITH         = as_lower_d["with"];
           Token IF           = as_lower_d["if"];
@@ -1233,6 +1271,9 @@ namespace Hypertable {
           Token AND          = as_lower_d["and"];
           Token OR           = as_lower_d["or"];
           Token LIKE         = as_lower_d["like"];
+          Token VALUE        = as_lower_d["value"];
+          Token QUALIFIER    = as_lower_d["qualifier"];
+          Token REGEXP       = as_lower_d["regexp"];
 
           /**
            * Start grammar definition
@@ -1466,6 +1507,10 @@ namespace Hypertable {
             | blocksize_option
             | COMPRESSOR >> EQUAL >> string_literal[
                 set_access_group_compressor(self.state)]
+            | BLOOMFILTER >> EQUAL >> string_literal[
+                set_access_group_bloom_filter(self.state)]
+            | COMPACTION >> EQUAL >> string_literal[
+                set_access_group_compaction(self.state)]
             ;
 
           in_memory_option
@@ -1516,6 +1561,21 @@ namespace Hypertable {
 	    *( OR >> row_interval[scan_add_row_interval(self.state)]) >> RPAREN
 	    ;
 
+	  predicate_filter
+	    = VALUE >> EQUAL >> string_literal[scan_add_predicate(self.state,
+	        CellPredicate::VALUE_EQUALS)]
+	    | VALUE >> SW >> string_literal[scan_add_predicate(self.state,
+	        CellPredicate::VALUE_PREFIX)]
+	    | VALUE >> REGEXP >> string_literal[scan_add_predicate(self.state,
+	        CellPredicate::VALUE_REGEX)]
+	    | QUALIFIER >> SW >> string_literal[scan_add_predicate(self.state,
+	        CellPredicate::QUALIFIER_PREFIX)]
+	    | QUALIFIER >> REGEXP >> string_literal[scan_add_predicate(
+	        self.state, CellPredicate::QUALIFIER_REGEX)]
+	    | ROW >> REGEXP >> string_literal[scan_add_predicate(self.state,
+	        CellPredicate::ROW_REGEX)]
+	    ;
+
 	  cell_spec
 	    = string_literal[scan_set_cell_row(self.state)]
 	      >> COMMA >> string_literal[scan_set_cell_column(self.state)]
@@ -1532,6 +1592,7 @@ namespace Hypertable {
 
           where_predicate
 	    = cell_predicate
+	    | predicate_filter
 	    | row_predicate
 	    | time_predicate
 	    ;
@@ -1644,6 +1705,7 @@ namespace Hypertable {
           BOOST_SPIRIT_DEBUG_RULE(relop);
           BOOST_SPIRIT_DEBUG_RULE(row_interval);
           BOOST_SPIRIT_DEBUG_RULE(row_predicate);
+          BOOST_SPIRIT_DEBUG_RULE(predicate_filter);
           BOOST_SPIRIT_DEBUG_RULE(option_spec);
           BOOST_SPIRIT_DEBUG_RULE(date_expression);
           BOOST_SPIRIT_DEBUG_RULE(datetime);
@@ -1696,7 +1758,7 @@ namespace Hypertable {
           update_statement, create_scanner_statement, destroy_scanner_statement,
           fetch_scanblock_statement, shutdown_statement, drop_range_statement,
           replay_start_statement, replay_log_statement, replay_commit_statement,
-          cell_interval, cell_predicate, cell_spec;
+          cell_interval, cell_predicate, cell_spec, predicate_filter;
         };
 
       hql_interpreter_state &state;
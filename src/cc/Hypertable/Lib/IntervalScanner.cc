@@ -20,6 +20,7 @@
  */
 
 #include "Common/Compat.h"
+#include <algorithm>
 #include <vector>
 
 #include "Common/Error.h"
@@ -46,15 +47,18 @@ IntervalScanner::IntervalScanner(PropertiesPtr &props_ptr, Comm *comm,
 				 TableIdentifier *table_identifier,
 				 SchemaPtr &schema_ptr,
 				 RangeLocatorPtr &range_locator_ptr,
-				 ScanSpec &scan_spec, int timeout)
+				 ScanSpec &scan_spec, int timeout, bool bulk)
     : m_comm(comm), m_schema_ptr(schema_ptr),
       m_range_locator_ptr(range_locator_ptr),
       m_range_server(comm, HYPERTABLE_CLIENT_TIMEOUT),
       m_table_identifier(*table_identifier), m_started(false),
-      m_eos(false), m_readahead(true), m_fetch_outstanding(false),
+      m_eos(false), m_readahead(true), m_fetch_outstanding(0),
       m_end_inclusive(false), m_rows_seen(0), m_timeout(timeout) {
   const char *start_row, *end_row;
 
+  m_range_server.set_bulk(bulk);
+  m_range_server.set_accept_compressed(props_ptr->get_bool("Hypertable.Client.ScanCompression", true));
+
   if (!scan_spec.row_intervals.empty() && !scan_spec.cell_intervals.empty())
     HT_THROW(Error::RANGESERVER_BAD_SCAN_SPEC,
 	     "ROW predicates and CELL predicates can't be combined");
@@ -68,6 +72,21 @@ IntervalScanner::IntervalScanner(PropertiesPtr &props_ptr, Comm *comm,
 
   m_range_server.set_default_timeout(m_timeout);
 
+  /**
+   * Scans start with small blocks so short scans stay cheap.  Each full
+   * block received doubles the requested size, up to the maximum, so bulk
+   * scans end up bandwidth bound rather than round trip bound.
+   */
+  m_prefetch = props_ptr->get_int("Hypertable.Client.Scanner.Prefetch", 2);
+  m_block_size = props_ptr->get_int("Hypertable.Client.Scanner.BlockSize",
+                                    HYPERTABLE_DATA_TRANSFER_BLOCKSIZE);
+  m_max_block_size = props_ptr->get_int("Hypertable.Client.Scanner.MaxBlockSize",
+                                        1048576);
+  if (m_prefetch < 1)
+    m_prefetch = 1;
+  if (m_max_block_size < m_block_size)
+    m_max_block_size = m_block_size;
+
   m_scan_spec_builder.set_row_limit(scan_spec.row_limit);
   m_scan_spec_builder.set_max_versions(scan_spec.max_versions);
 
@@ -129,6 +148,9 @@ IntervalScanner::IntervalScanner(PropertiesPtr &props_ptr, Comm *comm,
 
   m_scan_spec_builder.set_return_deletes(scan_spec.return_deletes);
 
+  foreach(const CellPredicate &cp, scan_spec.predicates)
+    m_scan_spec_builder.add_predicate(cp.type, cp.pattern);
+
 }
 
 
@@ -137,9 +159,8 @@ IntervalScanner::IntervalScanner(PropertiesPtr &props_ptr, Comm *comm,
  */
 IntervalScanner::~IntervalScanner() {
 
-  // if there is an outstanding fetch, wait for it to come back or timeout
-  if (m_fetch_outstanding)
-    m_sync_handler.wait_for_reply(m_event_ptr);
+  // wait for outstanding fetches to come back or timeout
+  drain_prefetch_pipeline();
 }
 
 
@@ -170,25 +191,32 @@ bool IntervalScanner::next(Cell &cell) {
     }
     else {
       if (m_fetch_outstanding) {
-        if (!m_sync_handler.wait_for_reply(m_event_ptr)) {
-          m_fetch_outstanding = false;
+        bool ok = m_sync_handler.wait_for_reply(m_event_ptr);
+        m_fetch_outstanding--;
+        if (!ok) {
           HT_ERRORF("RangeServer 'fetch scanblock' error : %s", Protocol::string_format_message(m_event_ptr).c_str());
-          HT_THROW((int)Protocol::response_code(m_event_ptr), "");
+          error = (int)Protocol::response_code(m_event_ptr);
+          drain_prefetch_pipeline();
+          HT_THROW(error, "");
+        }
+        error = m_scanblock.load(m_event_ptr);
+        if (m_scanblock.eos()) {
+          // fetches sent past the end of the scan come back as errors
+          drain_prefetch_pipeline();
         }
         else {
-          error = m_scanblock.load(m_event_ptr);
-          if (m_readahead && !m_scanblock.eos()) {
-            m_range_server.fetch_scanblock(m_cur_addr, m_scanblock.get_scanner_id(), &m_sync_handler);
-            m_fetch_outstanding = true;
-          }
-          else
-            m_fetch_outstanding = false;
+          if (m_block_size < m_max_block_size)
+            m_block_size = std::min(m_block_size * 2, m_max_block_size);
+          fill_prefetch_pipeline();
         }
       }
       else {
         timer.start();
         m_range_server.set_timeout((time_t)(timer.remaining() + 0.5));
-        m_range_server.fetch_scanblock(m_cur_addr, m_scanblock.get_scanner_id(), m_scanblock);
+        m_range_server.fetch_scanblock(m_cur_addr, m_scanblock.get_scanner_id(),
+                                       m_scanblock, m_block_size);
+        if (!m_scanblock.eos() && m_block_size < m_max_block_size)
+          m_block_size = std::min(m_block_size * 2, m_max_block_size);
       }
 
     }
@@ -261,6 +289,8 @@ void IntervalScanner::find_range_and_start_scan(const char *row_key, Timer &time
   RangeSpec  range;
   DynamicBuffer dbuf(0);
 
+  drain_prefetch_pipeline();
+
   timer.start();
 
  try_again:
@@ -292,7 +322,9 @@ void IntervalScanner::find_range_and_start_scan(const char *row_key, Timer &time
 
     try {
       m_range_server.set_timeout((time_t)(timer.remaining() + 0.5));
-      m_range_server.create_scanner(m_cur_addr, m_table_identifier, range, m_scan_spec_builder.get(), m_scanblock);
+      m_range_server.create_scanner(m_cur_addr, m_table_identifier, range,
+                                    m_scan_spec_builder.get(), m_scanblock,
+                                    m_block_size);
     }
     catch (Exception &e) {
       double remaining = timer.remaining();
@@ -313,10 +345,33 @@ void IntervalScanner::find_range_and_start_scan(const char *row_key, Timer &time
   }
 
   // maybe kick off readahead
-  if (m_readahead && !m_scanblock.eos()) {
-    m_range_server.fetch_scanblock(m_cur_addr, m_scanblock.get_scanner_id(), &m_sync_handler);
-    m_fetch_outstanding = true;
+  if (!m_scanblock.eos())
+    fill_prefetch_pipeline();
+}
+
+
+
+void IntervalScanner::fill_prefetch_pipeline() {
+  if (!m_readahead)
+    return;
+
+  /**
+   * Fetches for a scanner are sent with the scanner id as their group id,
+   * so the RangeServer handles them one at a time, in order, and the
+   * replies come back in the order they were requested.
+   */
+  while (m_fetch_outstanding < m_prefetch) {
+    m_range_server.fetch_scanblock(m_cur_addr, m_scanblock.get_scanner_id(),
+                                   &m_sync_handler, m_block_size);
+    m_fetch_outstanding++;
+  }
+}
+
+
+
+void IntervalScanner::drain_prefetch_pipeline() {
+  while (m_fetch_outstanding > 0) {
+    m_sync_handler.wait_for_reply(m_event_ptr);
+    m_fetch_outstanding--;
   }
-  else
-    m_fetch_outstanding = false;
 }
@@ -49,8 +49,9 @@ namespace Hypertable {
      * @param range_locator_ptr smart pointer to range locator
      * @param scan_spec reference to scan specification object
      * @param timeout maximum time in seconds to allow scanner methods to execute before throwing an exception
+     * @param bulk if true, scan requests are sent as bulk requests
      */
-    IntervalScanner(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr, ScanSpec &scan_spec, int timeout);
+    IntervalScanner(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr, ScanSpec &scan_spec, int timeout, bool bulk=false);
 
     virtual ~IntervalScanner();
 
@@ -63,6 +64,17 @@ namespace Hypertable {
 
   private:
 
+    /**
+     * Issues asynchronous "fetch scanblock" requests until m_prefetch
+     * requests are outstanding.
+     */
+    void fill_prefetch_pipeline();
+
+    /**
+     * Waits for and discards the replies to all outstanding fetches.
+     */
+    void drain_prefetch_pipeline();
+
     Comm               *m_comm;
     SchemaPtr           m_schema_ptr;
     RangeLocatorPtr     m_range_locator_ptr;
@@ -77,7 +89,10 @@ namespace Hypertable {
     RangeLocationInfo   m_range_info;
     struct sockaddr_in  m_cur_addr;
     bool                m_readahead;
-    bool                m_fetch_outstanding;
+    int                 m_prefetch;
+    int                 m_fetch_outstanding;
+    uint32_t            m_block_size;
+    uint32_t            m_max_block_size;
     DispatchHandlerSynchronizer  m_sync_handler;
     EventPtr            m_event_ptr;
     std::string         m_start_row;
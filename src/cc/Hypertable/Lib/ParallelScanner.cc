@@ -0,0 +1,316 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <algorithm>
+#include <cstring>
+
+#include "Common/Error.h"
+#include "Common/Sweetener.h"
+
+#include "Key.h"
+#include "LocationCache.h"
+#include "ParallelScanner.h"
+
+using namespace Hypertable;
+
+
+ParallelScanner::ParallelScanner(PropertiesPtr &props_ptr, Comm *comm,
+                                 TableIdentifier *table_identifier,
+                                 SchemaPtr &schema_ptr,
+                                 RangeLocatorPtr &range_locator_ptr,
+                                 ScanSpec &scan_spec, int timeout, bool bulk,
+                                 int parallelism, bool ordered)
+  : m_next_piece(0), m_current(0), m_pieces_done(0), m_ordered(ordered),
+    m_cancelled(false), m_error(Error::OK), m_batch(0), m_batch_pos(0) {
+  ScanSpec piece_spec;
+  Timer timer(timeout, true);
+
+  if (!scan_spec.cell_intervals.empty()) {
+    for (size_t i=0; i<scan_spec.cell_intervals.size(); i++) {
+      scan_spec.base_copy(piece_spec);
+      piece_spec.cell_intervals.push_back(scan_spec.cell_intervals[i]);
+      add_piece(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, piece_spec, timeout, bulk);
+    }
+  }
+  else if (!scan_spec.row_intervals.empty()) {
+    for (size_t i=0; i<scan_spec.row_intervals.size(); i++)
+      add_row_interval_pieces(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr,
+                              scan_spec, scan_spec.row_intervals[i], timeout, bulk, timer);
+  }
+  else {
+    RowInterval ri;
+    ri.start = "";
+    ri.start_inclusive = false;
+    ri.end = Key::END_ROW_MARKER;
+    ri.end_inclusive = false;
+    add_row_interval_pieces(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr,
+                            scan_spec, ri, timeout, bulk, timer);
+  }
+
+  if (parallelism < 1)
+    parallelism = 1;
+  m_max_ready = MAX_BATCHES * parallelism;
+
+  size_t worker_count = std::min((size_t)parallelism, m_pieces.size());
+  for (size_t i=0; i<worker_count; i++)
+    m_threads.create_thread(Worker(this));
+}
+
+
+ParallelScanner::~ParallelScanner() {
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_cancelled = true;
+    m_cond.notify_all();
+  }
+  m_threads.join_all();
+
+  delete m_batch;
+  for (size_t i=0; i<m_pieces.size(); i++) {
+    foreach(Batch *batch, m_pieces[i].batches)
+      delete batch;
+  }
+  foreach(Batch *batch, m_ready)
+    delete batch;
+}
+
+
+bool ParallelScanner::next(Cell &cell) {
+
+  while (true) {
+
+    if (m_batch) {
+      if (m_batch_pos < m_batch->cells.size()) {
+        m_batch->get(m_batch_pos++, cell);
+        return true;
+      }
+      delete m_batch;
+      m_batch = 0;
+    }
+
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    while (true) {
+      if (m_error != Error::OK)
+        HT_THROW(m_error, m_error_msg);
+      if (m_ordered) {
+        if (m_current == m_pieces.size())
+          return false;
+        Piece &piece = m_pieces[m_current];
+        if (!piece.batches.empty()) {
+          m_batch = piece.batches.front();
+          piece.batches.pop_front();
+          break;
+        }
+        if (piece.done) {
+          m_current++;
+          continue;
+        }
+      }
+      else {
+        if (!m_ready.empty()) {
+          m_batch = m_ready.front();
+          m_ready.pop_front();
+          break;
+        }
+        if (m_pieces_done == m_pieces.size())
+          return false;
+      }
+      m_cond.wait(lock);
+    }
+
+    m_batch_pos = 0;
+    m_cond.notify_all();
+  }
+}
+
+
+/**
+ * Cuts a row interval at the end rows of the ranges it covers.  The first
+ * piece keeps the interval's start row, the last one its end row, and the
+ * others run from one range end row (exclusive) to the next (inclusive).
+ */
+void ParallelScanner::add_row_interval_pieces(PropertiesPtr &props_ptr, Comm *comm,
+    TableIdentifier *table_identifier, SchemaPtr &schema_ptr,
+    RangeLocatorPtr &range_locator_ptr, ScanSpec &scan_spec,
+    const RowInterval &ri, int timeout, bool bulk, Timer &timer) {
+  LocationCachePtr cache_ptr;
+  RangeLocationInfo range_info;
+  String start = (ri.start == 0) ? "" : ri.start;
+  String end = (ri.end == 0) ? Key::END_ROW_MARKER : ri.end;
+  bool start_inclusive = ri.start_inclusive;
+  String row = start;
+  ScanSpec piece_spec;
+  RowInterval piece;
+
+  range_locator_ptr->get_location_cache(cache_ptr);
+
+  while (true) {
+    if (!cache_ptr->lookup(table_identifier->id, row.c_str(), &range_info))
+      range_locator_ptr->find_loop(table_identifier, row.c_str(), &range_info, timer, false);
+
+    scan_spec.base_copy(piece_spec);
+    piece.start = start.c_str();
+    piece.start_inclusive = start_inclusive;
+
+    if (range_info.end_row.compare(end) >= 0) {
+      piece.end = end.c_str();
+      piece.end_inclusive = ri.end_inclusive;
+      piece_spec.row_intervals.push_back(piece);
+      add_piece(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, piece_spec, timeout, bulk);
+      break;
+    }
+
+    piece.end = range_info.end_row.c_str();
+    piece.end_inclusive = true;
+    piece_spec.row_intervals.push_back(piece);
+    add_piece(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, piece_spec, timeout, bulk);
+
+    start = range_info.end_row;
+    start_inclusive = false;
+    row = range_info.end_row;
+    row.append(1, 1);  // construct row key in next range
+  }
+}
+
+
+void ParallelScanner::add_piece(PropertiesPtr &props_ptr, Comm *comm,
+    TableIdentifier *table_identifier, SchemaPtr &schema_ptr,
+    RangeLocatorPtr &range_locator_ptr, ScanSpec &piece_spec, int timeout,
+    bool bulk) {
+  m_pieces.push_back(Piece());
+  m_pieces.back().scanner = new IntervalScanner(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, piece_spec, timeout, bulk);
+}
+
+
+void ParallelScanner::scan_piece(size_t i) {
+  Batch *batch = new Batch();
+  Cell cell;
+
+  try {
+    while (m_pieces[i].scanner->next(cell)) {
+      batch->add(cell);
+      if (batch->data.fill() >= BATCH_BYTES) {
+        if (!enqueue(i, batch))
+          return;
+        batch = new Batch();
+      }
+    }
+    if (batch->cells.empty())
+      delete batch;
+    else if (!enqueue(i, batch))
+      return;
+  }
+  catch (Exception &e) {
+    delete batch;
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_error == Error::OK) {
+      m_error = e.code();
+      m_error_msg = e.what();
+    }
+    m_cond.notify_all();
+    return;
+  }
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_pieces[i].done = true;
+  m_pieces_done++;
+  m_cond.notify_all();
+}
+
+
+/**
+ * Queues a batch, waiting while the queue is full.  In ordered mode each
+ * piece has its own queue; the piece being returned is always being scanned
+ * or done, since pieces are handed out in order, so this cannot deadlock.
+ *
+ * @return false if the scan was cancelled (the batch is freed)
+ */
+bool ParallelScanner::enqueue(size_t i, Batch *batch) {
+  boost::mutex::scoped_lock lock(m_mutex);
+  std::deque<Batch *> &queue = m_ordered ? m_pieces[i].batches : m_ready;
+  size_t limit = m_ordered ? (size_t)MAX_BATCHES : m_max_ready;
+
+  while (!m_cancelled && queue.size() >= limit)
+    m_cond.wait(lock);
+
+  if (m_cancelled) {
+    delete batch;
+    return false;
+  }
+  queue.push_back(batch);
+  m_cond.notify_all();
+  return true;
+}
+
+
+void ParallelScanner::Worker::operator()() {
+  size_t i;
+
+  while (true) {
+    {
+      boost::mutex::scoped_lock lock(m_scanner->m_mutex);
+      if (m_scanner->m_cancelled || m_scanner->m_error != Error::OK ||
+          m_scanner->m_next_piece == m_scanner->m_pieces.size())
+        return;
+      i = m_scanner->m_next_piece++;
+    }
+    m_scanner->scan_piece(i);
+  }
+}
+
+
+void ParallelScanner::Batch::add(const Cell &cell) {
+  Slot slot;
+  size_t row_len = strlen(cell.row_key) + 1;
+  size_t cq_len = cell.column_qualifier ? strlen(cell.column_qualifier) + 1 : 0;
+
+  data.ensure(row_len + cq_len + cell.value_len);
+
+  slot.row_key = data.fill();
+  data.add_unchecked(cell.row_key, row_len);
+  slot.column_family = cell.column_family;
+  slot.column_qualifier = data.fill();
+  if (cell.column_qualifier)
+    data.add_unchecked(cell.column_qualifier, cq_len);
+  else
+    slot.column_qualifier = (size_t)-1;
+  slot.timestamp = cell.timestamp;
+  slot.value = data.fill();
+  if (cell.value_len)
+    data.add_unchecked(cell.value, cell.value_len);
+  slot.value_len = cell.value_len;
+  slot.flag = cell.flag;
+  cells.push_back(slot);
+}
+
+
+void ParallelScanner::Batch::get(size_t i, Cell &cell) {
+  Slot &slot = cells[i];
+  cell.row_key = (const char *)data.base + slot.row_key;
+  cell.column_family = slot.column_family;
+  cell.column_qualifier = (slot.column_qualifier == (size_t)-1) ? 0 : (const char *)data.base + slot.column_qualifier;
+  cell.timestamp = slot.timestamp;
+  cell.value = data.base + slot.value;
+  cell.value_len = slot.value_len;
+  cell.flag = slot.flag;
+}
@@ -0,0 +1,129 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_PARALLELSCANNER_H
+#define HYPERTABLE_PARALLELSCANNER_H
+
+#include <deque>
+#include <vector>
+
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "Common/DynamicBuffer.h"
+#include "Common/Properties.h"
+#include "Common/ReferenceCount.h"
+#include "Common/Thread.h"
+
+#include "Cell.h"
+#include "IntervalScanner.h"
+#include "RangeLocator.h"
+#include "Schema.h"
+#include "Types.h"
+
+namespace Hypertable {
+
+  /**
+   * Scans the pieces of a scan in parallel.  Row intervals (or the whole
+   * table) are cut at the range boundaries known when the scan starts, each
+   * piece gets its own IntervalScanner, and up to parallelism pieces are
+   * scanned at once by worker threads.  Workers copy the cells into batches
+   * and queue them, a bounded number per piece.
+   *
+   * In ordered mode cells come back in the same order as a sequential scan:
+   * the pieces are handed to workers in order, and the caller drains them
+   * in order while later pieces fill their queues.  In unordered mode
+   * batches are returned as soon as any worker queues one.
+   */
+  class ParallelScanner : public ReferenceCount {
+
+  public:
+    ParallelScanner(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr, ScanSpec &scan_spec, int timeout, bool bulk, int parallelism, bool ordered);
+
+    /**
+     * Stops the workers and destroys any batches not returned yet
+     */
+    virtual ~ParallelScanner();
+
+    bool next(Cell &cell);
+
+  private:
+
+    enum { BATCH_BYTES = 65536, MAX_BATCHES = 4 };
+
+    /** Cells copied out of a scan block.  Strings are offsets into data. */
+    struct Batch {
+      Batch() : data(BATCH_BYTES) { return; }
+      struct Slot {
+        size_t row_key;
+        const char *column_family;
+        size_t column_qualifier;
+        uint64_t timestamp;
+        size_t value;
+        uint32_t value_len;
+        uint8_t flag;
+      };
+      DynamicBuffer     data;
+      std::vector<Slot> cells;
+      void add(const Cell &cell);
+      void get(size_t i, Cell &cell);
+    };
+
+    struct Piece {
+      Piece() : done(false) { return; }
+      IntervalScannerPtr   scanner;
+      std::deque<Batch *>  batches;
+      bool                 done;
+    };
+
+    class Worker {
+    public:
+      Worker(ParallelScanner *scanner) : m_scanner(scanner) { }
+      void operator()();
+    private:
+      ParallelScanner *m_scanner;
+    };
+
+    void add_row_interval_pieces(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr, ScanSpec &scan_spec, const RowInterval &ri, int timeout, bool bulk, Timer &timer);
+    void add_piece(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr, ScanSpec &piece_spec, int timeout, bool bulk);
+    void scan_piece(size_t i);
+    bool enqueue(size_t i, Batch *batch);
+
+    boost::mutex         m_mutex;
+    boost::condition     m_cond;
+    std::vector<Piece>   m_pieces;
+    std::deque<Batch *>  m_ready;
+    size_t               m_next_piece;
+    size_t               m_current;
+    size_t               m_pieces_done;
+    bool                 m_ordered;
+    bool                 m_cancelled;
+    int                  m_error;
+    String               m_error_msg;
+    Batch               *m_batch;
+    size_t               m_batch_pos;
+    size_t               m_max_ready;
+    ThreadGroup          m_threads;
+  };
+  typedef boost::intrusive_ptr<ParallelScanner> ParallelScannerPtr;
+}
+
+#endif // HYPERTABLE_PARALLELSCANNER_H
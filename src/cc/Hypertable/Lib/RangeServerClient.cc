@@ -30,7 +30,7 @@
 using namespace Hypertable;
 
 
-RangeServerClient::RangeServerClient(Comm *comm, time_t timeout) : m_comm(comm), m_default_timeout(timeout), m_timeout(0) {
+RangeServerClient::RangeServerClient(Comm *comm, time_t timeout) : m_comm(comm), m_default_timeout(timeout), m_timeout(0), m_bulk(false), m_update_group_id(0), m_accept_compressed(false) {
 }
 
 
@@ -55,7 +55,7 @@ void RangeServerClient::load_range(struct sockaddr_in &addr, TableIdentifier &ta
 
 
 void RangeServerClient::update(struct sockaddr_in &addr, TableIdentifier &table, StaticBuffer &buffer, DispatchHandler *handler) {
-  CommBufPtr cbp(RangeServerProtocol::create_request_update(table, buffer));
+  CommBufPtr cbp(create_update_message(addr, table, buffer));
   send_message(addr, cbp, handler);
 }
 
@@ -63,25 +63,27 @@ void RangeServerClient::update(struct sockaddr_in &addr, TableIdentifier &table,
 void RangeServerClient::update(struct sockaddr_in &addr, TableIdentifier &table, StaticBuffer &buffer) {
   DispatchHandlerSynchronizer sync_handler;
   EventPtr event_ptr;
-  CommBufPtr cbp(RangeServerProtocol::create_request_update(table, buffer));
+  CommBufPtr cbp(create_update_message(addr, table, buffer));
   send_message(addr, cbp, &sync_handler);
   if (!sync_handler.wait_for_reply(event_ptr))
     HT_THROW((int)Protocol::response_code(event_ptr),
              String("RangeServer update() failure : ") + Protocol::string_format_message(event_ptr));
+  WireCompressor::set_peer_accepts(addr,
+      (event_ptr->header->flags & Header::FLAGS_BIT_ACCEPTS_COMPRESSED) != 0);
 }
 
 
 
-void RangeServerClient::create_scanner(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec, DispatchHandler *handler) {
-  CommBufPtr cbp(RangeServerProtocol::create_request_create_scanner(table, range, scan_spec));
+void RangeServerClient::create_scanner(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec, DispatchHandler *handler, uint32_t block_size) {
+  CommBufPtr cbp(RangeServerProtocol::create_request_create_scanner(table, range, scan_spec, block_size, m_accept_compressed));
   send_message(addr, cbp, handler);
 }
 
 
-void RangeServerClient::create_scanner(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec, ScanBlock &scan_block) {
+void RangeServerClient::create_scanner(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec, ScanBlock &scan_block, uint32_t block_size) {
   DispatchHandlerSynchronizer sync_handler;
   EventPtr event_ptr;
-  CommBufPtr cbp(RangeServerProtocol::create_request_create_scanner(table, range, scan_spec));
+  CommBufPtr cbp(RangeServerProtocol::create_request_create_scanner(table, range, scan_spec, block_size, m_accept_compressed));
   send_message(addr, cbp, &sync_handler);
   if (!sync_handler.wait_for_reply(event_ptr))
     HT_THROW((int)Protocol::response_code(event_ptr),
@@ -109,16 +111,16 @@ void RangeServerClient::destroy_scanner(struct sockaddr_in &addr, int scanner_id
 }
 
 
-void RangeServerClient::fetch_scanblock(struct sockaddr_in &addr, int scanner_id, DispatchHandler *handler) {
-  CommBufPtr cbp(RangeServerProtocol::create_request_fetch_scanblock(scanner_id));
+void RangeServerClient::fetch_scanblock(struct sockaddr_in &addr, int scanner_id, DispatchHandler *handler, uint32_t block_size) {
+  CommBufPtr cbp(RangeServerProtocol::create_request_fetch_scanblock(scanner_id, block_size, m_accept_compressed));
   send_message(addr, cbp, handler);
 }
 
 
-void RangeServerClient::fetch_scanblock(struct sockaddr_in &addr, int scanner_id, ScanBlock &scan_block) {
+void RangeServerClient::fetch_scanblock(struct sockaddr_in &addr, int scanner_id, ScanBlock &scan_block, uint32_t block_size) {
   DispatchHandlerSynchronizer sync_handler;
   EventPtr event_ptr;
-  CommBufPtr cbp(RangeServerProtocol::create_request_fetch_scanblock(scanner_id));
+  CommBufPtr cbp(RangeServerProtocol::create_request_fetch_scanblock(scanner_id, block_size, m_accept_compressed));
   send_message(addr, cbp, &sync_handler);
   if (!sync_handler.wait_for_reply(event_ptr))
     HT_THROW((int)Protocol::response_code(event_ptr),
@@ -215,15 +217,45 @@ void RangeServerClient::drop_range(struct sockaddr_in &addr, TableIdentifier &ta
 }
 
 
+void RangeServerClient::drop_range(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range) {
+  DispatchHandlerSynchronizer sync_handler;
+  EventPtr event_ptr;
+  CommBufPtr cbp(RangeServerProtocol::create_request_drop_range(table, range));
+  send_message(addr, cbp, &sync_handler);
+  if (!sync_handler.wait_for_reply(event_ptr))
+    HT_THROW((int)Protocol::response_code(event_ptr),
+             String("RangeServer drop_range() failure : ") + Protocol::string_format_message(event_ptr));
+}
+
+
 
 /**
- *
+ * Builds an update message, compressing the payload if there is a
+ * compressor, the server has advertised that it takes compressed updates
+ * and compression makes the payload smaller.  A compressed payload
+ * replaces the buffer, which is freed if the message owns it.
  */
+CommBuf *RangeServerClient::create_update_message(struct sockaddr_in &addr, TableIdentifier &table, StaticBuffer &buffer) {
+  DynamicBuffer zbuf;
+
+  if (m_compressor && WireCompressor::peer_accepts(addr) &&
+      m_compressor->compress(buffer.base, buffer.size, zbuf)) {
+    StaticBuffer zsb(zbuf);
+    if (buffer.own)
+      buffer.free();
+    return RangeServerProtocol::create_request_update(table, zsb, true, m_update_group_id);
+  }
+  return RangeServerProtocol::create_request_update(table, buffer, false, m_update_group_id);
+}
+
+
 void RangeServerClient::send_message(struct sockaddr_in &addr, CommBufPtr &cbp, DispatchHandler *handler) {
   int error;
   time_t timeout = (m_timeout == 0) ? m_default_timeout : m_timeout;
 
   m_timeout = 0;
+  if (m_bulk)
+    ((Header::Common *)cbp->data.base)->flags |= Header::FLAGS_BIT_BULK;
   if ((error = m_comm->send_request(addr, timeout, cbp, handler)) != Error::OK) {
     HT_WARNF("Comm::send_request to %s:%d failed - %s",
                 inet_ntoa(addr.sin_addr), ntohs(addr.sin_port), Error::get_text(error));
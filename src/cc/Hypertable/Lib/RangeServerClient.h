@@ -36,6 +36,7 @@
 #include "RangeState.h"
 #include "Types.h"
 #include "Stat.h"
+#include "WireCompressor.h"
 
 
 namespace Hypertable {
@@ -61,6 +62,35 @@ namespace Hypertable {
      */
     void set_timeout(time_t timeout) { m_timeout = timeout; }
 
+    /** Marks subsequent requests as bulk work (see Header::FLAGS_BIT_BULK),
+     * which the RangeServer runs behind interactive requests
+     *
+     * @param bulk true to mark requests as bulk
+     */
+    void set_bulk(bool bulk) { m_bulk = bulk; }
+
+    /** Sets the group ID of subsequent update requests.  A RangeServer
+     * applies updates with the same non-zero group ID that arrive over one
+     * connection one at a time, in the order they were sent.
+     *
+     * @param gid group ID, or 0 for none
+     */
+    void set_update_group_id(uint32_t gid) { m_update_group_id = gid; }
+
+    /** Sets the compressor for update payloads.  Payloads it manages to
+     * shrink are sent compressed.
+     *
+     * @param compressor update payload compressor, or 0 to send them raw
+     */
+    void set_compressor(WireCompressorPtr &compressor) { m_compressor = compressor; }
+
+    /** Lets the RangeServer return compressed scan blocks to subsequent
+     * create scanner and fetch scanblock requests
+     *
+     * @param accept true to accept compressed scan blocks
+     */
+    void set_accept_compressed(bool accept) { m_accept_compressed = accept; }
+
     /** Issues a "load range" request asynchronously.
      *
      * @param addr remote address of RangeServer connection
@@ -110,8 +140,10 @@ namespace Hypertable {
      * @param range range specification
      * @param scan_spec scan specification
      * @param handler response handler
+     * @param block_size requested scan block size, or 0 for the server
+     *        default
      */
-    void create_scanner(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec, DispatchHandler *handler);
+    void create_scanner(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec, DispatchHandler *handler, uint32_t block_size=0);
 
     /** Issues a "create scanner" request.
      *
@@ -120,8 +152,10 @@ namespace Hypertable {
      * @param range range specification
      * @param scan_spec scan specification
      * @param scan_block block of return key/value pairs
+     * @param block_size requested scan block size, or 0 for the server
+     *        default
      */
-    void create_scanner(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec, ScanBlock &scan_block);
+    void create_scanner(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec, ScanBlock &scan_block, uint32_t block_size=0);
 
     /** Issues a "destroy scanner" request asynchronously.
      *
@@ -143,16 +177,20 @@ namespace Hypertable {
      * @param addr remote address of RangeServer connection
      * @param scanner_id Scanner ID returned from a call to create_scanner.
      * @param handler response handler
+     * @param block_size requested scan block size, or 0 for the server
+     *        default
      */
-    void fetch_scanblock(struct sockaddr_in &addr, int scanner_id, DispatchHandler *handler);
+    void fetch_scanblock(struct sockaddr_in &addr, int scanner_id, DispatchHandler *handler, uint32_t block_size=0);
 
     /** Issues a "fetch scanblock" request.
      *
      * @param addr remote address of RangeServer connection
      * @param scanner_id scanner ID returned from a call to create_scanner.
      * @param scan_block block of return key/value pairs
+     * @param block_size requested scan block size, or 0 for the server
+     *        default
      */
-    void fetch_scanblock(struct sockaddr_in &addr, int scanner_id, ScanBlock &scan_block);
+    void fetch_scanblock(struct sockaddr_in &addr, int scanner_id, ScanBlock &scan_block, uint32_t block_size=0);
 
     /** Issues a "drop table" request asynchronously.
      *
@@ -220,7 +258,7 @@ namespace Hypertable {
      */
     void replay_commit(struct sockaddr_in &addr, DispatchHandler *handler);
 
-    /** Issues a "load range" request asynchronously.
+    /** Issues a "drop range" request asynchronously.
      *
      * @param addr remote address of RangeServer connection
      * @param table table identifier
@@ -229,13 +267,27 @@ namespace Hypertable {
      */
     void drop_range(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range, DispatchHandler *handler);
 
+    /** Issues a "drop range" request.  The server flushes the range to
+     * disk and stops serving it, so it can then be loaded elsewhere.
+     *
+     * @param addr remote address of RangeServer connection
+     * @param table table identifier
+     * @param range range specification
+     */
+    void drop_range(struct sockaddr_in &addr, TableIdentifier &table, RangeSpec &range);
+
   private:
 
+    CommBuf *create_update_message(struct sockaddr_in &addr, TableIdentifier &table, StaticBuffer &buffer);
     void send_message(struct sockaddr_in &addr, CommBufPtr &cbp, DispatchHandler *handler);
 
     Comm *m_comm;
     time_t m_default_timeout;
     time_t m_timeout;
+    bool m_bulk;
+    uint32_t m_update_group_id;
+    WireCompressorPtr m_compressor;
+    bool m_accept_compressed;
   };
 
   typedef boost::intrusive_ptr<RangeServerClient> RangeServerClientPtr;
@@ -118,7 +118,18 @@ void load_entry(Reader &rd, RsiSet &rsi_set, MovePrepared *ep) {
 }
 
 void load_entry(Reader &rd, RsiSet &rsi_set, MoveDone *ep) {
-  // TODO
+  // the range was relinquished to another server
+  RangeStateInfo ri(ep->table, ep->range);
+  RsiSet::iterator it = rsi_set.find(&ri);
+
+  if (it == rsi_set.end()) {
+    HT_WARN_OUT <<"Move done entry for unknown range in: "<< rd.path()
+                << " at "<< rd.pos() <<"/"<< rd.size() <<'\n'
+                << ep->table << ep->range << HT_END;
+    return;
+  }
+  delete *it;
+  rsi_set.erase(it);
 }
 
 void load_entry(Reader &rd, RsiSet &rsi_set, DropTable *ep) {
@@ -66,21 +66,25 @@ namespace Hypertable {
     return cbuf;
   }
 
-  CommBuf *RangeServerProtocol::create_request_update(TableIdentifier &table, StaticBuffer &buffer) {
-    HeaderBuilder hbuilder(Header::PROTOCOL_HYPERTABLE_RANGESERVER);
+  CommBuf *RangeServerProtocol::create_request_update(TableIdentifier &table, StaticBuffer &buffer, bool compressed, uint32_t gid) {
+    HeaderBuilder hbuilder(Header::PROTOCOL_HYPERTABLE_RANGESERVER, gid);
+    if (compressed)
+      hbuilder.add_flag(Header::FLAGS_BIT_COMPRESSED);
     CommBuf *cbuf = new CommBuf(hbuilder, 2 + table.encoded_length(), buffer);
     cbuf->append_i16(COMMAND_UPDATE);
     table.encode(cbuf->get_data_ptr_address());
     return cbuf;
   }
 
-  CommBuf *RangeServerProtocol::create_request_create_scanner(TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec) {
+  CommBuf *RangeServerProtocol::create_request_create_scanner(TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec, uint32_t block_size, bool accept_compressed) {
     HeaderBuilder hbuilder(Header::PROTOCOL_HYPERTABLE_RANGESERVER);
-    CommBuf *cbuf = new CommBuf(hbuilder, 2 + table.encoded_length() + range.encoded_length() + scan_spec.encoded_length());
+    CommBuf *cbuf = new CommBuf(hbuilder, 7 + table.encoded_length() + range.encoded_length() + scan_spec.encoded_length());
     cbuf->append_i16(COMMAND_CREATE_SCANNER);
     table.encode(cbuf->get_data_ptr_address());
     range.encode(cbuf->get_data_ptr_address());
     scan_spec.encode(cbuf->get_data_ptr_address());
+    cbuf->append_i32(block_size);
+    cbuf->append_bool(accept_compressed);
     return cbuf;
   }
 
@@ -92,11 +96,13 @@ namespace Hypertable {
     return cbuf;
   }
 
-  CommBuf *RangeServerProtocol::create_request_fetch_scanblock(int scanner_id) {
+  CommBuf *RangeServerProtocol::create_request_fetch_scanblock(int scanner_id, uint32_t block_size, bool accept_compressed) {
     HeaderBuilder hbuilder(Header::PROTOCOL_HYPERTABLE_RANGESERVER, scanner_id);
-    CommBuf *cbuf = new CommBuf(hbuilder, 6);
+    CommBuf *cbuf = new CommBuf(hbuilder, 11);
     cbuf->append_i16(COMMAND_FETCH_SCANBLOCK);
     cbuf->append_i32(scanner_id);
+    cbuf->append_i32(block_size);
+    cbuf->append_bool(accept_compressed);
     return cbuf;
   }
 
@@ -77,18 +77,26 @@ namespace Hypertable {
      *
      * @param table table identifier
      * @param buffer buffer holding key/value pairs
+     * @param compressed true if buffer holds the key/value pairs compressed
+     *        by WireCompressor; sets Header::FLAGS_BIT_COMPRESSED
+     * @param gid group ID; updates with the same (non-zero) group ID sent
+     *        over one connection are applied in the order they were sent
      * @return protocol message
      */
-    static CommBuf *create_request_update(TableIdentifier &table, StaticBuffer &buffer);
+    static CommBuf *create_request_update(TableIdentifier &table, StaticBuffer &buffer, bool compressed=false, uint32_t gid=0);
 
     /** Creates a "create scanner" request message.
      *
      * @param table table identifier
      * @param range range specification
      * @param scan_spec scan specification
+     * @param block_size requested size of the returned scan block, or 0 for
+     *        the server default
+     * @param accept_compressed if true, the server may return a compressed
+     *        scan block
      * @return protocol message
      */
-    static CommBuf *create_request_create_scanner(TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec);
+    static CommBuf *create_request_create_scanner(TableIdentifier &table, RangeSpec &range, ScanSpec &scan_spec, uint32_t block_size=0, bool accept_compressed=false);
 
     /** Creates a "destroy scanner" request message.
      *
@@ -100,9 +108,13 @@ namespace Hypertable {
     /** Creates a "fetch scanblock" request message.
      *
      * @param scanner_id scanner ID returned from a "create scanner" request
+     * @param block_size requested size of the returned scan block, or 0 for
+     *        the server default
+     * @param accept_compressed if true, the server may return a compressed
+     *        scan block
      * @return protocol message
      */
-    static CommBuf *create_request_fetch_scanblock(int scanner_id);
+    static CommBuf *create_request_fetch_scanblock(int scanner_id, uint32_t block_size=0, bool accept_compressed=false);
 
     /** Creates a "status" request message.
      *
@@ -27,6 +27,7 @@
 #include "Common/Serialization.h"
 
 #include "ScanBlock.h"
+#include "WireCompressor.h"
 
 using namespace Hypertable;
 using namespace Serialization;
@@ -59,6 +60,11 @@ int ScanBlock::load(EventPtr &event_ptr) {
     m_flags = decode_i16(&msg, &remaining);
     m_scanner_id = decode_i32(&msg, &remaining);
     len = decode_i32(&msg, &remaining);
+    if (m_flags & FLAG_COMPRESSED) {
+      WireCompressor::decompress(msg, len, m_inflated);
+      msg = m_inflated.base;
+      len = m_inflated.fill();
+    }
   }
   catch (Exception &e) {
     HT_ERROR_OUT << e << HT_END;
@@ -26,6 +26,7 @@
 
 #include "AsyncComm/Event.h"
 #include "Common/ByteString.h"
+#include "Common/DynamicBuffer.h"
 
 namespace Hypertable {
 
@@ -39,6 +40,10 @@ namespace Hypertable {
 
     typedef std::vector< std::pair<ByteString, ByteString> > Vector;
 
+    /** Bits of the flags field that precedes the scanner ID.  With
+     * FLAG_COMPRESSED the block data is a WireCompressor block. */
+    enum { FLAG_EOS = 0x0001, FLAG_COMPRESSED = 0x0002 };
+
     ScanBlock();
 
     /** Loads scanblock data returned from RangeServer.  Both the CREATE_SCANNER and
@@ -71,7 +76,7 @@ namespace Hypertable {
      *
      * @return true if this is the final scanblock, or false if more to come
      */
-    bool eos() { return ((m_flags & 0x0001) == 0x0001); }
+    bool eos() { return ((m_flags & FLAG_EOS) == FLAG_EOS); }
 
     /** Indicates whether or not there are more key/value pairs in block
      *
@@ -96,6 +101,7 @@ namespace Hypertable {
     Vector m_vec;
     Vector::iterator m_iter;
     EventPtr m_event_ptr;
+    DynamicBuffer m_inflated;
   };
 }
 
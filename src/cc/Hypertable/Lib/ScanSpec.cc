@@ -84,6 +84,22 @@ void CellInterval::decode(const uint8_t **bufp, size_t *remainp) {
     end_inclusive = decode_bool(bufp, remainp));
 }
 
+size_t CellPredicate::encoded_length() const {
+  return 1 + encoded_length_vstr(pattern);
+}
+
+void CellPredicate::encode(uint8_t **bufp) const {
+  encode_i8(bufp, type);
+  encode_vstr(bufp, pattern);
+}
+
+
+void CellPredicate::decode(const uint8_t **bufp, size_t *remainp) {
+  HT_TRY("decoding cell predicate",
+    type = decode_i8(bufp, remainp);
+    pattern = decode_vstr(bufp, remainp));
+}
+
 ScanSpec::ScanSpec() : row_limit(0), max_versions(0),
        time_interval(0, END_OF_TIME), return_deletes(false) {
 }
@@ -93,10 +109,12 @@ size_t ScanSpec::encoded_length() const {
                encoded_length_vi32(max_versions) +
                encoded_length_vi32(columns.size()) +
                encoded_length_vi32(row_intervals.size()) +
-               encoded_length_vi32(cell_intervals.size());
+               encoded_length_vi32(cell_intervals.size()) +
+               encoded_length_vi32(predicates.size());
   foreach(const char *c, columns) len += encoded_length_vstr(c);
   foreach(const RowInterval &ri, row_intervals) len += ri.encoded_length();
   foreach(const CellInterval &ci, cell_intervals) len += ci.encoded_length();
+  foreach(const CellPredicate &cp, predicates) len += cp.encoded_length();
   return len + 8 + 8 + 1;
 }
 
@@ -112,11 +130,14 @@ void ScanSpec::encode(uint8_t **bufp) const {
   encode_i64(bufp, time_interval.first);
   encode_i64(bufp, time_interval.second);
   encode_bool(bufp, return_deletes);
+  encode_vi32(bufp, predicates.size());
+  foreach(const CellPredicate &cp, predicates) cp.encode(bufp);
 }
 
 void ScanSpec::decode(const uint8_t **bufp, size_t *remainp) {
   RowInterval ri;
   CellInterval ci;
+  CellPredicate cp;
   HT_TRY("decoding scan spec",
     row_limit = decode_vi32(bufp, remainp);
     max_versions = decode_vi32(bufp, remainp);
@@ -132,7 +153,14 @@ void ScanSpec::decode(const uint8_t **bufp, size_t *remainp) {
     }
     time_interval.first = decode_i64(bufp, remainp);
     time_interval.second = decode_i64(bufp, remainp);
-    return_deletes = decode_i8(bufp, remainp));
+    return_deletes = decode_i8(bufp, remainp);
+    // older clients end the scan spec here
+    if (*remainp > 0) {
+      for (size_t ncp = decode_vi32(bufp, remainp); ncp--;) {
+        cp.decode(bufp, remainp);
+        predicates.push_back(cp);
+      }
+    });
 }
 
 
@@ -181,6 +209,17 @@ ostream &Hypertable::operator<<(ostream &os, const CellInterval &ci) {
 }
 
 
+ostream &Hypertable::operator<<(ostream &os, const CellPredicate &cp) {
+  static const char *names[] = { "?", "value ==", "value starts with",
+      "value regexp", "qualifier starts with", "qualifier regexp",
+      "row regexp" };
+  os <<"{CellPredicate: "
+     << ((cp.type <= CellPredicate::ROW_REGEX) ? names[cp.type] : names[0])
+     << " \"" << (cp.pattern ? cp.pattern : "") << "\"}";
+  return os;
+}
+
+
 ostream &Hypertable::operator<<(ostream &os, const ScanSpec &scan_spec) {
   os <<"\n{ScanSpec: row_limit="<< scan_spec.row_limit
      <<" max_versions="<< scan_spec.max_versions;
@@ -204,6 +243,12 @@ ostream &Hypertable::operator<<(ostream &os, const ScanSpec &scan_spec) {
     os <<')';
   }
 
+  if (!scan_spec.predicates.empty()) {
+    os << "\n predicates=";
+    foreach(const CellPredicate &cp, scan_spec.predicates)
+      os << " " << cp;
+  }
+
   os <<"\n time_interval=(" << scan_spec.time_interval.first <<", "
      << scan_spec.time_interval.second <<")\n}\n";
   return os;
@@ -70,6 +70,38 @@ namespace Hypertable {
   };
   
 
+  /**
+   * Represents a cell filter that is evaluated by the RangeServer.  A cell
+   * is returned only if it satisfies every predicate in the ScanSpec.
+   * Regular expressions are POSIX extended regular expressions and value
+   * patterns can't contain NUL characters.  c-string data members are not
+   * managed so caller must handle deallocation.
+   */
+  class CellPredicate {
+  public:
+    enum {
+      VALUE_EQUALS = 1,
+      VALUE_PREFIX,
+      VALUE_REGEX,
+      QUALIFIER_PREFIX,
+      QUALIFIER_REGEX,
+      ROW_REGEX
+    };
+
+    CellPredicate() : type(0), pattern(0) { }
+    CellPredicate(uint8_t type_, const char *pattern_)
+      : type(type_), pattern(pattern_) { }
+    CellPredicate(const uint8_t **bufp, size_t *remainp) { decode(bufp, remainp); }
+
+    size_t encoded_length() const;
+    void encode(uint8_t **bufp) const;
+    void decode(const uint8_t **bufp, size_t *remainp);
+
+    uint8_t type;
+    const char *pattern;
+  };
+
+
   /**
    * Represents a scan predicate.
    */
@@ -90,6 +122,7 @@ namespace Hypertable {
       cell_intervals.clear();
       time_interval.first = time_interval.second = 0;
       return_deletes = 0;
+      predicates.clear();
     }
 
     void base_copy(ScanSpec &other) {
@@ -98,6 +131,7 @@ namespace Hypertable {
       other.columns = columns;
       other.time_interval = time_interval;
       other.return_deletes = return_deletes;
+      other.predicates = predicates;
       other.row_intervals.clear();
       other.cell_intervals.clear();
     }
@@ -109,6 +143,7 @@ namespace Hypertable {
     std::vector<CellInterval> cell_intervals;
     std::pair<int64_t,int64_t> time_interval;
     bool return_deletes;
+    std::vector<CellPredicate> predicates;
   };
 
   /**
@@ -227,6 +262,17 @@ namespace Hypertable {
       m_scan_spec.time_interval.second = end;
     }
 
+    /**
+     * Adds a predicate that cells must satisfy to be returned by the scan.
+     *
+     * @param type predicate type (see CellPredicate)
+     * @param pattern value, prefix or regular expression to match
+     */
+    void add_predicate(uint8_t type, const String &pattern) {
+      m_strings.push_back(pattern);
+      m_scan_spec.predicates.push_back(CellPredicate(type, m_strings.back().c_str()));
+    }
+
     /**
      * Internal use only.
      */
@@ -261,6 +307,8 @@ namespace Hypertable {
 
   std::ostream &operator<<(std::ostream &os, const CellInterval &);
 
+  std::ostream &operator<<(std::ostream &os, const CellPredicate &);
+
   std::ostream &operator<<(std::ostream &os, const ScanSpec &);
 
 } // namespace Hypertable
@@ -272,6 +272,29 @@ void Schema::set_access_group_parameter(const char *param, const char *value) {
       m_open_access_group->compressor = value;
       boost::trim(m_open_access_group->compressor);
     }
+    else if (!strcasecmp(param, "bloomFilter")) {
+      String bloom_filter = value;
+      boost::trim(bloom_filter);
+      boost::to_lower(bloom_filter);
+      if (bloom_filter == "none")
+        m_open_access_group->bloom_filter = "";
+      else if (bloom_filter == "rows" || bloom_filter == "rows+cols")
+        m_open_access_group->bloom_filter = bloom_filter;
+      else
+        set_error_string((string)"Invalid value (" + value + ") for AccessGroup attribute '" + param + "'");
+    }
+    else if (!strcasecmp(param, "compaction")) {
+      String compaction = value;
+      boost::trim(compaction);
+      boost::to_lower(compaction);
+      if (compaction == "merge")
+        m_open_access_group->compaction = "";
+      else if (compaction == "tiered" || compaction == "leveled" ||
+               compaction == "timewindow")
+        m_open_access_group->compaction = compaction;
+      else
+        set_error_string((string)"Invalid value (" + value + ") for AccessGroup attribute '" + param + "'");
+    }
     else
       set_error_string((string)"Invalid AccessGroup attribute '" + param + "'");
   }
@@ -342,6 +365,10 @@ void Schema::render(String &output) {
       output += (String)" blksz=\"" + (*iter)->blocksize + "\"";
     if ((*iter)->compressor != "")
       output += (String)" compressor=\"" + (*iter)->compressor + "\"";
+    if ((*iter)->bloom_filter != "")
+      output += (String)" bloomFilter=\"" + (*iter)->bloom_filter + "\"";
+    if ((*iter)->compaction != "")
+      output += (String)" compaction=\"" + (*iter)->compaction + "\"";
     output += ">\n";
     for (list<ColumnFamily *>::iterator cfiter = (*iter)->columns.begin(); cfiter != (*iter)->columns.end(); cfiter++) {
       output += (string)"    <ColumnFamily";
@@ -409,6 +436,12 @@ void Schema::render_hql_create_table(const String &table_name, String &output) {
     if (ag->compressor != "")
       output += (String)" COMPRESSOR=\"" + ag->compressor + "\"";
 
+    if (ag->bloom_filter != "")
+      output += (String)" BLOOMFILTER=\"" + ag->bloom_filter + "\"";
+
+    if (ag->compaction != "")
+      output += (String)" COMPACTION=\"" + ag->compaction + "\"";
+
     if (!ag->columns.empty()) {
       bool display_comma = false;
       output += (String)" (";
@@ -55,6 +55,8 @@ namespace Hypertable {
       bool     in_memory;
       uint32_t blocksize;
       String compressor;
+      String bloom_filter;
+      String compaction;
       std::list<ColumnFamily *> columns;
     };
 
@@ -123,12 +123,12 @@ Table::~Table() {
 
 
 
-TableMutator *Table::create_mutator(int timeout) {
-  return new TableMutator(m_props_ptr, m_comm, &m_table, m_schema_ptr, m_range_locator_ptr, timeout);
+TableMutator *Table::create_mutator(int timeout, bool bulk, TableMutatorCallbackPtr callback) {
+  return new TableMutator(m_props_ptr, m_comm, &m_table, m_schema_ptr, m_range_locator_ptr, timeout, bulk, callback);
 }
 
 
 
-TableScanner *Table::create_scanner(ScanSpec &scan_spec, int timeout) {
-  return new TableScanner(m_props_ptr, m_comm, &m_table, m_schema_ptr, m_range_locator_ptr, scan_spec, timeout);
+TableScanner *Table::create_scanner(ScanSpec &scan_spec, int timeout, bool bulk, int parallelism, bool ordered) {
+  return new TableScanner(m_props_ptr, m_comm, &m_table, m_schema_ptr, m_range_locator_ptr, scan_spec, timeout, bulk, parallelism, ordered);
 }
@@ -53,18 +53,23 @@ namespace Hypertable {
      * Creates a mutator on this table
      *
      * @param timeout maximum time in seconds to allow mutator methods to execute before throwing an exception
+     * @param bulk if true, updates are sent as bulk requests, which range servers run behind interactive ones
+     * @param callback if non-null, creates an asynchronous mutator that reports the outcome of each sent buffer to this object
      * @return newly constructed mutator object
      */
-    TableMutator *create_mutator(int timeout=0);
+    TableMutator *create_mutator(int timeout=0, bool bulk=false, TableMutatorCallbackPtr callback=0);
 
     /**
      * Creates a scanner on this table
      *
      * @param scan_spec scan specification
      * @param timeout maximum time in seconds to allow scanner methods to execute before throwing an exception
+     * @param bulk if true, scan requests are sent as bulk requests, which range servers run behind interactive ones
+     * @param parallelism maximum number of ranges to scan at once, 0 for the configured default
+     * @param ordered if false, a parallel scan returns cells as ranges deliver them instead of in row order
      * @return pointer to scanner object
      */
-    TableScanner *create_scanner(ScanSpec &scan_spec, int timeout=0);
+    TableScanner *create_scanner(ScanSpec &scan_spec, int timeout=0, bool bulk=false, int parallelism=0, bool ordered=true);
 
     void get_identifier(TableIdentifier *table_id_p) {
       memcpy(table_id_p, &m_table, sizeof(TableIdentifier));
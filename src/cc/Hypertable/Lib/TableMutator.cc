@@ -40,25 +40,55 @@ namespace {
   const uint64_t DEFAULT_MAX_MEMORY = 20000000LL;
 }
 
+atomic_t TableMutator::ms_next_group_id = ATOMIC_INIT(0);
+
 
 /**
  *
  */
 TableMutator::TableMutator(PropertiesPtr &props_ptr, Comm *comm,
     TableIdentifier *table_identifier, SchemaPtr &schema_ptr,
-    RangeLocatorPtr &range_locator_ptr, int timeout)
+    RangeLocatorPtr &range_locator_ptr, int timeout, bool bulk,
+    TableMutatorCallbackPtr callback)
     : m_props_ptr(props_ptr), m_comm(comm), m_schema_ptr(schema_ptr),
       m_range_locator_ptr(range_locator_ptr),
       m_table_identifier(*table_identifier), m_memory_used(0),
       m_max_memory(DEFAULT_MAX_MEMORY), m_resends(0), m_timeout(timeout),
-      m_last_error(Error::OK), m_last_op(0) {
+      m_last_error(Error::OK), m_last_op(0), m_bulk(bulk),
+      m_callback(callback), m_max_outstanding(1), m_shutdown(false),
+      m_resending(false), m_group_id(0) {
 
   if (m_timeout == 0 ||
       (m_timeout = props_ptr->get_int("Hypertable.Client.Timeout", 0)) == 0 ||
       (m_timeout = props_ptr->get_int("Hypertable.Request.Timeout", 0)) == 0)
     m_timeout = HYPERTABLE_CLIENT_TIMEOUT;
 
-  m_buffer_ptr = new TableMutatorScatterBuffer(props_ptr, m_comm, &m_table_identifier, m_schema_ptr, m_range_locator_ptr);
+  // keeps the buffers of an asynchronous mutator in order at each server
+  if (m_callback) {
+    while (m_group_id == 0)
+      m_group_id = atomic_inc_return(&ms_next_group_id);
+  }
+
+  m_buffer_ptr = new TableMutatorScatterBuffer(props_ptr, m_comm, &m_table_identifier, m_schema_ptr, m_range_locator_ptr, m_bulk, m_group_id);
+
+  if (m_callback) {
+    int max_outstanding = props_ptr->get_int("Hypertable.Client.Mutator.MaxOutstanding", 4);
+    m_max_outstanding = (max_outstanding < 1) ? 1 : max_outstanding;
+    m_threads.create_thread(CompletionThread(this));
+  }
+}
+
+
+TableMutator::~TableMutator() {
+  if (m_callback) {
+    wait_for_outstanding();
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_shutdown = true;
+      m_cond.notify_all();
+    }
+    m_threads.join_all();
+  }
 }
 
 
@@ -98,18 +128,8 @@ void TableMutator::set(uint64_t timestamp, KeySpec &key, const void *value, uint
     m_last_op = FLUSH;
 
     if (m_buffer_ptr->full() || m_memory_used > m_max_memory) {
-
       timer.start();
-
-      if (m_prev_buffer_ptr)
-        wait_for_previous_buffer(timer);
-
-      m_buffer_ptr->send();
-
-      m_prev_buffer_ptr = m_buffer_ptr;
-
-      m_buffer_ptr = new TableMutatorScatterBuffer(m_props_ptr, m_comm, &m_table_identifier, m_schema_ptr, m_range_locator_ptr);
-      m_memory_used = 0;
+      send_buffer(timer);
     }
 
   }
@@ -162,18 +182,8 @@ void TableMutator::set_delete(uint64_t timestamp, KeySpec &key) {
     m_last_op = FLUSH;
 
     if (m_buffer_ptr->full() || m_memory_used > m_max_memory) {
-
       timer.start();
-
-      if (m_prev_buffer_ptr)
-        wait_for_previous_buffer(timer);
-
-      m_buffer_ptr->send();
-
-      m_prev_buffer_ptr = m_buffer_ptr;
-
-      m_buffer_ptr = new TableMutatorScatterBuffer(m_props_ptr, m_comm, &m_table_identifier, m_schema_ptr, m_range_locator_ptr);
-      m_memory_used = 0;
+      send_buffer(timer);
     }
   }
   catch (Exception &e) {
@@ -194,6 +204,12 @@ void TableMutator::flush() {
 
   try {
 
+    if (m_callback) {
+      if (m_memory_used > 0)
+        send_buffer(timer);
+      return;
+    }
+
     if (m_prev_buffer_ptr)
       wait_for_previous_buffer(timer);
 
@@ -246,11 +262,57 @@ bool TableMutator::retry(int timeout) {
 
 
 
-void TableMutator::wait_for_previous_buffer(Timer &timer) {
+void TableMutator::wait_for_outstanding() {
+  boost::mutex::scoped_lock lock(m_mutex);
+  while (!m_outstanding.empty())
+    m_cond.wait(lock);
+}
+
+
+
+/**
+ * Sends the current buffer and starts a new one.  A synchronous mutator
+ * first waits for the previous buffer; an asynchronous one only waits if
+ * it already has the maximum number of buffers outstanding or is resending
+ * misdirected updates of an earlier buffer.
+ */
+void TableMutator::send_buffer(Timer &timer) {
+
+  if (m_callback) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_outstanding.size() >= m_max_outstanding || m_resending)
+      m_cond.wait(lock);
+  }
+  else if (m_prev_buffer_ptr)
+    wait_for_previous_buffer(timer);
+
+  m_buffer_ptr->send();
+
+  if (m_callback) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_outstanding.push_back(m_buffer_ptr);
+    m_cond.notify_all();
+  }
+  else
+    m_prev_buffer_ptr = m_buffer_ptr;
+
+  m_buffer_ptr = new TableMutatorScatterBuffer(m_props_ptr, m_comm, &m_table_identifier, m_schema_ptr, m_range_locator_ptr, m_bulk, m_group_id);
+  m_memory_used = 0;
+}
+
+
+
+void TableMutator::wait_for_buffer(TableMutatorScatterBufferPtr &buffer_ptr, Timer &timer) {
   TableMutatorScatterBuffer *redo_buffer = 0;
   int wait_time = 1;
 
-  while (!m_prev_buffer_ptr->wait_for_completion(timer)) {
+  while (!buffer_ptr->wait_for_completion(timer)) {
+
+    // hold back later buffers until the resent updates are in
+    if (m_callback) {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_resending = true;
+    }
 
     if (timer.remaining() < wait_time)
       HT_THROW(Error::REQUEST_TIMEOUT, "");
@@ -262,23 +324,99 @@ void TableMutator::wait_for_previous_buffer(Timer &timer) {
     /**
      * Make several attempts to create redo buffer
      */
-    if ((redo_buffer = m_prev_buffer_ptr->create_redo_buffer(timer)) == 0)
+    if ((redo_buffer = buffer_ptr->create_redo_buffer(timer)) == 0)
       continue;
 
-    m_resends += m_prev_buffer_ptr->get_resend_count();
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_resends += buffer_ptr->get_resend_count();
+    }
 
-    m_prev_buffer_ptr = redo_buffer;
+    buffer_ptr = redo_buffer;
 
     /**
      * Re-send failed sends
      */
-    m_prev_buffer_ptr->send();
+    buffer_ptr->send();
   }
 
 }
 
 
 
+/**
+ * Waits for an outstanding buffer of an asynchronous mutator, resending
+ * misdirected updates, and reports the outcome to the callback
+ */
+void TableMutator::complete_buffer(TableMutatorScatterBufferPtr &buffer_ptr) {
+  Timer timer(m_timeout, true);
+  int error = Error::OK;
+
+  try {
+    wait_for_buffer(buffer_ptr, timer);
+  }
+  catch (Exception &e) {
+    error = e.code();
+  }
+
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_resending = false;
+    m_cond.notify_all();
+  }
+
+  /**
+   * Whatever the callback throws must not take down the completion
+   * thread, or the buffer would stay outstanding for good
+   */
+  try {
+    if (error == Error::OK)
+      m_callback->update_ok();
+    else {
+      std::vector<std::pair<Cell, int> > failed_mutations;
+      buffer_ptr->get_failed_mutations(failed_mutations);
+      m_callback->update_error(error, failed_mutations);
+    }
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << "Mutator callback threw: " << e << HT_END;
+  }
+  catch (std::exception &e) {
+    HT_ERRORF("Mutator callback threw: %s", e.what());
+  }
+  catch (...) {
+    HT_ERROR("Mutator callback threw an unknown exception");
+  }
+}
+
+
+
+void TableMutator::CompletionThread::operator()() {
+  TableMutatorScatterBufferPtr buffer_ptr;
+
+  while (true) {
+    {
+      boost::mutex::scoped_lock lock(m_mutator->m_mutex);
+      while (m_mutator->m_outstanding.empty() && !m_mutator->m_shutdown)
+        m_mutator->m_cond.wait(lock);
+      if (m_mutator->m_outstanding.empty())
+        return;
+      buffer_ptr = m_mutator->m_outstanding.front();
+    }
+
+    m_mutator->complete_buffer(buffer_ptr);
+
+    {
+      boost::mutex::scoped_lock lock(m_mutator->m_mutex);
+      m_mutator->m_outstanding.pop_front();
+      m_mutator->m_cond.notify_all();
+    }
+    buffer_ptr = 0;
+  }
+}
+
+
+
 void TableMutator::sanity_check_key(KeySpec &key) {
   const char *row = (const char *)key.row;
   const char *column_qualifier = (const char *)key.column_qualifier;
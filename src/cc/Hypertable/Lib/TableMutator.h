@@ -22,15 +22,23 @@
 #ifndef HYPERTABLE_TABLEMUTATOR_H
 #define HYPERTABLE_TABLEMUTATOR_H
 
+#include <deque>
+
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include "AsyncComm/ConnectionManager.h"
 
+#include "Common/atomic.h"
 #include "Common/Properties.h"
 #include "Common/StringExt.h"
 #include "Common/ReferenceCount.h"
+#include "Common/Thread.h"
 #include "Common/Timer.h"
 
 #include "Cell.h"
 #include "KeySpec.h"
+#include "TableMutatorCallback.h"
 #include "TableMutatorScatterBuffer.h"
 #include "RangeLocator.h"
 #include "RangeServerClient.h"
@@ -45,6 +53,20 @@ namespace Hypertable {
    * periodically flush them to the appropriate range servers.  There is a 1 MB
    * buffer of mutations for each range server.  When one of the buffers fills up
    * all the buffers are flushed to their respective range servers.
+   *
+   * A mutator created with a callback is asynchronous: full buffers are
+   * sent without waiting for earlier ones, up to
+   * Hypertable.Client.Mutator.MaxOutstanding (default 4) at a time, and a
+   * completion thread waits for them, resends misdirected updates and
+   * reports the outcome of each buffer to the callback.
+   *
+   * The update requests of an asynchronous mutator carry a group ID of its
+   * own, so a RangeServer applies the buffers it gets from one mutator in
+   * the order they were sent.  While misdirected updates are being resent,
+   * no further buffers are sent.  The one case left is a range that moves
+   * while later buffers are already in flight: those buffers may reach the
+   * range's new server before the resent updates of the earlier buffer,
+   * and a later update to the same cell is then applied first.
    */
   class TableMutator : public ReferenceCount {
 
@@ -59,10 +81,16 @@ namespace Hypertable {
      * @param schema_ptr smart pointer to schema object for table
      * @param range_locator_ptr smart pointer to range locator
      * @param timeout maximum time in seconds to allow methods to execute before throwing an exception
+     * @param bulk if true, updates are sent as bulk requests that range servers run behind interactive ones
+     * @param callback if non-null, the mutator is asynchronous and reports the outcome of each sent buffer to this object
      */
-    TableMutator(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr, int timeout);
+    TableMutator(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr, int timeout, bool bulk=false, TableMutatorCallbackPtr callback=0);
 
-    virtual ~TableMutator() { return; }
+    /**
+     * Waits for outstanding buffers of an asynchronous mutator and stops its
+     * completion thread.  Unflushed mutations are discarded.
+     */
+    virtual ~TableMutator();
 
     /**
      * Inserts a cell into the table.
@@ -130,9 +158,17 @@ namespace Hypertable {
 
     /**
      * Flushes the accumulated mutations to their respective range servers.
+     * An asynchronous mutator only sends them; use wait_for_outstanding() to
+     * wait for the results.
      */
     void flush();
 
+    /**
+     * Waits until every buffer sent by an asynchronous mutator has been
+     * reported to the callback
+     */
+    void wait_for_outstanding();
+
     /**
      * Retries the last operation
      *
@@ -157,7 +193,10 @@ namespace Hypertable {
      *
      * @return number of mutations that were resent
      */
-    uint64_t get_resend_count() { return m_resends; }
+    uint64_t get_resend_count() {
+      boost::mutex::scoped_lock lock(m_mutex);
+      return m_resends;
+    }
 
     /**
      * Returns the failed mutations
@@ -188,7 +227,23 @@ namespace Hypertable {
       FLUSH = 3
     };
 
-    void wait_for_previous_buffer(Timer &timer);
+    class CompletionThread {
+    public:
+      CompletionThread(TableMutator *mutator) : m_mutator(mutator) { }
+      void operator()();
+    private:
+      TableMutator *m_mutator;
+    };
+
+    void send_buffer(Timer &timer);
+
+    void wait_for_previous_buffer(Timer &timer) {
+      wait_for_buffer(m_prev_buffer_ptr, timer);
+    }
+
+    void wait_for_buffer(TableMutatorScatterBufferPtr &buffer_ptr, Timer &timer);
+
+    void complete_buffer(TableMutatorScatterBufferPtr &buffer_ptr);
 
     void sanity_check_key(KeySpec &key);
 
@@ -206,10 +261,23 @@ namespace Hypertable {
 
     int32_t     m_last_error;
     int         m_last_op;
+    bool        m_bulk;
     uint64_t    m_last_timestamp;
     KeySpec     m_last_key;
     const void *m_last_value;
     uint32_t    m_last_value_len;
+
+    boost::mutex            m_mutex;
+    boost::condition        m_cond;
+    TableMutatorCallbackPtr m_callback;
+    std::deque<TableMutatorScatterBufferPtr> m_outstanding;
+    size_t                  m_max_outstanding;
+    bool                    m_shutdown;
+    bool                    m_resending;
+    uint32_t                m_group_id;
+    ThreadGroup             m_threads;
+
+    static atomic_t ms_next_group_id;
   };
   typedef boost::intrusive_ptr<TableMutator> TableMutatorPtr;
 
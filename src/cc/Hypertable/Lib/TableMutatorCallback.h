@@ -0,0 +1,64 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_TABLEMUTATORCALLBACK_H
+#define HYPERTABLE_TABLEMUTATORCALLBACK_H
+
+#include <utility>
+#include <vector>
+
+#include "Common/ReferenceCount.h"
+
+#include "Cell.h"
+
+namespace Hypertable {
+
+  /**
+   * Receives the outcome of the buffers sent by an asynchronous
+   * TableMutator.  Methods are called from the mutator's completion thread,
+   * one buffer at a time, in the order the buffers were sent.  Exceptions
+   * they throw are logged and otherwise ignored.
+   */
+  class TableMutatorCallback : public ReferenceCount {
+  public:
+    virtual ~TableMutatorCallback() { return; }
+
+    /**
+     * Called when every mutation in a sent buffer has been applied
+     */
+    virtual void update_ok() = 0;
+
+    /**
+     * Called when some mutations in a sent buffer could not be applied.  The
+     * cells point into the buffer and are only valid during this call.
+     *
+     * @param error error code of the first failure
+     * @param failed_mutations failed cells with their error codes (empty
+     *        if the whole buffer timed out)
+     */
+    virtual void update_error(int error, std::vector<std::pair<Cell, int> > &failed_mutations) = 0;
+  };
+  typedef boost::intrusive_ptr<TableMutatorCallback> TableMutatorCallbackPtr;
+
+}
+
+#endif // HYPERTABLE_TABLEMUTATORCALLBACK_H
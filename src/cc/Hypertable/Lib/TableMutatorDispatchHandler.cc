@@ -26,6 +26,7 @@
 #include "Common/Logger.h"
 
 #include "TableMutatorDispatchHandler.h"
+#include "WireCompressor.h"
 
 using namespace Hypertable;
 using namespace Serialization;
@@ -48,11 +49,18 @@ void TableMutatorDispatchHandler::handle(EventPtr &event_ptr) {
 
   if (event_ptr->type == Event::MESSAGE) {
     error = Protocol::response_code(event_ptr);
-    if (error != Error::OK) {
+    if (error == Error::RANGESERVER_THROTTLED) {
+      // server is short on memory, back off and resend everything
+      m_send_buffer->add_retries_all();
+      HT_WARNF("%s, will retry ...", Error::get_text(error));
+    }
+    else if (error != Error::OK) {
       m_send_buffer->add_errors_all(error);
     }
     else {
       const uint8_t *ptr = event_ptr->message + 4;
+      WireCompressor::set_peer_accepts(event_ptr->addr,
+          (event_ptr->header->flags & Header::FLAGS_BIT_ACCEPTS_COMPRESSED) != 0);
       size_t remaining = event_ptr->message_len - 4;
       uint32_t offset, len;
 
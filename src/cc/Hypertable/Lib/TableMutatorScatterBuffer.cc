@@ -32,6 +32,66 @@ using namespace Hypertable;
 
 namespace {
   const uint32_t MAX_SEND_BUFFER_SIZE = 1000000;
+
+  struct LtByteStringChronological {
+    bool operator()(const ByteString bs1, const ByteString bs2) const {
+      const uint8_t *ptr1, *ptr2;
+      size_t len1 = bs1.decode_length(&ptr1);
+      size_t len2 = bs2.decode_length(&ptr2);
+      int rval = strcmp((const char *)ptr1, (const char *)ptr2);
+      if (rval == 0) {
+        ptr1 += len1 - 8;
+        ptr2 += len2 - 8;
+        return memcmp(ptr1, ptr2, 8) > 0;  // this gives chronological
+      }
+      return rval < 0;
+    }
+  };
+
+  /**
+   * A key with the first eight bytes of its row cached as a big-endian
+   * integer, so most comparisons during the sort don't touch the key
+   */
+  struct PrefixedKey {
+    uint64_t   prefix;
+    ByteString key;
+  };
+
+  struct LtPrefixedKey {
+    bool operator()(const PrefixedKey &pk1, const PrefixedKey &pk2) const {
+      if (pk1.prefix != pk2.prefix)
+        return pk1.prefix < pk2.prefix;
+      return swo_bs(pk1.key, pk2.key);
+    }
+    LtByteStringChronological swo_bs;
+  };
+
+  uint64_t row_prefix(ByteString key) {
+    const uint8_t *row;
+    uint64_t prefix = 0;
+
+    key.decode_length(&row);
+    for (size_t i=0; i<8; i++) {
+      prefix <<= 8;
+      if (*row)
+        prefix |= *row++;
+    }
+    return prefix;
+  }
+
+  /**
+   * Clears the sorted flag of a send buffer if the key just added sorts
+   * before the one added previously
+   */
+  void check_key_order(TableMutatorSendBuffer *send_buffer) {
+    LtByteStringChronological swo_bs;
+    size_t n = send_buffer->key_offsets.size();
+
+    if (send_buffer->sorted && n > 1 &&
+        swo_bs((ByteString)(send_buffer->accum.base + send_buffer->key_offsets[n-1]),
+               (ByteString)(send_buffer->accum.base + send_buffer->key_offsets[n-2])))
+      send_buffer->sorted = false;
+  }
 }
 
 
@@ -40,11 +100,20 @@ namespace {
  */
 TableMutatorScatterBuffer::TableMutatorScatterBuffer(PropertiesPtr &props_ptr,
     Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr,
-    RangeLocatorPtr &range_locator_ptr)
+    RangeLocatorPtr &range_locator_ptr, bool bulk, uint32_t group_id)
     : m_props_ptr(props_ptr), m_comm(comm), m_schema_ptr(schema_ptr),
       m_range_locator_ptr(range_locator_ptr),
       m_range_server(comm, HYPERTABLE_CLIENT_TIMEOUT),
-      m_table_identifier(*table_identifier), m_full(false), m_resends(0) {
+      m_table_identifier(*table_identifier), m_full(false), m_resends(0),
+      m_bulk(bulk), m_group_id(group_id) {
+
+  m_range_server.set_bulk(bulk);
+  m_range_server.set_update_group_id(group_id);
+
+  WireCompressorPtr compressor = WireCompressor::create(
+      props_ptr->get("Hypertable.Client.UpdateCompression", "quicklz"),
+      props_ptr->get_int("Hypertable.Client.UpdateCompressionThreshold", 4096));
+  m_range_server.set_compressor(compressor);
 
   m_range_locator_ptr->get_location_cache(m_cache_ptr);
 }
@@ -76,6 +145,7 @@ void TableMutatorScatterBuffer::set(Key &key, const void *value, uint32_t value_
   (*iter).second->key_offsets.push_back((*iter).second->accum.fill());
   create_key_and_append((*iter).second->accum, FLAG_INSERT, key.row, key.column_family_code, key.column_qualifier, key.timestamp);
   append_as_byte_string((*iter).second->accum, value, value_len);
+  check_key_order((*iter).second.get());
 
   if ((*iter).second->accum.fill() > MAX_SEND_BUFFER_SIZE)
     m_full = true;
@@ -115,6 +185,7 @@ void TableMutatorScatterBuffer::set_delete(Key &key, Timer &timer) {
 
   create_key_and_append((*iter).second->accum, key_flag, key.row, key.column_family_code, key.column_qualifier, key.timestamp);
   append_as_byte_string((*iter).second->accum, 0, 0);
+  check_key_order((*iter).second.get());
 
   if ((*iter).second->accum.fill() > MAX_SEND_BUFFER_SIZE)
     m_full = true;
@@ -149,37 +220,24 @@ void TableMutatorScatterBuffer::set(ByteString key, ByteString value, Timer &tim
   (*iter).second->key_offsets.push_back((*iter).second->accum.fill());
   (*iter).second->accum.add(key.ptr, (ptr-key.ptr)+len);
   (*iter).second->accum.add(value.ptr, value.length());
+  check_key_order((*iter).second.get());
 
   if ((*iter).second->accum.fill() > MAX_SEND_BUFFER_SIZE)
     m_full = true;
 }
 
 
-namespace {
-  struct LtByteStringChronological {
-    bool operator()(const ByteString bs1, const ByteString bs2) const {
-      const uint8_t *ptr1, *ptr2;
-      size_t len1 = bs1.decode_length(&ptr1);
-      size_t len2 = bs2.decode_length(&ptr2);
-      int rval = strcmp((const char *)ptr1, (const char *)ptr2);
-      if (rval == 0) {
-        ptr1 += len1 - 8;
-        ptr2 += len2 - 8;
-        return memcmp(ptr1, ptr2, 8) > 0;  // this gives chronological
-      }
-      return rval < 0;
-    }
-  };
-}
-
-
 /**
- *
+ * Sends each server's accumulated updates.  Updates that were added in
+ * sorted order, and resends, are sent straight out of the accumulation
+ * buffer; otherwise they are sorted by row prefix and copied into a new
+ * buffer in sorted order.
  */
 void TableMutatorScatterBuffer::send() {
   TableMutatorSendBufferPtr send_buffer_ptr;
-  struct LtByteStringChronological swo_bs;
-  std::vector<ByteString> kvec;
+  LtPrefixedKey lt_prefixed_key;
+  std::vector<PrefixedKey> kvec;
+  PrefixedKey pk;
   uint8_t *ptr;
   ByteString bs;
   size_t len;
@@ -194,33 +252,39 @@ void TableMutatorScatterBuffer::send() {
       continue;
     }
 
-    send_buffer_ptr->pending_updates.set(new uint8_t [len], len);
-
-    if (send_buffer_ptr->resend()) {
-      memcpy(send_buffer_ptr->pending_updates.base, send_buffer_ptr->accum.base, len);
+    if (send_buffer_ptr->resend() || send_buffer_ptr->sorted) {
+      send_buffer_ptr->pending_updates.set(send_buffer_ptr->accum.release(), len);
     }
     else {
+      send_buffer_ptr->pending_updates.set(new uint8_t [len], len);
+
       kvec.clear();
       kvec.reserve(send_buffer_ptr->key_offsets.size());
-      for (size_t i=0; i<send_buffer_ptr->key_offsets.size(); i++)
-        kvec.push_back((ByteString)(send_buffer_ptr->accum.base + send_buffer_ptr->key_offsets[i]));
-      sort(kvec.begin(), kvec.end(), swo_bs);
+      for (size_t i=0; i<send_buffer_ptr->key_offsets.size(); i++) {
+        pk.key = (ByteString)(send_buffer_ptr->accum.base + send_buffer_ptr->key_offsets[i]);
+        pk.prefix = row_prefix(pk.key);
+        kvec.push_back(pk);
+      }
+      sort(kvec.begin(), kvec.end(), lt_prefixed_key);
 
       ptr = send_buffer_ptr->pending_updates.base;
 
       for (size_t i=0; i<kvec.size(); i++) {
-        bs = kvec[i];
+        bs = kvec[i].key;
         bs.next();  // skip key
         bs.next();  // skip value
-        memcpy(ptr, kvec[i].ptr, bs.ptr - kvec[i].ptr);
-        ptr += bs.ptr - kvec[i].ptr;
+        memcpy(ptr, kvec[i].key.ptr, bs.ptr - kvec[i].key.ptr);
+        ptr += bs.ptr - kvec[i].key.ptr;
       }
       HT_EXPECT((size_t)(ptr-send_buffer_ptr->pending_updates.base)==len, Error::FAILED_EXPECTATION);
-      send_buffer_ptr->dispatch_handler_ptr = new TableMutatorDispatchHandler(send_buffer_ptr.get());
     }
 
+    if (!send_buffer_ptr->resend())
+      send_buffer_ptr->dispatch_handler_ptr = new TableMutatorDispatchHandler(send_buffer_ptr.get());
+
     send_buffer_ptr->accum.free();
     send_buffer_ptr->key_offsets.clear();
+    send_buffer_ptr->sorted = true;
 
     /**
      * Send update
@@ -306,7 +370,7 @@ TableMutatorScatterBuffer *TableMutatorScatterBuffer::create_redo_buffer(Timer &
 
   try {
 
-    redo_buffer = new TableMutatorScatterBuffer(m_props_ptr, m_comm, &m_table_identifier, m_schema_ptr, m_range_locator_ptr);
+    redo_buffer = new TableMutatorScatterBuffer(m_props_ptr, m_comm, &m_table_identifier, m_schema_ptr, m_range_locator_ptr, m_bulk, m_group_id);
 
     for (TableMutatorSendBufferMap::const_iterator iter = m_buffer_map.begin(); iter != m_buffer_map.end(); iter++) {
       send_buffer_ptr = (*iter).second;
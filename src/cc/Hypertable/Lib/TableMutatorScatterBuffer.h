@@ -50,7 +50,7 @@ namespace Hypertable {
 
   public:
 
-    TableMutatorScatterBuffer(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr);
+    TableMutatorScatterBuffer(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr, bool bulk=false, uint32_t group_id=0);
     void set(Key &key, const void *value, uint32_t value_len, Timer &timer);
     void set_delete(Key &key, Timer &timer);
     void set(ByteString key, ByteString value, Timer &timer);
@@ -85,6 +85,8 @@ namespace Hypertable {
     uint64_t             m_resends;
     std::vector<std::pair<Cell, int> > m_failed_mutations;
     FlyweightString      m_constant_strings;
+    bool                 m_bulk;
+    uint32_t             m_group_id;
 
   };
   typedef boost::intrusive_ptr<TableMutatorScatterBuffer> TableMutatorScatterBufferPtr;
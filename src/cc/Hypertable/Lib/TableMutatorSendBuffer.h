@@ -39,7 +39,7 @@ namespace Hypertable {
    */
   class TableMutatorSendBuffer : public ReferenceCount {
   public:
-    TableMutatorSendBuffer(TableIdentifier *tid, TableMutatorCompletionCounter *cc, RangeLocator *rl) : counterp(cc), m_table_identifier(tid), m_range_locator(rl), m_resend(false) { return; }
+    TableMutatorSendBuffer(TableIdentifier *tid, TableMutatorCompletionCounter *cc, RangeLocator *rl) : counterp(cc), sorted(true), m_table_identifier(tid), m_range_locator(rl), m_resend(false) { return; }
     void add_retries(uint32_t offset, uint32_t len) {
       accum.add(pending_updates.base+offset, len);
       m_resend = true;
@@ -76,6 +76,7 @@ namespace Hypertable {
     }
     void clear() {
       key_offsets.clear();
+      sorted = true;
       accum.clear();
       pending_updates.free();
       failed_regions.clear();
@@ -95,6 +96,7 @@ namespace Hypertable {
     StaticBuffer pending_updates;
     struct sockaddr_in addr;
     TableMutatorCompletionCounter *counterp;
+    bool sorted;  // keys in accum were added in send order
     DispatchHandlerPtr dispatch_handler_ptr;
     std::vector<FailedRegion> failed_regions;
   private:
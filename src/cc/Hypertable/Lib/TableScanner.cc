@@ -44,7 +44,8 @@ TableScanner::TableScanner(PropertiesPtr &props_ptr, Comm *comm,
                            TableIdentifier *table_identifier,
                            SchemaPtr &schema_ptr,
                            RangeLocatorPtr &range_locator_ptr,
-                           ScanSpec &scan_spec, int timeout)
+                           ScanSpec &scan_spec, int timeout, bool bulk,
+                           int parallelism, bool ordered)
   : m_eos(false), m_scanneri(0), m_rows_seen(0) {
 
   IntervalScannerPtr ri_scanner_ptr;
@@ -55,18 +56,33 @@ TableScanner::TableScanner(PropertiesPtr &props_ptr, Comm *comm,
       (timeout = props_ptr->get_int("Hypertable.Request.Timeout", 0)) == 0)
     timeout = HYPERTABLE_CLIENT_TIMEOUT;
   
+  if (parallelism == 0)
+    parallelism = props_ptr->get_int("Hypertable.Client.Scanner.Parallelism", 1);
+
+  /**
+   * A row limit counts rows across the whole scan, so scans with one
+   * stay sequential.
+   */
+  if (parallelism > 1 && scan_spec.row_limit == 0) {
+    if (!scan_spec.row_intervals.empty() && !scan_spec.cell_intervals.empty())
+      HT_THROW(Error::RANGESERVER_BAD_SCAN_SPEC,
+               "ROW predicates and CELL predicates can't be combined");
+    m_parallel_scanner = new ParallelScanner(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, scan_spec, timeout, bulk, parallelism, ordered);
+    return;
+  }
+
   Timer timer(timeout);
 
   if (scan_spec.row_intervals.empty()) {
     if (scan_spec.cell_intervals.empty()) {
-      ri_scanner_ptr = new IntervalScanner(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, scan_spec, timeout);
+      ri_scanner_ptr = new IntervalScanner(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, scan_spec, timeout, bulk);
       m_interval_scanners.push_back(ri_scanner_ptr);
     }
     else {
       for (size_t i=0; i<scan_spec.cell_intervals.size(); i++) {
 	scan_spec.base_copy(interval_scan_spec);
 	interval_scan_spec.cell_intervals.push_back(scan_spec.cell_intervals[i]);
-	ri_scanner_ptr = new IntervalScanner(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, interval_scan_spec, timeout);
+	ri_scanner_ptr = new IntervalScanner(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, interval_scan_spec, timeout, bulk);
 	m_interval_scanners.push_back(ri_scanner_ptr);
 	ri_scanner_ptr->find_range_and_start_scan(scan_spec.cell_intervals[i].start_row, timer);
       }
@@ -76,7 +92,7 @@ TableScanner::TableScanner(PropertiesPtr &props_ptr, Comm *comm,
     for (size_t i=0; i<scan_spec.row_intervals.size(); i++) {
       scan_spec.base_copy(interval_scan_spec);
       interval_scan_spec.row_intervals.push_back(scan_spec.row_intervals[i]);
-      ri_scanner_ptr = new IntervalScanner(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, interval_scan_spec, timeout);
+      ri_scanner_ptr = new IntervalScanner(props_ptr, comm, table_identifier, schema_ptr, range_locator_ptr, interval_scan_spec, timeout, bulk);
       m_interval_scanners.push_back(ri_scanner_ptr);
       ri_scanner_ptr->find_range_and_start_scan(scan_spec.row_intervals[i].start, timer);
     }
@@ -91,6 +107,13 @@ bool TableScanner::next(Cell &cell) {
   if (m_eos)
     return false;
 
+  if (m_parallel_scanner) {
+    if (m_parallel_scanner->next(cell))
+      return true;
+    m_eos = true;
+    return false;
+  }
+
  try_again:
 
   if (m_interval_scanners[m_scanneri]->next(cell))
@@ -31,6 +31,7 @@
 #include "RangeLocator.h"
 #include "RangeServerClient.h"
 #include "IntervalScanner.h"
+#include "ParallelScanner.h"
 #include "ScanBlock.h"
 #include "Schema.h"
 #include "Types.h"
@@ -50,14 +51,20 @@ namespace Hypertable {
      * @param range_locator_ptr smart pointer to range locator
      * @param scan_spec reference to scan specification object
      * @param timeout maximum time in seconds to allow scanner methods to execute before throwing an exception
+     * @param bulk if true, scan requests are sent as bulk requests that range servers run behind interactive ones
+     * @param parallelism maximum number of ranges to scan at once; 0 means
+     *        use Hypertable.Client.Scanner.Parallelism (default 1, a sequential scan)
+     * @param ordered if false, a parallel scan returns cells in the order the
+     *        ranges deliver them rather than in row order
      */
-    TableScanner(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr, ScanSpec &scan_spec, int timeout);
+    TableScanner(PropertiesPtr &props_ptr, Comm *comm, TableIdentifier *table_identifier, SchemaPtr &schema_ptr, RangeLocatorPtr &range_locator_ptr, ScanSpec &scan_spec, int timeout, bool bulk=false, int parallelism=0, bool ordered=true);
 
     bool next(Cell &cell);
 
   private:
 
     std::vector<IntervalScannerPtr>  m_interval_scanners;
+    ParallelScannerPtr m_parallel_scanner;
     bool      m_eos;
     size_t    m_scanneri;
     int32_t   m_rows_seen;
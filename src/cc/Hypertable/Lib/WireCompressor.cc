@@ -0,0 +1,141 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "CompressorFactory.h"
+#include "WireCompressor.h"
+
+using namespace Hypertable;
+
+const char WireCompressor::MAGIC[10] = { 'W','i','r','e','B','l','o','c','k','-' };
+
+boost::mutex WireCompressor::ms_mutex;
+std::vector<BlockCompressionCodec *> WireCompressor::ms_codecs[BlockCompressionCodec::COMPRESSION_TYPE_LIMIT];
+SockAddrMap<bool> WireCompressor::ms_peers;
+
+
+WireCompressor *WireCompressor::create(const String &spec, size_t threshold) {
+  BlockCompressionCodec::Args args;
+  BlockCompressionCodec::Type type = CompressorFactory::parse_block_codec_spec(spec, args);
+
+  if (type == BlockCompressionCodec::NONE || type == BlockCompressionCodec::UNKNOWN)
+    return 0;
+  return new WireCompressor(type, threshold);
+}
+
+
+bool WireCompressor::compress(const uint8_t *data, size_t len, DynamicBuffer &output) {
+  BlockCompressionHeader header(MAGIC);
+  DynamicBuffer input(0, false);
+  BlockCompressionCodec *codec;
+
+  if (len < m_threshold)
+    return false;
+
+  input.base = (uint8_t *)data;
+  input.ptr = input.base + len;
+  input.size = len;
+
+  codec = checkout(m_type);
+  try {
+    codec->deflate(input, output, header);
+  }
+  catch (Exception &e) {
+    checkin(codec);
+    HT_WARNF("Wire compression failed - %s", e.what());
+    return false;
+  }
+  checkin(codec);
+
+  return header.get_compression_type() != BlockCompressionCodec::NONE;
+}
+
+
+void WireCompressor::decompress(const uint8_t *data, size_t len, DynamicBuffer &output) {
+  BlockCompressionHeader header;
+  DynamicBuffer input(0, false);
+  BlockCompressionCodec *codec;
+  const uint8_t *ptr = data;
+  size_t remaining = len;
+
+  header.decode(&ptr, &remaining);
+
+  if (!header.check_magic(MAGIC))
+    HT_THROW(Error::BLOCK_COMPRESSOR_BAD_MAGIC, "Bad wire block magic");
+
+  if (header.get_compression_type() >= BlockCompressionCodec::COMPRESSION_TYPE_LIMIT)
+    HT_THROWF(Error::BLOCK_COMPRESSOR_UNSUPPORTED_TYPE, "Unsupported wire "
+              "compression type %d", (int)header.get_compression_type());
+
+  input.base = (uint8_t *)data;
+  input.ptr = input.base + len;
+  input.size = len;
+
+  output.clear();
+
+  codec = checkout(header.get_compression_type());
+  try {
+    codec->inflate(input, output, header);
+  }
+  catch (Exception &e) {
+    checkin(codec);
+    throw;
+  }
+  checkin(codec);
+}
+
+
+BlockCompressionCodec *WireCompressor::checkout(int type) {
+  {
+    boost::mutex::scoped_lock lock(ms_mutex);
+    if (!ms_codecs[type].empty()) {
+      BlockCompressionCodec *codec = ms_codecs[type].back();
+      ms_codecs[type].pop_back();
+      return codec;
+    }
+  }
+  return CompressorFactory::create_block_codec((BlockCompressionCodec::Type)type);
+}
+
+
+void WireCompressor::checkin(BlockCompressionCodec *codec) {
+  boost::mutex::scoped_lock lock(ms_mutex);
+  ms_codecs[codec->get_type()].push_back(codec);
+}
+
+
+void WireCompressor::set_peer_accepts(const struct sockaddr_in &addr, bool accepts) {
+  boost::mutex::scoped_lock lock(ms_mutex);
+  if (accepts)
+    ms_peers[addr] = true;
+  else
+    ms_peers.erase(addr);
+}
+
+
+bool WireCompressor::peer_accepts(const struct sockaddr_in &addr) {
+  boost::mutex::scoped_lock lock(ms_mutex);
+  return ms_peers.find(addr) != ms_peers.end();
+}
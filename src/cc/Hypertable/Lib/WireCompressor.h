@@ -0,0 +1,115 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_WIRECOMPRESSOR_H
+#define HYPERTABLE_WIRECOMPRESSOR_H
+
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "Common/DynamicBuffer.h"
+#include "Common/ReferenceCount.h"
+#include "Common/SockAddrMap.h"
+#include "Common/String.h"
+
+#include "BlockCompressionCodec.h"
+
+namespace Hypertable {
+
+  /**
+   * Compresses message payloads (update buffers and scan blocks) for the
+   * wire.  A compressed payload is a block with a BlockCompressionHeader, so
+   * the receiver learns the codec from the payload itself and needs no
+   * configuration.  Codecs keep scratch memory and aren't thread safe, so
+   * they are kept in a process-wide pool and checked out per call.
+   */
+  class WireCompressor : public ReferenceCount {
+  public:
+
+    static const char MAGIC[10];
+
+    WireCompressor(BlockCompressionCodec::Type type, size_t threshold)
+      : m_type(type), m_threshold(threshold) { return; }
+
+    /**
+     * Creates a compressor from a codec name such as "quicklz"
+     *
+     * @param spec codec name
+     * @param threshold payloads smaller than this are sent raw
+     * @return new compressor, or 0 if spec is "none" or unknown
+     */
+    static WireCompressor *create(const String &spec, size_t threshold);
+
+    /**
+     * Compresses a payload.  Nothing is written when the payload is below
+     * the threshold or doesn't compress.
+     *
+     * @param data payload to compress
+     * @param len length of the payload
+     * @param output filled in with the compressed block
+     * @return true if output holds a compressed block that should be sent
+     *         instead of the payload
+     */
+    bool compress(const uint8_t *data, size_t len, DynamicBuffer &output);
+
+    /**
+     * Restores a payload compressed with compress()
+     *
+     * @param data compressed block
+     * @param len length of the compressed block
+     * @param output filled in with the original payload
+     */
+    static void decompress(const uint8_t *data, size_t len, DynamicBuffer &output);
+
+    /**
+     * Records whether a server takes compressed update payloads, as
+     * advertised in its last update response
+     *
+     * @param addr server address
+     * @param accepts true if the server takes compressed updates
+     */
+    static void set_peer_accepts(const struct sockaddr_in &addr, bool accepts);
+
+    /**
+     * @return true if the server has advertised that it takes compressed
+     *         update payloads
+     */
+    static bool peer_accepts(const struct sockaddr_in &addr);
+
+  private:
+
+    static BlockCompressionCodec *checkout(int type);
+    static void checkin(BlockCompressionCodec *codec);
+
+    static boost::mutex ms_mutex;
+    static std::vector<BlockCompressionCodec *> ms_codecs[BlockCompressionCodec::COMPRESSION_TYPE_LIMIT];
+    static SockAddrMap<bool> ms_peers;
+
+    BlockCompressionCodec::Type m_type;
+    size_t m_threshold;
+  };
+  typedef boost::intrusive_ptr<WireCompressor> WireCompressorPtr;
+
+}
+
+#endif // HYPERTABLE_WIRECOMPRESSOR_H
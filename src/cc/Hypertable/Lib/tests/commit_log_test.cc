@@ -51,6 +51,7 @@ namespace {
 
   void test1(DfsBroker::Client *dfs_client);
   void test_link(DfsBroker::Client *dfs_client);
+  void test_timestamp_order(DfsBroker::Client *dfs_client);
   void write_entries(CommitLog *log, int num_entries, uint64_t *sump, CommitLogBase *link_log);
   void read_entries(DfsBroker::Client *dfs_client, CommitLogReader *log_reader, uint64_t *sump);
 }
@@ -90,6 +91,8 @@ int main(int argc, char **argv) {
 
     test_link(dfs_client);
 
+    test_timestamp_order(dfs_client);
+
   }
   catch (Hypertable::Exception &e) {
     HT_ERRORF("%s - %s", e.what(), Error::get_text(e.code()));
@@ -216,6 +219,54 @@ namespace {
     HT_EXPECT(sum_read == sum_written, Error::FAILED_EXPECTATION);
   }
 
+  /**
+   * Commits a group with a newer timestamp followed by one with an older
+   * timestamp that rolls the log.  The rolled fragment must carry the
+   * newer timestamp, or purge() could drop it before its updates are
+   * compacted.
+   */
+  void test_timestamp_order(DfsBroker::Client *dfs_client) {
+    PropertiesPtr props_ptr = new Properties();
+    String fname = "/hypertable/test_log/order";
+    CommitLog *log;
+    LogFragmentPriorityMap frag_map;
+    uint32_t payload[1000];
+    DynamicBuffer dbuf;
+    uint64_t old_timestamp, new_timestamp;
+
+    dfs_client->rmdir(fname);
+    dfs_client->mkdirs(fname);
+
+    props_ptr->set("Hypertable.RangeServer.CommitLog.RollLimit", "2000");
+
+    log = new CommitLog(dfs_client, fname, props_ptr);
+
+    old_timestamp = log->get_timestamp();
+    new_timestamp = old_timestamp + 1000;
+
+    for (size_t i=0; i<1000; i++)
+      payload[i] = random();
+
+    dbuf.base = (uint8_t *)payload;
+    dbuf.own = false;
+
+    // small group with the newer timestamp lands first
+    dbuf.ptr = dbuf.base + 40;
+    if (log->write(dbuf, new_timestamp) != Error::OK)
+      HT_THROW(Error::FAILED_EXPECTATION, "Problem writing to log file");
+
+    // large group with the older timestamp lands second and rolls the log
+    dbuf.ptr = dbuf.base + sizeof(payload);
+    if (log->write(dbuf, old_timestamp) != Error::OK)
+      HT_THROW(Error::FAILED_EXPECTATION, "Problem writing to log file");
+
+    log->load_fragment_priority_map(frag_map);
+    delete log;
+
+    HT_EXPECT(frag_map.size() == 1, Error::FAILED_EXPECTATION);
+    HT_EXPECT(frag_map.begin()->first == new_timestamp, Error::FAILED_EXPECTATION);
+  }
+
   void write_entries(CommitLog *log, int num_entries, uint64_t *sump, CommitLogBase *link_log) {
     int error;
     uint64_t timestamp;
@@ -0,0 +1,380 @@
+/**
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <ctime>
+#include <unistd.h>
+
+#include "Common/Error.h"
+#include "Common/InetAddr.h"
+#include "Common/Logger.h"
+
+#include "Hypertable/Lib/RangeServerClient.h"
+#include "Hypertable/Lib/RangeState.h"
+
+#include "Balancer.h"
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  struct BalancerWorker {
+    BalancerWorker(Balancer *balancer, int interval)
+      : m_balancer(balancer), m_interval(interval) { }
+
+    void operator()() {
+      do {
+        int remain = sleep(m_interval);
+
+        if (remain)
+          break; // interrupted
+
+        try {
+          m_balancer->update_statistics();
+          m_balancer->rebalance();
+        }
+        catch (Exception &e) {
+          HT_ERRORF("Balancer: %s - %s", e.what(), Error::get_text(e.code()));
+        }
+      } while (true);
+    }
+
+    BalancerPtr m_balancer;
+    int m_interval;
+  };
+
+  String range_key(const RangeStat &stat) {
+    return format("%u:%s", stat.table_identifier.id, stat.range_spec.end_row);
+  }
+
+  inline double ratio(double value, double mean) {
+    return (mean > 0.0) ? value / mean : 0.0;
+  }
+
+}
+
+
+Balancer::Balancer(PropertiesPtr &props_ptr, Comm *comm) : m_comm(comm) {
+  m_interval = props_ptr->get_int("Hypertable.Master.Balancer.Interval", 60);
+  m_weight_update_rate = props_ptr->get_int("Hypertable.Master.Balancer.Weight.UpdateRate", 4);
+  m_weight_memory = props_ptr->get_int("Hypertable.Master.Balancer.Weight.Memory", 1);
+  m_weight_disk = props_ptr->get_int("Hypertable.Master.Balancer.Weight.Disk", 1);
+  m_weight_ranges = props_ptr->get_int("Hypertable.Master.Balancer.Weight.Ranges", 2);
+  m_move_ranges = props_ptr->get_bool("Hypertable.Master.Balancer.MoveRanges", false);
+  m_move_threshold = props_ptr->get_int("Hypertable.Master.Balancer.MoveThreshold", 150);
+  m_max_range_bytes = props_ptr->get_int64("Hypertable.RangeServer.Range.MaxBytes", 200000000LL);
+
+  if (weight_sum() <= 0) {
+    HT_WARN("Balancer weights don't add up to a positive value, balancing by range count");
+    m_weight_update_rate = m_weight_memory = m_weight_disk = 0;
+    m_weight_ranges = 1;
+  }
+}
+
+
+void Balancer::add_server(RangeServerStatePtr &rs_state) {
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_servers[rs_state->location].rs_state = rs_state;
+}
+
+
+void Balancer::remove_server(const String &location) {
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_servers.erase(location);
+}
+
+
+bool Balancer::select_server(RangeServerStatePtr &rs_state) {
+  boost::mutex::scoped_lock lock(m_mutex);
+  ServerLoadMap::iterator best = m_servers.end();
+  double best_score = 0.0;
+  double penalty = per_range_load();
+
+  /**
+   * Ranges handed out since the last sample aren't reflected in the load
+   * yet, so charge each one the average per-range load.  Without any
+   * statistics this degenerates to round robin.
+   */
+  if (penalty <= 0.0)
+    penalty = 1.0;
+
+  for (ServerLoadMap::iterator iter = m_servers.begin(); iter != m_servers.end(); ++iter) {
+    double score = (*iter).second.load + (*iter).second.assigned * penalty;
+    if (best == m_servers.end() || score < best_score) {
+      best = iter;
+      best_score = score;
+    }
+  }
+
+  if (best == m_servers.end())
+    return false;
+
+  (*best).second.assigned++;
+  rs_state = (*best).second.rs_state;
+  return true;
+}
+
+
+void Balancer::update_statistics() {
+  RangeServerClient rsc(m_comm, 30);
+  vector<RangeServerStatePtr> servers;
+  vector<RangeServerStat> stats;
+  vector<bool> ok;
+
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    for (ServerLoadMap::iterator iter = m_servers.begin(); iter != m_servers.end(); ++iter)
+      servers.push_back((*iter).second.rs_state);
+  }
+
+  stats.resize(servers.size());
+  ok.resize(servers.size(), false);
+
+  for (size_t i = 0; i < servers.size(); i++) {
+    try {
+      rsc.get_statistics(servers[i]->addr, stats[i]);
+      ok[i] = true;
+    }
+    catch (Exception &e) {
+      HT_WARNF("Balancer: unable to get statistics from %s - %s",
+               servers[i]->location.c_str(), Error::get_text(e.code()));
+    }
+  }
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  time_t now = time(0);
+
+  for (size_t i = 0; i < servers.size(); i++) {
+    ServerLoadMap::iterator iter = m_servers.find(servers[i]->location);
+    if (!ok[i] || iter == m_servers.end())
+      continue;
+
+    ServerLoad &server = (*iter).second;
+    map<String, uint64_t> last_updates;
+    double elapsed = (server.have_stats && now > server.last_sample) ?
+        (double)(now - server.last_sample) : 0.0;
+
+    server.ranges.clear();
+    server.update_rate = 0.0;
+    server.memory = 0;
+    server.disk = 0;
+
+    foreach(const RangeStat &stat, stats[i].range_stats) {
+      RangeLoad range;
+      String key = range_key(stat);
+      uint64_t updates = stat.added_inserts + stat.added_deletes[0]
+          + stat.added_deletes[1] + stat.added_deletes[2];
+      map<String, uint64_t>::iterator last_iter = server.last_updates.find(key);
+
+      range.stat = stat;
+      range.update_rate = 0.0;
+      if (elapsed > 0.0 && last_iter != server.last_updates.end()
+          && updates >= (*last_iter).second)
+        range.update_rate = (updates - (*last_iter).second) / elapsed;
+
+      last_updates[key] = updates;
+      server.update_rate += range.update_rate;
+      server.memory += stat.memory_usage;
+      server.disk += stat.disk_usage;
+      server.ranges.push_back(range);
+    }
+
+    server.last_updates.swap(last_updates);
+    server.last_sample = now;
+    server.have_stats = true;
+    server.assigned = 0;
+  }
+
+  ClusterMeans means;
+  compute_means(means);
+
+  for (ServerLoadMap::iterator iter = m_servers.begin(); iter != m_servers.end(); ++iter) {
+    ServerLoad &server = (*iter).second;
+    server.load = (m_weight_update_rate * ratio(server.update_rate, means.update_rate)
+                   + m_weight_memory * ratio(server.memory, means.memory)
+                   + m_weight_disk * ratio(server.disk, means.disk)
+                   + m_weight_ranges * ratio(server.ranges.size(), means.ranges))
+        / weight_sum();
+    HT_DEBUGF("Balancer: %s load=%.3f updates/s=%.1f memory=%llu disk=%llu ranges=%d",
+              (*iter).first.c_str(), server.load, server.update_rate,
+              (Llu)server.memory, (Llu)server.disk, (int)server.ranges.size());
+  }
+}
+
+
+void Balancer::rebalance() {
+  RangeServerStatePtr src, dst;
+  TableIdentifierManaged table;
+  RangeSpecManaged range;
+
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    ServerLoadMap::iterator max_iter = m_servers.end();
+    ServerLoadMap::iterator min_iter = m_servers.end();
+    double total_load = 0.0;
+    size_t count = 0;
+
+    if (!m_move_ranges)
+      return;
+
+    for (ServerLoadMap::iterator iter = m_servers.begin(); iter != m_servers.end(); ++iter) {
+      if (!(*iter).second.have_stats)
+        continue;
+      if (max_iter == m_servers.end() || (*iter).second.load > (*max_iter).second.load)
+        max_iter = iter;
+      if (min_iter == m_servers.end() || (*iter).second.load < (*min_iter).second.load)
+        min_iter = iter;
+      total_load += (*iter).second.load;
+      count++;
+    }
+
+    if (count < 2 || max_iter == min_iter)
+      return;
+
+    ServerLoad &source = (*max_iter).second;
+    ServerLoad &target = (*min_iter).second;
+    double average = total_load / count;
+
+    if (source.load * 100.0 <= average * m_move_threshold || source.ranges.size() <= 1)
+      return;
+
+    /**
+     * Move the busiest range that doesn't simply shift the imbalance over
+     * to the target.  METADATA ranges stay put.
+     */
+    ClusterMeans means;
+    double limit = (source.load - target.load) / 2.0;
+    double best_load = 0.0;
+    const RangeLoad *best = 0;
+
+    compute_means(means);
+
+    foreach(const RangeLoad &rl, source.ranges) {
+      if (rl.stat.table_identifier.id == 0)
+        continue;
+      double load = range_load(rl, means);
+      if (load <= limit && load > best_load) {
+        best = &rl;
+        best_load = load;
+      }
+    }
+
+    if (best == 0)
+      return;
+
+    table = (const TableIdentifier &)best->stat.table_identifier;
+    range = (const RangeSpec &)best->stat.range_spec;
+    src = source.rs_state;
+    dst = target.rs_state;
+
+    // Don't count on this server's numbers until the next sample
+    source.have_stats = false;
+    target.assigned++;
+  }
+
+  RangeServerClient rsc(m_comm, 30);
+  RangeState range_state;
+
+  range_state.soft_limit = m_max_range_bytes;
+
+  HT_INFOF("Balancer: moving range %s[%s..%s] from %s to %s", table.name,
+           range.start_row, range.end_row, src->location.c_str(), dst->location.c_str());
+
+  try {
+    rsc.drop_range(src->addr, table, range);
+  }
+  catch (Exception &e) {
+    HT_WARNF("Balancer: problem relinquishing %s[%s..%s] at %s - %s", table.name,
+             range.start_row, range.end_row, src->location.c_str(), Error::get_text(e.code()));
+    return;
+  }
+
+  try {
+    rsc.load_range(dst->addr, table, range, 0, range_state);
+    return;
+  }
+  catch (Exception &e) {
+    HT_ERRORF("Balancer: problem loading %s[%s..%s] at %s - %s", table.name,
+              range.start_row, range.end_row, dst->location.c_str(), Error::get_text(e.code()));
+  }
+
+  try {
+    rsc.load_range(src->addr, table, range, 0, range_state);
+  }
+  catch (Exception &e) {
+    HT_ERRORF("Balancer: problem reloading %s[%s..%s] at %s, range is offline - %s", table.name,
+              range.start_row, range.end_row, src->location.c_str(), Error::get_text(e.code()));
+  }
+}
+
+
+void Balancer::start(ThreadGroup &threads) {
+  threads.create_thread(BalancerWorker(this, m_interval));
+
+  HT_INFOF("Started balancer thread with interval: %d seconds (range moves %s)",
+           m_interval, m_move_ranges ? "enabled" : "disabled");
+}
+
+
+void Balancer::compute_means(ClusterMeans &means) {
+  size_t count = 0;
+
+  means.update_rate = means.memory = means.disk = means.ranges = 0.0;
+
+  for (ServerLoadMap::iterator iter = m_servers.begin(); iter != m_servers.end(); ++iter) {
+    if (!(*iter).second.have_stats)
+      continue;
+    means.update_rate += (*iter).second.update_rate;
+    means.memory += (*iter).second.memory;
+    means.disk += (*iter).second.disk;
+    means.ranges += (*iter).second.ranges.size();
+    count++;
+  }
+
+  if (count) {
+    means.update_rate /= count;
+    means.memory /= count;
+    means.disk /= count;
+    means.ranges /= count;
+  }
+}
+
+
+double Balancer::range_load(const RangeLoad &range, const ClusterMeans &means) {
+  return (m_weight_update_rate * ratio(range.update_rate, means.update_rate)
+          + m_weight_memory * ratio(range.stat.memory_usage, means.memory)
+          + m_weight_disk * ratio(range.stat.disk_usage, means.disk)
+          + m_weight_ranges * ratio(1.0, means.ranges))
+      / weight_sum();
+}
+
+
+double Balancer::per_range_load() {
+  double total_load = 0.0;
+  size_t total_ranges = 0;
+
+  for (ServerLoadMap::iterator iter = m_servers.begin(); iter != m_servers.end(); ++iter) {
+    total_load += (*iter).second.load;
+    total_ranges += (*iter).second.ranges.size();
+  }
+  return total_ranges ? total_load / total_ranges : 0.0;
+}
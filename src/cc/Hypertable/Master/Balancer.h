@@ -0,0 +1,144 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_BALANCER_H
+#define HYPERTABLE_BALANCER_H
+
+#include <map>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "Common/Properties.h"
+#include "Common/ReferenceCount.h"
+#include "Common/String.h"
+#include "Common/Thread.h"
+
+#include "AsyncComm/Comm.h"
+
+#include "Hypertable/Lib/Stat.h"
+
+#include "RangeServerState.h"
+
+namespace Hypertable {
+
+  /**
+   * Tracks the load of each RangeServer and decides where ranges go.
+   * Statistics are collected periodically with the "get statistics"
+   * command.  Each server gets a load score, which is a weighted sum of its
+   * update rate, memory usage, disk usage and range count, each relative to
+   * the cluster average.  New ranges go to the server with the lowest
+   * score.  If range moves are enabled, a busy range on a server well above
+   * the average is moved to the least loaded server, one range per
+   * interval, using the "drop range" and "load range" commands.
+   */
+  class Balancer : public ReferenceCount {
+  public:
+    Balancer(PropertiesPtr &props_ptr, Comm *comm);
+
+    void add_server(RangeServerStatePtr &rs_state);
+    void remove_server(const String &location);
+
+    /**
+     * Picks the server that should receive a new range.  Until statistics
+     * are available this falls back to spreading ranges evenly.
+     *
+     * @param rs_state set to the chosen server
+     * @return false if no servers are registered
+     */
+    bool select_server(RangeServerStatePtr &rs_state);
+
+    /**
+     * Fetches statistics from every server and recomputes load scores.
+     * No lock is held while talking to the servers.
+     */
+    void update_statistics();
+
+    /**
+     * Moves at most one range from the most loaded server to the least
+     * loaded one if moves are enabled and the imbalance is over the
+     * threshold.
+     */
+    void rebalance();
+
+    /**
+     * Starts the thread that calls update_statistics() and rebalance()
+     * every interval.
+     */
+    void start(ThreadGroup &threads);
+
+  private:
+
+    struct RangeLoad {
+      RangeStat stat;
+      double    update_rate;
+    };
+
+    struct ServerLoad {
+      ServerLoad() : update_rate(0.0), memory(0), disk(0), load(0.0),
+                     assigned(0), last_sample(0), have_stats(false) { }
+      RangeServerStatePtr rs_state;
+      std::vector<RangeLoad> ranges;
+      std::map<String, uint64_t> last_updates;
+      double   update_rate;
+      uint64_t memory;
+      uint64_t disk;
+      double   load;
+      size_t   assigned;
+      time_t   last_sample;
+      bool     have_stats;
+    };
+
+    typedef std::map<String, ServerLoad> ServerLoadMap;
+
+    struct ClusterMeans {
+      double update_rate;
+      double memory;
+      double disk;
+      double ranges;
+    };
+
+    void compute_means(ClusterMeans &means);
+    double range_load(const RangeLoad &range, const ClusterMeans &means);
+    double per_range_load();
+    int weight_sum() {
+      return m_weight_update_rate + m_weight_memory + m_weight_disk
+          + m_weight_ranges;
+    }
+
+    boost::mutex   m_mutex;
+    Comm          *m_comm;
+    ServerLoadMap  m_servers;
+    int            m_interval;
+    int            m_weight_update_rate;
+    int            m_weight_memory;
+    int            m_weight_disk;
+    int            m_weight_ranges;
+    bool           m_move_ranges;
+    int            m_move_threshold;
+    uint64_t       m_max_range_bytes;
+  };
+
+  typedef boost::intrusive_ptr<Balancer> BalancerPtr;
+
+}
+
+#endif // HYPERTABLE_BALANCER_H
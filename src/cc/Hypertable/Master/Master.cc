@@ -62,8 +62,6 @@ Master::Master(ConnectionManagerPtr &conn_mgr, PropertiesPtr &props_ptr, Applica
   Client *dfs_client;
   uint16_t port;
 
-  m_server_map_iter = m_server_map.begin();
-
   m_hyperspace_ptr = new Hyperspace::Session(conn_mgr->get_comm(), props_ptr, &m_hyperspace_session_handler);
 
   if (!m_hyperspace_ptr->wait_for_connection(30)) {
@@ -80,6 +78,8 @@ Master::Master(ConnectionManagerPtr &conn_mgr, PropertiesPtr &props_ptr, Applica
 
   m_max_range_bytes = props_ptr->get_int64("Hypertable.RangeServer.Range.MaxBytes", 200000000LL);
 
+  m_balancer_ptr = new Balancer(props_ptr, conn_mgr->get_comm());
+
   /**
    * Create DFS Client connection
    */
@@ -159,6 +159,8 @@ Master::Master(ConnectionManagerPtr &conn_mgr, PropertiesPtr &props_ptr, Applica
   scan_servers_directory();
 
   master_gc_start(props_ptr, m_threads, m_metadata_table_ptr, m_dfs_client);
+
+  m_balancer_ptr->start(m_threads);
 }
 
 
@@ -194,10 +196,6 @@ void Master::server_left(const String &location) {
     return;
   }
 
-  // if we're about to delete the item pointing to the server map iterator, then advance the iterator
-  if (iter == m_server_map_iter)
-    m_server_map_iter++;
-
   m_hyperspace_ptr->try_lock((*iter).second->hyperspace_handle, LOCK_MODE_EXCLUSIVE, &lock_status, &lock_sequencer);
 
   if (lock_status != LOCK_STATUS_GRANTED) {
@@ -208,6 +206,7 @@ void Master::server_left(const String &location) {
   m_hyperspace_ptr->unlink(hsfname);
   m_hyperspace_ptr->close((*iter).second->hyperspace_handle);
   m_server_map.erase(iter);
+  m_balancer_ptr->remove_server(location);
   if (m_server_map.empty())
     m_no_servers_cond.notify_all();
 
@@ -336,8 +335,10 @@ void Master::register_server(ResponseCallback *cb, const char *location, struct
       m_hyperspace_ptr->unlink(hsfname);
       m_hyperspace_ptr->close(rs_state->hyperspace_handle);
     }
-    else
+    else {
       m_server_map[rs_state->location] = rs_state;
+      m_balancer_ptr->add_server(rs_state);
+    }
 
     {
       String addr_str;
@@ -464,13 +465,14 @@ void Master::register_server(ResponseCallback *cb, const char *location, struct
 }
 
 /**
- * TEMPORARY: Just turns around and assigns new range to caller
+ * Assigns the newly split off range to the least loaded server
  *
  * NOTE: this call can't be protected by a mutex because it can cause the
  * whole system to wedge under certain situations
  */
 void Master::report_split(ResponseCallback *cb, TableIdentifier &table, RangeSpec &range, const char *transfer_log_dir, uint64_t soft_limit) {
   struct sockaddr_in addr;
+  RangeServerStatePtr rs_state;
   RangeServerClient rsc(m_conn_manager_ptr->get_comm(), 30);
 
   HT_INFOF("Entering report_split for %s[%s:%s].", table.name, range.start_row, range.end_row);
@@ -479,12 +481,9 @@ void Master::report_split(ResponseCallback *cb, TableIdentifier &table, RangeSpe
 
   {
     boost::mutex::scoped_lock lock(m_mutex);
-    if (m_server_map_iter == m_server_map.end())
-      m_server_map_iter = m_server_map.begin();
-    assert(m_server_map_iter != m_server_map.end());
-    memcpy(&addr, &((*m_server_map_iter).second->addr), sizeof(struct sockaddr_in));
-    HT_INFOF("Assigning newly reported range %s[%s:%s] to %s", table.name, range.start_row, range.end_row, (*m_server_map_iter).first.c_str());
-    m_server_map_iter++;
+    HT_EXPECT(m_balancer_ptr->select_server(rs_state), Error::FAILED_EXPECTATION);
+    memcpy(&addr, &rs_state->addr, sizeof(struct sockaddr_in));
+    HT_INFOF("Assigning newly reported range %s[%s:%s] to %s", table.name, range.start_row, range.end_row, rs_state->location.c_str());
   }
 
   //cb->get_address(addr);
@@ -789,12 +788,10 @@ Master::create_table(const char *tablename, const char *schemastr) {
 
     {
       boost::mutex::scoped_lock lock(m_mutex);
-      if (m_server_map_iter == m_server_map.end())
-        m_server_map_iter = m_server_map.begin();
-      assert(m_server_map_iter != m_server_map.end());
-      memcpy(&addr, &((*m_server_map_iter).second->addr), sizeof(struct sockaddr_in));
-      HT_INFOF("Assigning first range %s[%s:%s] to %s", table.name, range.start_row, range.end_row, (*m_server_map_iter).first.c_str());
-      m_server_map_iter++;
+      RangeServerStatePtr rs_state;
+      HT_EXPECT(m_balancer_ptr->select_server(rs_state), Error::FAILED_EXPECTATION);
+      memcpy(&addr, &rs_state->addr, sizeof(struct sockaddr_in));
+      HT_INFOF("Assigning first range %s[%s:%s] to %s", table.name, range.start_row, range.end_row, rs_state->location.c_str());
       soft_limit = m_max_range_bytes / std::min(64, (int)m_server_map.size()*2);
     }
 
@@ -920,7 +917,10 @@ void Master::scan_servers_directory() {
 	m_hyperspace_ptr->close(rs_state->hyperspace_handle);
       }
       else {
+	if (!LocationCache::location_to_addr(listing[i].name.c_str(), rs_state->addr))
+	  HT_ERRORF("Problem creating address from location '%s'", listing[i].name.c_str());
 	m_server_map[rs_state->location] = rs_state;
+	m_balancer_ptr->add_server(rs_state);
       }
     }
   }
@@ -43,6 +43,7 @@
 #include "Hypertable/Lib/Table.h"
 #include "Hypertable/Lib/Types.h"
 
+#include "Balancer.h"
 #include "HyperspaceSessionHandler.h"
 #include "RangeServerState.h"
 #include "ResponseCallbackGetSchema.h"
@@ -98,7 +99,7 @@ namespace Hypertable {
     typedef hash_map<String, RangeServerStatePtr> ServerMap;
 
     ServerMap  m_server_map;
-    ServerMap::iterator m_server_map_iter;
+    BalancerPtr m_balancer_ptr;
     boost::condition  m_no_servers_cond;
 
     ThreadGroup m_threads;
@@ -47,8 +47,10 @@ namespace {
 AccessGroup::AccessGroup(const TableIdentifier *identifier, SchemaPtr &schema_ptr,
                          Schema::AccessGroup *ag, const RangeSpec *range)
     : m_identifier(*identifier), m_schema_ptr(schema_ptr), m_name(ag->name),
+      m_bytes_written(0), m_bytes_flushed(0),
       m_next_table_id(0), m_disk_usage(0), m_blocksize(DEFAULT_BLOCKSIZE),
-      m_compression_ratio(1.0), m_is_root(false), m_oldest_cached_timestamp(0),
+      m_compression_ratio(1.0), m_bloom_filter_mode(CellStore::BLOOM_FILTER_DISABLED),
+      m_is_root(false), m_oldest_cached_timestamp(0),
       m_collisions(0), m_needs_compaction(false), m_drop(false),
       m_scanners_blocked(false) {
   m_table_name = m_identifier.name;
@@ -65,9 +67,16 @@ AccessGroup::AccessGroup(const TableIdentifier *identifier, SchemaPtr &schema_pt
 
   m_compressor = (ag->compressor != "") ? ag->compressor : schema_ptr->get_compressor();
 
+  if (ag->bloom_filter == "rows")
+    m_bloom_filter_mode = CellStore::BLOOM_FILTER_ROWS;
+  else if (ag->bloom_filter == "rows+cols")
+    m_bloom_filter_mode = CellStore::BLOOM_FILTER_ROWS_COLS;
+
   m_is_root = (m_identifier.id == 0 && *range->start_row == 0 && !strcmp(range->end_row, Key::END_ROOT_ROW));
 
   m_in_memory = ag->in_memory;
+
+  m_compaction_policy = CompactionPolicy::create(ag);
 }
 
 
@@ -103,9 +112,9 @@ AccessGroup::~AccessGroup() {
 }
 
 /**
- * This should be called with the CellCache locked
+ * This should be called with the access group locked (see #lock)
  * Also, at the end of compaction processing, when m_cell_cache_ptr gets reset to a new value,
- * the CellCache should be locked as well.
+ * the update mutex and the CellCache should be locked as well.
  */
 int AccessGroup::add(const ByteString key, const ByteString value, int64_t real_timestamp) {
   // assumes timestamps are coming in order
@@ -140,6 +149,8 @@ CellListScanner *AccessGroup::create_scanner(ScanContextPtr &scan_context_ptr) {
   if (!m_in_memory) {
     CellStoreReleaseCallback callback(this);
     for (size_t i=0; i<m_stores.size(); i++) {
+      if (!m_stores[i]->may_contain(scan_context_ptr))
+        continue;
       scanner->add_scanner(m_stores[i]->create_scanner(scan_context_ptr));
       filename = m_stores[i]->get_filename();
       callback.add_file(filename);
@@ -198,6 +209,7 @@ uint64_t AccessGroup::memory_usage() {
 }
 
 void AccessGroup::get_compaction_priority_data(CompactionPriorityData &priority_data) {
+  boost::mutex::scoped_lock update_lock(m_update_mutex);
   boost::mutex::scoped_lock lock(m_mutex);
   priority_data.ag = this;
   priority_data.oldest_cached_timestamp = m_oldest_cached_timestamp;
@@ -206,10 +218,26 @@ void AccessGroup::get_compaction_priority_data(CompactionPriorityData &priority_
   priority_data.disk_used = m_disk_usage + (uint64_t)(m_compression_ratio * (float)mu);
   priority_data.in_memory = m_in_memory;
   priority_data.deletes = m_cell_cache_ptr->get_delete_count();
+  priority_data.store_count = m_stores.size();
+  priority_data.merge_count = 0;
+  if (!m_in_memory) {
+    std::vector<CellStorePtr> stores = m_stores;
+    priority_data.merge_count = stores.size() -
+        m_compaction_policy->select(stores, (uint64_t)(m_compression_ratio * (float)mu));
+  }
+  priority_data.log_space_pinned = 0;
+}
+
+
+void AccessGroup::purge_store_indexes(time_t expire_time) {
+  boost::mutex::scoped_lock lock(m_mutex);
+  for (size_t i=0; i<m_stores.size(); i++)
+    m_stores[i]->purge_index(expire_time);
 }
 
 
 void AccessGroup::add_cell_store(CellStorePtr &cellstore_ptr, uint32_t id) {
+  boost::mutex::scoped_lock update_lock(m_update_mutex);
   boost::mutex::scoped_lock lock(m_mutex);
 
   // Figure out the "next" CellStore number
@@ -247,15 +275,6 @@ void AccessGroup::add_cell_store(CellStorePtr &cellstore_ptr, uint32_t id) {
 }
 
 
-namespace {
-  struct LtCellStore {
-    bool operator()(const CellStorePtr &x, const CellStorePtr &y) const {
-      return !(x->disk_usage() < y->disk_usage());
-    }
-  };
-}
-
-
 void AccessGroup::run_compaction(Timestamp timestamp, bool major) {
   ByteString bskey;
   ByteString value;
@@ -264,6 +283,7 @@ void AccessGroup::run_compaction(Timestamp timestamp, bool major) {
   size_t tableidx = 1;
   CellStorePtr cellstore;
   String metadata_key_str;
+  uint64_t merged_bytes = 0;
 
   if (!major && !m_needs_compaction)
     return;
@@ -288,12 +308,12 @@ void AccessGroup::run_compaction(Timestamp timestamp, bool major) {
                m_range_name.c_str(), m_name.c_str());
     }
     else {
-      if (m_stores.size() > (size_t)Global::access_group_max_files) {
-        LtCellStore ascending;
-        sort(m_stores.begin(), m_stores.end(), ascending);
-        tableidx = m_stores.size() - Global::access_group_merge_files;
-        HT_INFOF("Starting Merging Compaction of %s(%s)",
-                 m_range_name.c_str(), m_name.c_str());
+      uint64_t cache_bytes = (uint64_t)(m_compression_ratio * (float)m_cell_cache_ptr->memory_used());
+      tableidx = m_compaction_policy->select(m_stores, cache_bytes);
+      if (tableidx < m_stores.size()) {
+        HT_INFOF("Starting Merging Compaction of %s(%s) [%s, %d of %d stores]",
+                 m_range_name.c_str(), m_name.c_str(), m_compaction_policy->name(),
+                 (int)(m_stores.size() - tableidx), (int)m_stores.size());
       }
       else {
         if (m_cell_cache_ptr->memory_used() == 0)
@@ -320,7 +340,7 @@ void AccessGroup::run_compaction(Timestamp timestamp, bool major) {
 
   cellstore = new CellStoreV0(Global::dfs);
 
-  if (cellstore->create(cs_file.c_str(), m_blocksize, m_compressor) != 0) {
+  if (cellstore->create(cs_file.c_str(), m_blocksize, m_compressor, m_bloom_filter_mode) != 0) {
     HT_ERRORF("Problem compacting locality group to file '%s'", cs_file.c_str());
     return;
   }
@@ -367,6 +387,7 @@ void AccessGroup::run_compaction(Timestamp timestamp, bool major) {
    * Install new CellCache and CellStore
    */
   {
+    boost::mutex::scoped_lock update_lock(m_update_mutex);
     boost::mutex::scoped_lock lock(m_mutex);
     CellCachePtr tmp_cell_cache_ptr;
 
@@ -382,6 +403,9 @@ void AccessGroup::run_compaction(Timestamp timestamp, bool major) {
     m_oldest_cached_timestamp = (m_cell_cache_ptr->size() > 0) ? timestamp.real + 1 : 0;
     tmp_cell_cache_ptr->unlock();
 
+    for (size_t i=(m_in_memory ? 0 : tableidx); i<m_stores.size(); i++)
+      merged_bytes += m_stores[i]->disk_usage();
+
     /** Drop the compacted tables from the table vector **/
     if (tableidx < m_stores.size()) {
       m_stores.resize(tableidx);
@@ -399,6 +423,11 @@ void AccessGroup::run_compaction(Timestamp timestamp, bool major) {
     m_stores.push_back(cellstore);
     m_live_files.insert(cellstore->get_filename());
 
+    /** Data that was in a store before counts as rewritten, not new **/
+    m_bytes_written += cellstore->disk_usage();
+    if (cellstore->disk_usage() > merged_bytes)
+      m_bytes_flushed += cellstore->disk_usage() - merged_bytes;
+
     /** Determine in-use files to prevent from being GC'd **/
     m_gc_locked_files.clear();
     foreach(const FileRefCountMap::value_type &v, m_file_refcounts)
@@ -435,6 +464,7 @@ void AccessGroup::run_compaction(Timestamp timestamp, bool major) {
  *
  */
 int AccessGroup::shrink(String &new_start_row) {
+  boost::mutex::scoped_lock update_lock(m_update_mutex);
   boost::mutex::scoped_lock lock(m_mutex);
   int error;
   CellCachePtr old_cell_cache_ptr = m_cell_cache_ptr;
@@ -38,6 +38,7 @@
 
 #include "CellCache.h"
 #include "CellStore.h"
+#include "CompactionPolicy.h"
 
 
 namespace Hypertable {
@@ -53,6 +54,8 @@ namespace Hypertable {
       uint64_t disk_used;
       uint64_t log_space_pinned;
       uint32_t deletes;
+      uint32_t store_count;
+      uint32_t merge_count;
       void *user_data;
       bool in_memory;
     };
@@ -66,8 +69,14 @@ namespace Hypertable {
     virtual void get_split_rows(std::vector<String> &split_rows, bool include_cache);
     virtual void get_cached_rows(std::vector<String> &rows);
 
-    void lock() { m_mutex.lock(); m_cell_cache_ptr->lock(); }
-    void unlock() { m_cell_cache_ptr->unlock(); m_mutex.unlock(); }
+    /**
+     * Locks the access group for applying updates.  This takes the update
+     * mutex and the CellCache writer lock but not m_mutex, so scanners can
+     * be created and can read the CellCache while updates are applied.
+     * Anything that replaces m_cell_cache_ptr must hold both mutexes.
+     */
+    void lock() { m_update_mutex.lock(); m_cell_cache_ptr->lock(); }
+    void unlock() { m_cell_cache_ptr->unlock(); m_update_mutex.unlock(); }
 
     CellListScanner *create_scanner(ScanContextPtr &scan_ctx);
 
@@ -79,12 +88,18 @@ namespace Hypertable {
 
     void get_compaction_timestamp(Timestamp &timestamp);
     int64_t get_oldest_cached_timestamp() {
-      boost::mutex::scoped_lock lock(m_mutex);
+      boost::mutex::scoped_lock lock(m_update_mutex);
       return m_oldest_cached_timestamp;
     }
 
     void get_compaction_priority_data(CompactionPriorityData &priority_data);
 
+    /**
+     * Frees the block indexes of this group's cell stores that have not
+     * been used since expire_time
+     */
+    void purge_store_indexes(time_t expire_time);
+
     void set_compaction_bit() { m_needs_compaction = true; }
 
     bool needs_compaction() { return m_needs_compaction; }
@@ -105,6 +120,25 @@ namespace Hypertable {
 
     void drop() { m_drop = true; }
 
+    /**
+     * Bytes written to cell stores by compactions per byte of new data
+     * written out of the cell cache
+     */
+    double get_write_amplification() {
+      boost::mutex::scoped_lock lock(m_mutex);
+      return (m_bytes_flushed == 0) ? 0.0 : (double)m_bytes_written / (double)m_bytes_flushed;
+    }
+
+    /**
+     * Number of cell lists (stores plus the cell cache) a scan merges
+     */
+    uint32_t get_read_amplification() {
+      boost::mutex::scoped_lock lock(m_mutex);
+      return (m_in_memory) ? 1 : m_stores.size() + 1;
+    }
+
+    const char *get_compaction_policy_name() { return m_compaction_policy->name(); }
+
     void get_files(String &text);
 
     void release_files(const std::vector<String> &files);
@@ -118,6 +152,7 @@ namespace Hypertable {
     void update_files_column();
 
     Mutex                m_mutex;
+    Mutex                m_update_mutex;
     boost::condition     m_scanner_blocked_cond;
     TableIdentifierManaged m_identifier;
     SchemaPtr            m_schema_ptr;
@@ -128,12 +163,16 @@ namespace Hypertable {
     String               m_end_row;
     String               m_range_name;
     std::vector<CellStorePtr> m_stores;
+    CompactionPolicyPtr  m_compaction_policy;
+    uint64_t             m_bytes_written;
+    uint64_t             m_bytes_flushed;
     CellCachePtr         m_cell_cache_ptr;
     uint32_t             m_next_table_id;
     uint64_t             m_disk_usage;
     uint32_t             m_blocksize;
     float                m_compression_ratio;
     String               m_compressor;
+    CellStore::BloomFilterMode m_bloom_filter_mode;
     bool                 m_is_root;
     Timestamp            m_compaction_timestamp;
     int64_t              m_oldest_cached_timestamp;
@@ -0,0 +1,134 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cassert>
+#include <memory>
+
+#include "Common/Logger.h"
+
+#include "Hypertable/Lib/BlockCompressionHeader.h"
+#include "Hypertable/Lib/CompressorFactory.h"
+
+#include "BlockCompressorPool.h"
+
+using namespace Hypertable;
+
+
+BlockCompressorPool::BlockCompressorPool(int worker_count, const char *magic,
+    BlockCompressionCodec::Type type, const BlockCompressionCodec::Args &args)
+  : m_next_unclaimed(0), m_shutdown(false), m_worker_count(worker_count),
+    m_magic(magic), m_type(type), m_args(args) {
+  assert(worker_count > 0);
+  for (int i=0; i<worker_count; i++)
+    m_threads.create_thread(Worker(this));
+}
+
+
+BlockCompressorPool::~BlockCompressorPool() {
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_shutdown = true;
+    m_work_cond.notify_all();
+  }
+  m_threads.join_all();
+  foreach(Block *block, m_blocks)
+    delete block;
+}
+
+
+void BlockCompressorPool::add(Block *block) {
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_blocks.push_back(block);
+  m_work_cond.notify_one();
+}
+
+
+BlockCompressorPool::Block *BlockCompressorPool::next(bool wait) {
+  boost::mutex::scoped_lock lock(m_mutex);
+  Block *block;
+
+  if (m_blocks.empty())
+    return 0;
+
+  while (!m_blocks.front()->done) {
+    if (!wait)
+      return 0;
+    m_done_cond.wait(lock);
+  }
+
+  block = m_blocks.front();
+  m_blocks.pop_front();
+  m_next_unclaimed--;
+  return block;
+}
+
+
+/**
+ * The codec is created on the worker thread since codecs keep per-stream
+ * state and are not meant to be shared between threads.
+ */
+void BlockCompressorPool::Worker::operator()() {
+  std::auto_ptr<BlockCompressionCodec> codec;
+  Block *block;
+
+  try {
+    codec.reset(CompressorFactory::create_block_codec(m_pool->m_type,
+                                                      m_pool->m_args));
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << "Problem creating block compression codec: " << e << HT_END;
+  }
+
+  while (true) {
+
+    {
+      boost::mutex::scoped_lock lock(m_pool->m_mutex);
+      while (!m_pool->m_shutdown &&
+             m_pool->m_next_unclaimed >= m_pool->m_blocks.size())
+        m_pool->m_work_cond.wait(lock);
+      if (m_pool->m_shutdown)
+        return;
+      block = m_pool->m_blocks[m_pool->m_next_unclaimed++];
+    }
+
+    if (codec.get() == 0) {
+      block->error = Error::BLOCK_COMPRESSOR_UNSUPPORTED_TYPE;
+      block->error_msg = "Unable to create block compression codec";
+    }
+    else {
+      try {
+        BlockCompressionHeader header(m_pool->m_magic);
+        codec->deflate(block->raw, block->zbuf, header);
+      }
+      catch (Exception &e) {
+        block->error = e.code();
+        block->error_msg = e.what();
+      }
+    }
+
+    {
+      boost::mutex::scoped_lock lock(m_pool->m_mutex);
+      block->done = true;
+      m_pool->m_done_cond.notify_all();
+    }
+  }
+}
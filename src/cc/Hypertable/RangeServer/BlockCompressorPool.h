@@ -0,0 +1,113 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_BLOCKCOMPRESSORPOOL_H
+#define HYPERTABLE_BLOCKCOMPRESSORPOOL_H
+
+#include <deque>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "Common/DynamicBuffer.h"
+#include "Common/Error.h"
+#include "Common/Thread.h"
+
+#include "Hypertable/Lib/BlockCompressionCodec.h"
+
+namespace Hypertable {
+
+  /**
+   * Compresses blocks on a pool of worker threads, each with its own codec,
+   * and hands them back in the order they were added.  The caller keeps
+   * the number of blocks in the pool bounded by taking finished blocks out
+   * with next() as it adds new ones.
+   */
+  class BlockCompressorPool : boost::noncopyable {
+  public:
+
+    struct Block {
+      Block() : raw(0), zbuf(0), last_key(0), done(false), error(Error::OK) { }
+      DynamicBuffer raw;
+      DynamicBuffer zbuf;
+      DynamicBuffer last_key;
+      bool          done;
+      int           error;
+      String        error_msg;
+    };
+
+    BlockCompressorPool(int worker_count, const char *magic,
+                        BlockCompressionCodec::Type type,
+                        const BlockCompressionCodec::Args &args);
+
+    /**
+     * Stops the workers and frees the blocks still in the pool
+     */
+    ~BlockCompressorPool();
+
+    /**
+     * Queues a block for compression.  The pool takes ownership of it.
+     */
+    void add(Block *block);
+
+    /**
+     * Removes the oldest block from the pool once it has been compressed.
+     *
+     * @param wait if true, waits for the oldest block to be compressed
+     * @return the oldest block, or 0 if the pool is empty or, when not
+     *         waiting, the oldest block is not done yet
+     */
+    Block *next(bool wait);
+
+    size_t size() {
+      boost::mutex::scoped_lock lock(m_mutex);
+      return m_blocks.size();
+    }
+
+    int get_worker_count() { return m_worker_count; }
+
+  private:
+
+    class Worker {
+    public:
+      Worker(BlockCompressorPool *pool) : m_pool(pool) { }
+      void operator()();
+    private:
+      BlockCompressorPool *m_pool;
+    };
+
+    boost::mutex                 m_mutex;
+    boost::condition             m_work_cond;
+    boost::condition             m_done_cond;
+    std::deque<Block *>          m_blocks;
+    size_t                       m_next_unclaimed;
+    bool                         m_shutdown;
+    int                          m_worker_count;
+    const char                  *m_magic;
+    BlockCompressionCodec::Type  m_type;
+    BlockCompressionCodec::Args  m_args;
+    ThreadGroup                  m_threads;
+  };
+
+}
+
+#endif // HYPERTABLE_BLOCKCOMPRESSORPOOL_H
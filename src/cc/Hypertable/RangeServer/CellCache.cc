@@ -35,44 +35,19 @@ using namespace Hypertable;
 using namespace std;
 
 
-const uint32_t CellCache::ALLOC_BIT_MASK  = 0x80000000;
-const uint32_t CellCache::OFFSET_BIT_MASK = 0x7FFFFFFF;
-
-
 //#define STAT
 
 
 CellCache::~CellCache() {
-  uint64_t mem_freed = 0;
-  uint32_t offset;
-  uint8_t *ptr;
-#ifdef STAT
-  uint32_t skipped = 0;
-#endif
-
-  for (CellMap::iterator iter = m_cell_map.begin(); iter != m_cell_map.end(); iter++) {
-    if (((*iter).second & ALLOC_BIT_MASK) == 0) {
-      ptr = (uint8_t *)(*iter).first.ptr;
-      offset = (*iter).second & OFFSET_BIT_MASK;
-      mem_freed += offset + ByteString(ptr + offset).length();
-      delete [] ptr;
-    }
-#ifdef STAT
-    else
-      skipped++;
-#endif
-  }
-
 #ifdef STAT
   cout << flush;
-  cout << "STAT[~CellCache]\tmemory freed\t" << mem_freed << endl;
-  cout << "STAT[~CellCache]\tentries skipped\t" << skipped << endl;
+  cout << "STAT[~CellCache]\tmemory freed\t" << m_memory_used << endl;
   cout << "STAT[~CellCache]\tentries total\t" << m_cell_map.size() << endl;
+  cout << "STAT[~CellCache]\tarena\t" << m_arena << endl;
 #endif
 
-  Global::memory_tracker.remove_memory(mem_freed);
+  Global::memory_tracker.remove_memory(m_memory_used);
   Global::memory_tracker.remove_items(m_cell_map.size());
-
 }
 
 
@@ -80,27 +55,16 @@ CellCache::~CellCache() {
 /**
  */
 int CellCache::add(const ByteString key, const ByteString value, int64_t real_timestamp) {
-  ByteString new_key;
-  uint8_t *ptr;
   size_t key_len = key.length();
-  size_t total_len = key_len + value.length();
 
   (void)real_timestamp;
 
-  new_key.ptr = ptr = new uint8_t [total_len];
-
-  memcpy(ptr, key.ptr, key_len);
-  ptr += key_len;
-
-  value.write(ptr);
-
-  if (! m_cell_map.insert(CellMap::value_type(new_key, key_len)).second) {
+  if (m_cell_map.insert(key, value) == 0) {
     m_collisions++;
-    HT_WARNF("Collision detected key insert (row = %s)", new_key.str());
-    delete [] new_key.ptr;
+    HT_WARNF("Collision detected key insert (row = %s)", key.str());
   }
   else {
-    m_memory_used += total_len;
+    m_memory_used += key_len + value.length();
     if (key.ptr[key_len - 9] <= FLAG_DELETE_CELL)
       m_deletes++;
   }
@@ -110,6 +74,16 @@ int CellCache::add(const ByteString key, const ByteString value, int64_t real_ti
 
 
 
+/**
+ * Copies an entry from another cache into this one.  Used when building
+ * the sliced and purged copies, so no collisions are expected.
+ */
+void CellCache::copy_entry(const CellMap::Node *node) {
+  add(node->key(), node->value(), 0);
+}
+
+
+
 const char *CellCache::get_split_row() {
   assert(!"CellCache::get_split_row not implemented!");
   return 0;
@@ -118,23 +92,21 @@ const char *CellCache::get_split_row() {
 
 
 void CellCache::get_split_rows(std::vector<std::string> &split_rows) {
-  boost::mutex::scoped_lock lock(m_mutex);
   if (m_cell_map.size() > 2) {
-    CellMap::const_iterator iter = m_cell_map.begin();
+    CellMap::Node *node = m_cell_map.first();
     size_t i=0, mid = m_cell_map.size() / 2;
     for (i=0; i<mid; i++)
-      iter++;
-    split_rows.push_back((*iter).first.str());
+      node = CellMap::next(node);
+    split_rows.push_back(node->key().str());
   }
 }
 
 
 
 void CellCache::get_rows(std::vector<std::string> &rows) {
-  boost::mutex::scoped_lock lock(m_mutex);
   const char *row, *last_row = "";
-  for (CellMap::const_iterator iter = m_cell_map.begin(); iter != m_cell_map.end(); iter++) {
-    row = (*iter).first.str();
+  for (CellMap::Node *node = m_cell_map.first(); node; node = CellMap::next(node)) {
+    row = node->key().str();
     if (strcmp(row, last_row)) {
       rows.push_back(row);
       last_row = row;
@@ -160,19 +132,17 @@ CellCache *CellCache::slice_copy(int64_t timestamp) {
   uint64_t dropped = 0;
 #endif
 
-  CellCachePtr child_ptr = new CellCache();
+  CellCache *child = new CellCache();
 
-  for (CellMap::iterator iter = m_cell_map.begin(); iter != m_cell_map.end(); iter++) {
+  for (CellMap::Node *node = m_cell_map.first(); node; node = CellMap::next(node)) {
 
-    if (!key.load((*iter).first)) {
+    if (!key.load(node->key())) {
       HT_ERROR("Problem deserializing key/value pair");
       continue;
     }
 
-    if (key.timestamp > timestamp) {
-      child_ptr->m_cell_map.insert(CellMap::value_type((*iter).first, (*iter).second));
-      (*iter).second |= ALLOC_BIT_MASK;  // mark this entry in the "old" map so it doesn't get deleted
-    }
+    if (key.timestamp > timestamp)
+      child->copy_entry(node);
 #ifdef STAT
     else
       dropped++;
@@ -184,11 +154,10 @@ CellCache *CellCache::slice_copy(int64_t timestamp) {
   cout << "STAT[slice_copy]\tdropped\t" << dropped << endl;
 #endif
 
-  Global::memory_tracker.add_items(child_ptr->m_cell_map.size());
-
-  m_children.push_back(child_ptr);
+  Global::memory_tracker.add_memory(child->m_memory_used);
+  Global::memory_tracker.add_items(child->m_cell_map.size());
 
-  return child_ptr.get();
+  return child;
 }
 
 
@@ -205,19 +174,19 @@ CellCache *CellCache::purge_deletes() {
   int64_t       deleted_column_family_timestamp = 0;
   DynamicBuffer deleted_cell(0);
   int64_t       deleted_cell_timestamp = 0;
-  CellMap::iterator iter;
+  CellMap::Node *node;
 
   HT_INFO("Purging deletes from CellCache");
 
-  CellCachePtr child_ptr = new CellCache();
+  CellCache *child = new CellCache();
 
-  iter = m_cell_map.begin();
+  node = m_cell_map.first();
 
-  while (iter != m_cell_map.end()) {
+  while (node) {
 
-    if (!key_comps.load((*iter).first)) {
+    if (!key_comps.load(node->key())) {
       HT_ERROR("Problem deserializing key/value pair");
-      iter++;
+      node = CellMap::next(node);
       continue;
     }
 
@@ -227,11 +196,9 @@ CellCache *CellCache::purge_deletes() {
         if (deleted_cell.fill() > 0) {
           len = (key_comps.column_qualifier - key_comps.row) + strlen(key_comps.column_qualifier) + 1;
           if (deleted_cell.fill() == len && !memcmp(deleted_cell.base, key_comps.row, len)) {
-            if (key_comps.timestamp > deleted_cell_timestamp) {
-              child_ptr->m_cell_map.insert(CellMap::value_type((*iter).first, (*iter).second));
-              (*iter).second |= ALLOC_BIT_MASK;  // mark this entry in the "old" map so it doesn't get deleted
-            }
-            iter++;
+            if (key_comps.timestamp > deleted_cell_timestamp)
+              child->copy_entry(node);
+            node = CellMap::next(node);
             continue;
           }
           deleted_cell.clear();
@@ -239,11 +206,9 @@ CellCache *CellCache::purge_deletes() {
         if (deleted_column_family.fill() > 0) {
           len = key_comps.column_qualifier - key_comps.row;
           if (deleted_column_family.fill() == len && !memcmp(deleted_column_family.base, key_comps.row, len)) {
-            if (key_comps.timestamp > deleted_column_family_timestamp) {
-              child_ptr->m_cell_map.insert(CellMap::value_type((*iter).first, (*iter).second));
-              (*iter).second |= ALLOC_BIT_MASK;  // mark this entry in the "old" map so it doesn't get deleted
-            }
-            iter++;
+            if (key_comps.timestamp > deleted_column_family_timestamp)
+              child->copy_entry(node);
+            node = CellMap::next(node);
             continue;
           }
           deleted_column_family.clear();
@@ -251,20 +216,17 @@ CellCache *CellCache::purge_deletes() {
         if (deleted_row.fill() > 0) {
           len = strlen(key_comps.row) + 1;
           if (deleted_row.fill() == len && !memcmp(deleted_row.base, key_comps.row, len)) {
-            if (key_comps.timestamp > deleted_row_timestamp) {
-              child_ptr->m_cell_map.insert(CellMap::value_type((*iter).first, (*iter).second));
-              (*iter).second |= ALLOC_BIT_MASK;  // mark this entry in the "old" map so it doesn't get deleted
-            }
-            iter++;
+            if (key_comps.timestamp > deleted_row_timestamp)
+              child->copy_entry(node);
+            node = CellMap::next(node);
             continue;
           }
           deleted_row.clear();
         }
         delete_present = false;
       }
-      child_ptr->m_cell_map.insert(CellMap::value_type((*iter).first, (*iter).second));
-      (*iter).second |= ALLOC_BIT_MASK;  // mark this entry in the "old" map so it doesn't get deleted
-      iter++;
+      child->copy_entry(node);
+      node = CellMap::next(node);
     }
     else {
       if (key_comps.flag == FLAG_DELETE_ROW) {
@@ -303,13 +265,12 @@ CellCache *CellCache::purge_deletes() {
           delete_present = true;
         }
       }
-      iter++;
+      node = CellMap::next(node);
     }
   }
 
-  Global::memory_tracker.add_items(child_ptr->m_cell_map.size());
-
-  m_children.push_back(child_ptr);
+  Global::memory_tracker.add_memory(child->m_memory_used);
+  Global::memory_tracker.add_items(child->m_cell_map.size());
 
-  return child_ptr.get();
+  return child;
 }
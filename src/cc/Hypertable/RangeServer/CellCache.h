@@ -22,24 +22,27 @@
 #ifndef HYPERTABLE_CELLCACHE_H
 #define HYPERTABLE_CELLCACHE_H
 
-#include <map>
-
+#include "Common/CharArena.h"
 #include "Common/Mutex.h"
 
 #include "CellListScanner.h"
 #include "CellList.h"
+#include "CellSkipList.h"
 
 namespace Hypertable {
 
   /**
    * Represents  a sorted list of key/value pairs in memory.
    * All updates get written to the CellCache and later get "compacted"
-   * into a CellStore on disk.
+   * into a CellStore on disk.  Key/value pairs are copied into a per-cache
+   * arena and indexed by a skip list, so destroying a CellCache releases
+   * its memory a page at a time.
    */
   class CellCache : public CellList {
 
   public:
-    CellCache() : CellList(), m_memory_used(0), m_deletes(0), m_collisions(0) { return; }
+    CellCache() : CellList(), m_arena(ARENA_PAGE_SIZE), m_cell_map(m_arena),
+                  m_memory_used(0), m_deletes(0), m_collisions(0) { return; }
     virtual ~CellCache();
 
     /**
@@ -66,6 +69,11 @@ namespace Hypertable {
      */
     virtual CellListScanner *create_scanner(ScanContextPtr &scan_ctx);
 
+    /**
+     * Serializes writers.  Readers (scanners, get_rows, get_split_rows)
+     * walk the cell map without taking this lock, so a long scan never
+     * holds up inserts and vice versa.
+     */
     void lock()   { m_mutex.lock(); }
     void unlock() { m_mutex.unlock(); }
 
@@ -75,7 +83,8 @@ namespace Hypertable {
      * Makes a copy of this CellCache, but only includes the key/value
      * pairs that have a timestamp greater than the timestamp argument.
      * This method is called after a compaction to drop the key/value
-     * pairs that were compacted to disk.
+     * pairs that were compacted to disk.  The surviving pairs are copied
+     * into the new cache's arena so that this cache can be freed whole.
      *
      * @param timestamp cutoff timestamp
      * @return The new "sliced" copy of the cell cache
@@ -90,12 +99,12 @@ namespace Hypertable {
     CellCache *purge_deletes();
 
     /**
-     * Returns the amount of memory used by the CellCache.  This is the summation
-     * of the lengths of all the keys and values in the map.
+     * Returns the amount of memory used by the CellCache.  This is the
+     * number of arena bytes taken by the keys, values and skip list nodes.
      */
     uint64_t memory_used() {
       ScopedLock lock(m_mutex);
-      return m_memory_used + (m_cell_map.size() * sizeof(CellMap::value_type));
+      return m_arena.used();
     }
 
     uint32_t get_collision_count() { return m_collisions; }
@@ -105,13 +114,14 @@ namespace Hypertable {
     friend class CellCacheScanner;
 
   protected:
-    typedef std::map<const ByteString, uint32_t, LtByteString> CellMap;
+    typedef CellSkipList CellMap;
+
+    enum { ARENA_PAGE_SIZE = 32768 };
 
-    static const uint32_t ALLOC_BIT_MASK;
-    static const uint32_t OFFSET_BIT_MASK;
+    void copy_entry(const CellMap::Node *node);
 
     Mutex              m_mutex;
-    std::vector<CellListPtr> m_children;
+    CharArena          m_arena;
     CellMap            m_cell_map;
     uint64_t           m_memory_used;
     uint32_t           m_deletes;
@@ -34,47 +34,24 @@ using namespace Hypertable;
 /**
  *
  */
-CellCacheScanner::CellCacheScanner(CellCachePtr &cellcache, ScanContextPtr &scan_ctx) : CellListScanner(scan_ctx), m_cell_cache_ptr(cellcache), m_cell_cache_mutex(cellcache->m_mutex), m_cur_key(0), m_cur_value(0), m_eos(false) {
-  ByteString bs;
+CellCacheScanner::CellCacheScanner(CellCachePtr &cellcache, ScanContextPtr &scan_ctx) : CellListScanner(scan_ctx), m_cell_cache_ptr(cellcache), m_end_key(0), m_cur_key(0), m_cur_value(0), m_eos(false) {
+  DynamicBuffer dbuf(0);
   size_t start_row_len = scan_ctx->start_row.length() + 1;
   size_t end_row_len = scan_ctx->end_row.length() + 1;
-  DynamicBuffer dbuf(7 + std::max(start_row_len, end_row_len));
-
-  {
-    boost::mutex::scoped_lock lock(m_cell_cache_mutex);
-    Key key;
-
-    assert(scan_ctx->start_row <= scan_ctx->end_row);
-
-    /** set start iterator **/
-    dbuf.clear();
-    append_as_byte_string(dbuf, scan_ctx->start_row.c_str(), start_row_len);
-    bs.ptr = dbuf.base;
-    m_start_iter = m_cell_cache_ptr->m_cell_map.lower_bound(bs);
-
-    /** set end iterator **/
-    dbuf.clear();
-    append_as_byte_string(dbuf, scan_ctx->end_row.c_str(), end_row_len);
-    bs.ptr = dbuf.base;
-    m_end_iter = m_cell_cache_ptr->m_cell_map.lower_bound(bs);
-
-    m_cur_iter = m_start_iter;
-
-    while (m_cur_iter != m_end_iter) {
-      if (!key.load((*m_cur_iter).first)) {
-        HT_ERROR("Problem parsing key!");
-      }
-      else if (key.flag == FLAG_DELETE_ROW || m_scan_context_ptr->family_mask[key.column_family_code]) {
-        m_cur_key = (*m_cur_iter).first;
-        m_cur_value.ptr = m_cur_key.ptr + (CellCache::OFFSET_BIT_MASK & (*m_cur_iter).second);
-        return;
-      }
-      m_cur_iter++;
-    }
-    m_eos = true;
-    return;
-  }
 
+  assert(scan_ctx->start_row <= scan_ctx->end_row);
+
+  /** set start node **/
+  append_as_byte_string(dbuf, scan_ctx->start_row.c_str(), start_row_len);
+  m_cur_node = m_cell_cache_ptr->m_cell_map.lower_bound(ByteString(dbuf.base));
+
+  /**
+   * Remember the end key rather than the node that follows it; the map may
+   * grow while we scan, so the node after the end key can change
+   */
+  append_as_byte_string(m_end_key, scan_ctx->end_row.c_str(), end_row_len);
+
+  seek_visible();
 }
 
 
@@ -90,20 +67,30 @@ bool CellCacheScanner::get(ByteString &key, ByteString &value) {
 
 
 void CellCacheScanner::forward() {
-  boost::mutex::scoped_lock lock(m_cell_cache_mutex);
+  m_cur_node = CellCache::CellMap::next(m_cur_node);
+  seek_visible();
+}
+
+
+/**
+ * Advances m_cur_node to the first cell at or after it that belongs to this
+ * scan, skipping cells that were added after the scan's snapshot timestamp.
+ */
+void CellCacheScanner::seek_visible() {
+  ByteString end_key(m_end_key.base);
   Key key;
 
-  m_cur_iter++;
-  while (m_cur_iter != m_end_iter) {
-    if (!key.load((*m_cur_iter).first)) {
+  while (m_cur_node && m_cur_node->key() < end_key) {
+    if (!key.load(m_cur_node->key())) {
       HT_ERROR("Problem parsing key!");
     }
-    else if (key.flag == FLAG_DELETE_ROW || m_scan_context_ptr->family_mask[key.column_family_code]) {
-      m_cur_key = (*m_cur_iter).first;
-      m_cur_value.ptr = m_cur_key.ptr + (CellCache::OFFSET_BIT_MASK & (*m_cur_iter).second);
+    else if (key.timestamp < m_scan_context_ptr->snapshot_timestamp &&
+             (key.flag == FLAG_DELETE_ROW || m_scan_context_ptr->family_mask[key.column_family_code])) {
+      m_cur_key = m_cur_node->key();
+      m_cur_value = m_cur_node->value();
       return;
     }
-    m_cur_iter++;
+    m_cur_node = CellCache::CellMap::next(m_cur_node);
   }
   m_eos = true;
 }
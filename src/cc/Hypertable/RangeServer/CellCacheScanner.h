@@ -30,7 +30,10 @@
 namespace Hypertable {
 
   /**
-   * Provides a scanning interface to a CellCache.
+   * Provides a scanning interface to a CellCache.  The scanner does not
+   * lock the CellCache; it only returns cells whose timestamp is older
+   * than the scan's snapshot timestamp, so cells being inserted
+   * concurrently are not seen.
    */
   class CellCacheScanner : public CellListScanner {
   public:
@@ -40,11 +43,11 @@ namespace Hypertable {
     virtual bool get(ByteString &key, ByteString &value);
 
   private:
-    CellCache::CellMap::iterator   m_start_iter;
-    CellCache::CellMap::iterator   m_end_iter;
-    CellCache::CellMap::iterator   m_cur_iter;
+    void seek_visible();
+
+    CellCache::CellMap::Node      *m_cur_node;
     CellCachePtr                   m_cell_cache_ptr;
-    boost::mutex                  &m_cell_cache_mutex;
+    DynamicBuffer                  m_end_key;
     ByteString                     m_cur_key;
     ByteString                     m_cur_value;
     bool                           m_eos;
@@ -0,0 +1,147 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include <cstring>
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "CellPredicateFilter.h"
+
+using namespace Hypertable;
+
+
+CellPredicateFilter::CellPredicateFilter(const std::vector<CellPredicate> &predicates) {
+  Predicate pred;
+  char errbuf[256];
+  int ret;
+
+  m_predicates.reserve(predicates.size());
+
+  try {
+    foreach(const CellPredicate &cp, predicates) {
+      pred.type = cp.type;
+      pred.pattern = cp.pattern ? cp.pattern : "";
+      pred.regex = 0;
+      switch (cp.type) {
+      case CellPredicate::VALUE_EQUALS:
+      case CellPredicate::VALUE_PREFIX:
+      case CellPredicate::QUALIFIER_PREFIX:
+        break;
+      case CellPredicate::VALUE_REGEX:
+      case CellPredicate::QUALIFIER_REGEX:
+      case CellPredicate::ROW_REGEX:
+        pred.regex = new regex_t;
+        if ((ret = regcomp(pred.regex, pred.pattern.c_str(),
+                           REG_EXTENDED|REG_NOSUB)) != 0) {
+          regerror(ret, pred.regex, errbuf, sizeof(errbuf));
+          delete pred.regex;
+          HT_THROWF(Error::RANGESERVER_BAD_SCAN_SPEC,
+                    "Bad regular expression '%s' - %s", pred.pattern.c_str(),
+                    errbuf);
+        }
+        break;
+      default:
+        HT_THROWF(Error::RANGESERVER_BAD_SCAN_SPEC, "Unknown predicate type %d",
+                  (int)cp.type);
+      }
+      m_predicates.push_back(pred);
+    }
+  }
+  catch (...) {
+    foreach(Predicate &p, m_predicates) {
+      if (p.regex) {
+        regfree(p.regex);
+        delete p.regex;
+      }
+    }
+    throw;
+  }
+}
+
+
+CellPredicateFilter::~CellPredicateFilter() {
+  foreach(Predicate &pred, m_predicates) {
+    if (pred.regex) {
+      regfree(pred.regex);
+      delete pred.regex;
+    }
+  }
+}
+
+
+bool CellPredicateFilter::matches(const Key &key, const ByteString value) {
+  const uint8_t *vptr = 0;
+  size_t vlen = 0;
+  bool have_value = false;
+  bool have_value_str = false;
+
+  foreach(Predicate &pred, m_predicates) {
+
+    if (pred.type == CellPredicate::QUALIFIER_PREFIX) {
+      if (strncmp(key.column_qualifier, pred.pattern.c_str(),
+                  pred.pattern.length()))
+        return false;
+      continue;
+    }
+    else if (pred.type == CellPredicate::QUALIFIER_REGEX) {
+      if (regexec(pred.regex, key.column_qualifier, 0, 0, 0) != 0)
+        return false;
+      continue;
+    }
+    else if (pred.type == CellPredicate::ROW_REGEX) {
+      if (regexec(pred.regex, key.row, 0, 0, 0) != 0)
+        return false;
+      continue;
+    }
+
+    if (!have_value) {
+      vlen = value.decode_length(&vptr);
+      have_value = true;
+    }
+
+    if (pred.type == CellPredicate::VALUE_EQUALS) {
+      if (vlen != pred.pattern.length() ||
+          memcmp(vptr, pred.pattern.c_str(), vlen))
+        return false;
+    }
+    else if (pred.type == CellPredicate::VALUE_PREFIX) {
+      if (vlen < pred.pattern.length() ||
+          memcmp(vptr, pred.pattern.c_str(), pred.pattern.length()))
+        return false;
+    }
+    else {
+      // values aren't NUL terminated, so regexec() needs a copy
+      if (!have_value_str) {
+        m_value_buf.clear();
+        m_value_buf.reserve(vlen + 1);
+        m_value_buf.add_unchecked(vptr, vlen);
+        *m_value_buf.ptr = 0;
+        have_value_str = true;
+      }
+      if (regexec(pred.regex, (const char *)m_value_buf.base, 0, 0, 0) != 0)
+        return false;
+    }
+  }
+  return true;
+}
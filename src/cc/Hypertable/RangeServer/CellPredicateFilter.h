@@ -0,0 +1,80 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_CELLPREDICATEFILTER_H
+#define HYPERTABLE_CELLPREDICATEFILTER_H
+
+#include <regex.h>
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "Common/ByteString.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/String.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/ScanSpec.h"
+
+namespace Hypertable {
+
+  /**
+   * Evaluates the CellPredicates of a ScanSpec against cells on the
+   * RangeServer, so cells the client doesn't want never make it into a
+   * scan block.  Regular expressions are compiled once, when the filter is
+   * constructed.
+   */
+  class CellPredicateFilter : boost::noncopyable {
+  public:
+    /**
+     * Compiles the predicates.  Throws RANGESERVER_BAD_SCAN_SPEC if a
+     * predicate has an unknown type or a bad regular expression.
+     *
+     * @param predicates predicates to evaluate
+     */
+    CellPredicateFilter(const std::vector<CellPredicate> &predicates);
+    ~CellPredicateFilter();
+
+    /**
+     * Checks a cell against all of the predicates
+     *
+     * @param key loaded key of the cell
+     * @param value value of the cell
+     * @return true if the cell satisfies every predicate
+     */
+    bool matches(const Key &key, const ByteString value);
+
+  private:
+
+    struct Predicate {
+      uint8_t  type;
+      String   pattern;
+      regex_t *regex;
+    };
+
+    std::vector<Predicate> m_predicates;
+    DynamicBuffer m_value_buf;
+  };
+
+}
+
+#endif // HYPERTABLE_CELLPREDICATEFILTER_H
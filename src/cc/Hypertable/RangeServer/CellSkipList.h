@@ -0,0 +1,190 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_CELLSKIPLIST_H
+#define HYPERTABLE_CELLSKIPLIST_H
+
+#include <cstring>
+
+#include <boost/noncopyable.hpp>
+
+#include "Common/ByteString.h"
+#include "Common/CharArena.h"
+
+namespace Hypertable {
+
+  /**
+   * Ordered index of key/value pairs for the CellCache.  Each entry is a
+   * single arena allocation holding the skip list node followed by the
+   * serialized key and value, so inserting costs one bump allocation and
+   * the whole list is released along with the arena.  Keys are ordered the
+   * same way as ByteString::operator<.  Entries are never removed.
+   *
+   * Insertions must be serialized by the caller, but readers need no
+   * locking at all: a node is fully built before it is linked in, and the
+   * links are published behind a memory barrier, so a concurrent reader
+   * sees either the old or the new list.
+   */
+  class CellSkipList : boost::noncopyable {
+  public:
+    enum { MAX_HEIGHT = 16 };
+
+    struct Node {
+      uint32_t key_len;      // serialized key length, including vint header
+      uint32_t payload_len;  // length of the key bytes following the header
+      uint32_t height;
+      Node *next[1];
+
+      ByteString key() const { return ByteString(key_ptr()); }
+      ByteString value() const { return ByteString(key_ptr() + key_len); }
+      const uint8_t *payload() const {
+        return key_ptr() + (key_len - payload_len);
+      }
+
+    private:
+      const uint8_t *key_ptr() const { return (const uint8_t *)&next[height]; }
+    };
+
+    CellSkipList(CharArena &arena)
+      : m_arena(arena), m_height(1), m_size(0), m_rand(0x9e3779b9) {
+      memset(m_head, 0, sizeof(m_head));
+    }
+
+    /**
+     * Inserts a copy of the key/value pair.  If an equal key is already
+     * present, nothing is allocated and the list is left unchanged.
+     *
+     * @param key key to insert
+     * @param value value to insert
+     * @return newly inserted node, or 0 if the key was already present
+     */
+    Node *insert(const ByteString key, const ByteString value) {
+      Node **prev[MAX_HEIGHT];
+      const uint8_t *payload;
+      uint32_t payload_len = key.decode_length(&payload);
+      Node *x = find_greater_or_equal(payload, payload_len, prev);
+
+      if (x && compare(x, payload, payload_len) == 0)
+        return 0;
+
+      uint32_t height = random_height();
+      if (height > m_height) {
+        for (uint32_t i = m_height; i < height; i++)
+          prev[i] = &m_head[i];
+        m_height = height;
+      }
+
+      size_t key_len = key.length();
+      size_t value_len = value.length();
+      size_t header_len = sizeof(Node) + (height - 1) * sizeof(Node *);
+
+      x = (Node *)m_arena.alloc_aligned(header_len + key_len + value_len);
+      x->key_len = key_len;
+      x->payload_len = payload_len;
+      x->height = height;
+      uint8_t *ptr = (uint8_t *)&x->next[height];
+      memcpy(ptr, key.ptr, key_len);
+      value.write(ptr + key_len);
+
+      for (uint32_t i = 0; i < height; i++)
+        x->next[i] = *prev[i];
+
+      // make the node contents visible before publishing it
+      __sync_synchronize();
+      for (uint32_t i = 0; i < height; i++)
+        *(Node * volatile *)prev[i] = x;
+      m_size++;
+      return x;
+    }
+
+    /**
+     * Returns the first node whose key is not less than the given key,
+     * or 0 if there is none.
+     */
+    Node *lower_bound(const ByteString key) const {
+      const uint8_t *payload;
+      uint32_t payload_len = key.decode_length(&payload);
+      return find_greater_or_equal(payload, payload_len, 0);
+    }
+
+    Node *first() const { return load(&m_head[0]); }
+
+    static Node *next(const Node *x) { return load(&x->next[0]); }
+
+    size_t size() const { return m_size; }
+
+  private:
+
+    /**
+     * Reads a link that may be concurrently published by the writer.  Loads
+     * through the returned pointer depend on it, so no further barrier is
+     * needed on the platforms we support.
+     */
+    static Node *load(Node * const *link) {
+      return *(Node * volatile const *)link;
+    }
+
+    static int compare(const Node *x, const uint8_t *payload, size_t len) {
+      size_t min_len = (x->payload_len < len) ? x->payload_len : len;
+      int cmp = memcmp(x->payload(), payload, min_len);
+      if (cmp == 0)
+        return (x->payload_len < len) ? -1 : ((x->payload_len > len) ? 1 : 0);
+      return cmp;
+    }
+
+    Node *find_greater_or_equal(const uint8_t *payload, size_t len,
+                                Node ***prev) const {
+      Node * const *links = m_head;
+      Node *x;
+
+      for (int level = (int)m_height - 1; level >= 0; level--) {
+        while ((x = load(&links[level])) != 0 && compare(x, payload, len) < 0)
+          links = x->next;
+        if (prev)
+          prev[level] = (Node **)&links[level];
+      }
+      return load(&links[0]);
+    }
+
+    uint32_t random_height() {
+      uint32_t height = 1;
+      // xorshift; a branching factor of 4 keeps the towers short
+      while (height < MAX_HEIGHT) {
+        m_rand ^= m_rand << 13;
+        m_rand ^= m_rand >> 17;
+        m_rand ^= m_rand << 5;
+        if ((m_rand & 3) != 0)
+          break;
+        height++;
+      }
+      return height;
+    }
+
+    CharArena &m_arena;
+    Node      *m_head[MAX_HEIGHT];
+    volatile uint32_t m_height;
+    volatile size_t   m_size;
+    uint32_t   m_rand;
+  };
+
+}
+
+#endif // HYPERTABLE_CELLSKIPLIST_H
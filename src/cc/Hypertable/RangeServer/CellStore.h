@@ -39,6 +39,12 @@ namespace Hypertable {
   class CellStore : public CellList {
   public:
 
+    enum BloomFilterMode {
+      BLOOM_FILTER_DISABLED,
+      BLOOM_FILTER_ROWS,
+      BLOOM_FILTER_ROWS_COLS
+    };
+
     virtual ~CellStore() { return; }
 
     virtual int add(const ByteString key, const ByteString value, int64_t real_timestamp) = 0;
@@ -53,9 +59,11 @@ namespace Hypertable {
      * @param fname name of file to contain the cell store
      * @param blocksize amount of uncompressed data to compress into a block
      * @param compressor string indicating compressor type and arguments (e.g. "zlib --best")
+     * @param bloom_filter_mode what (if anything) to record in the bloom filter
      * @return Error::OK on success, error code on failure
      */
-    virtual int create(const char *fname, uint32_t blocksize, const std::string &compressor) = 0;
+    virtual int create(const char *fname, uint32_t blocksize, const std::string &compressor,
+                       BloomFilterMode bloom_filter_mode) = 0;
 
     /**
      * Finalizes the creation of a cell store, by writing block index and metadata trailer.
@@ -130,6 +138,25 @@ namespace Hypertable {
      */
     virtual CellStoreTrailer *get_trailer() = 0;
 
+    /**
+     * Checks whether or not the cell store might contain cells for a
+     * single-row scan.  A return value of false means that the store
+     * definitely does not contain the row (or the row/column family
+     * combinations) being scanned and can be skipped.
+     *
+     * @param scan_ctx scan context of single-row scan
+     * @return false if the scan can skip this store, true otherwise
+     */
+    virtual bool may_contain(ScanContextPtr &scan_ctx) { return true; }
+
+    /**
+     * Frees the in-memory block index if it has not been used since
+     * expire_time.  It is read back in when the next scanner is created.
+     *
+     * @param expire_time indexes last used before this time are freed
+     */
+    virtual void purge_index(time_t expire_time) { return; }
+
   };
 
   typedef boost::intrusive_ptr<CellStore> CellStorePtr;
@@ -0,0 +1,121 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cstring>
+
+#include "CellStoreBlockIndex.h"
+
+using namespace Hypertable;
+
+
+void CellStoreBlockIndex::load(DynamicBuffer &fixed, DynamicBuffer &variable,
+                               uint32_t count) {
+  DynamicBuffer deltas(5 * count);
+  const uint8_t *fix_ptr = fixed.base;
+  const uint8_t *key_ptr = variable.base;
+  uint32_t offset, last_offset = 0;
+  Group group;
+
+  clear();
+
+  m_groups.reserve((count + GROUP_SIZE - 1) / GROUP_SIZE);
+
+  for (uint32_t i=0; i<count; i++) {
+    memcpy(&offset, fix_ptr, sizeof(offset));
+    fix_ptr += sizeof(offset);
+    if (i > 0)
+      Serialization::encode_vi32(&deltas.ptr, offset - last_offset);
+    if (i % GROUP_SIZE == 0) {
+      group.key_pos = key_ptr - variable.base;
+      group.delta_pos = deltas.fill();
+      group.offset = offset;
+      m_groups.push_back(group);
+    }
+    last_offset = offset;
+    key_ptr += ByteString(key_ptr).length();
+  }
+
+  // keep the deltas at their exact length
+  if (deltas.fill() > 0) {
+    m_deltas.reserve(deltas.fill());
+    m_deltas.add_unchecked(deltas.base, deltas.fill());
+  }
+
+  m_keys.base = variable.base;
+  m_keys.ptr = variable.ptr;
+  m_keys.size = variable.size;
+  variable.release();
+
+  m_count = count;
+}
+
+
+void CellStoreBlockIndex::clear() {
+  m_keys.free();
+  m_deltas.free();
+  std::vector<Group>().swap(m_groups);
+  m_count = 0;
+}
+
+
+CellStoreBlockIndex::iterator CellStoreBlockIndex::group_begin(size_t g) const {
+  iterator iter;
+
+  if (g >= m_groups.size())
+    return end();
+
+  iter.m_i = g * GROUP_SIZE;
+  iter.m_count = m_count;
+  iter.m_key = m_keys.base + m_groups[g].key_pos;
+  iter.m_delta = m_deltas.base + m_groups[g].delta_pos;
+  iter.m_offset = m_groups[g].offset;
+  return iter;
+}
+
+
+/**
+ * Finds the last group whose first key is before key (for upper_bound,
+ * not after it) and walks forward from there to the first entry that is
+ * not, which may be the first entry of the following group.
+ */
+CellStoreBlockIndex::iterator CellStoreBlockIndex::search(const ByteString key,
+                                                          bool upper) const {
+  size_t lo = 0, hi = m_groups.size();
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    ByteString first(m_keys.base + m_groups[mid].key_pos);
+    if (upper ? !(key < first) : first < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == 0)
+    return begin();
+
+  iterator iter = group_begin(lo - 1);
+  iterator end_iter = end();
+  while (iter != end_iter && (upper ? !(key < iter.key()) : iter.key() < key))
+    ++iter;
+  return iter;
+}
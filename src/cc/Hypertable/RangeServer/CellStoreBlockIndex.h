@@ -0,0 +1,131 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_CELLSTOREBLOCKINDEX_H
+#define HYPERTABLE_CELLSTOREBLOCKINDEX_H
+
+#include <vector>
+
+#include "Common/ByteString.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Serialization.h"
+
+namespace Hypertable {
+
+  /**
+   * Block index of a CellStore, mapping the last key of each block to the
+   * block's file offset.  The keys are kept packed, one ByteString after
+   * another, and the offsets as vi32 deltas from the previous offset.
+   * Every GROUP_SIZE entries a group records the position of its first
+   * key, that entry's absolute offset and where the deltas following it
+   * start; lookups binary search the groups and then walk at most one
+   * group.
+   */
+  class CellStoreBlockIndex {
+  public:
+
+    enum { GROUP_SIZE = 32 };
+
+    class iterator {
+    public:
+      iterator() : m_i(0), m_count(0), m_key(0), m_delta(0), m_offset(0) { }
+      ByteString key() const { return ByteString(m_key); }
+      uint32_t value() const { return m_offset; }
+      iterator &operator++() {
+        if (++m_i < m_count) {
+          m_key += key().length();
+          m_offset += Serialization::decode_vi32(&m_delta);
+        }
+        return *this;
+      }
+      iterator operator++(int) {
+        iterator tmp = *this;
+        ++*this;
+        return tmp;
+      }
+      bool operator==(const iterator &other) const { return m_i == other.m_i; }
+      bool operator!=(const iterator &other) const { return m_i != other.m_i; }
+
+    private:
+      friend class CellStoreBlockIndex;
+      uint32_t       m_i;
+      uint32_t       m_count;
+      const uint8_t *m_key;
+      const uint8_t *m_delta;
+      uint32_t       m_offset;
+    };
+
+    CellStoreBlockIndex() : m_keys(0), m_deltas(0), m_count(0) { }
+
+    /**
+     * Builds the index from the fixed (32-bit offsets) and variable (keys)
+     * index blocks of a CellStore.  Takes ownership of the key buffer.
+     */
+    void load(DynamicBuffer &fixed, DynamicBuffer &variable, uint32_t count);
+
+    /**
+     * Frees the index
+     */
+    void clear();
+
+    iterator begin() const { return group_begin(0); }
+    iterator end() const {
+      iterator iter;
+      iter.m_i = m_count;
+      return iter;
+    }
+
+    /**
+     * @return iterator to the first entry whose key is not less than key
+     */
+    iterator lower_bound(const ByteString key) const { return search(key, false); }
+
+    /**
+     * @return iterator to the first entry whose key is greater than key
+     */
+    iterator upper_bound(const ByteString key) const { return search(key, true); }
+
+    uint32_t size() const { return m_count; }
+
+    uint64_t memory_used() const {
+      return m_keys.size + m_deltas.size + m_groups.capacity() * sizeof(Group);
+    }
+
+  private:
+
+    struct Group {
+      uint32_t key_pos;
+      uint32_t delta_pos;
+      uint32_t offset;
+    };
+
+    iterator group_begin(size_t g) const;
+    iterator search(const ByteString key, bool upper) const;
+
+    DynamicBuffer       m_keys;
+    DynamicBuffer       m_deltas;
+    std::vector<Group>  m_groups;
+    uint32_t            m_count;
+  };
+
+}
+
+#endif // HYPERTABLE_CELLSTOREBLOCKINDEX_H
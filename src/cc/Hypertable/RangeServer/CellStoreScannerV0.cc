@@ -23,6 +23,7 @@
 #include <cassert>
 
 #include "Common/Error.h"
+#include "Common/Serialization.h"
 #include "Common/System.h"
 
 #include "Hypertable/Lib/BlockCompressionHeader.h"
@@ -45,16 +46,34 @@ CellStoreScannerV0::CellStoreScannerV0(CellStorePtr &cellstore,
     m_index(m_cell_store_v0->m_index),
     m_check_for_range_end(false), m_end_inclusive(true),
     m_readahead(true), m_fd(-1), m_start_offset(0), m_end_offset(0),
-    m_returned(0) {
-  ByteString bskey;
-  DynamicBuffer dbuf(0);
-  bool start_inclusive = false;
-
+    m_returned(0), m_key_buf(256) {
   assert(m_cell_store_v0);
   m_file_id = m_cell_store_v0->m_file_id;
-  m_zcodec = m_cell_store_v0->create_block_compression_codec();
+  m_version = m_cell_store_v0->m_trailer.version;
+  m_zcodec = 0;
   memset(&m_block, 0, sizeof(m_block));
 
+  /**
+   * The destructor won't run if the constructor throws, so hand back the
+   * index pin (and anything else picked up so far) before rethrowing
+   */
+  m_cell_store_v0->acquire_index();
+  try {
+    m_zcodec = m_cell_store_v0->create_block_compression_codec();
+    initialize(scan_ctx);
+  }
+  catch (...) {
+    release();
+    throw;
+  }
+}
+
+
+void CellStoreScannerV0::initialize(ScanContextPtr &scan_ctx) {
+  ByteString bskey;
+  DynamicBuffer dbuf(0);
+  bool start_inclusive = false;
+
   // compute start row
   // this is wrong ...
   m_start_row = m_cell_store_v0->get_start_row();
@@ -101,7 +120,7 @@ CellStoreScannerV0::CellStoreScannerV0(CellStorePtr &cellstore,
     if (buf_size < MINIMUM_READAHEAD_AMOUNT)
       buf_size = MINIMUM_READAHEAD_AMOUNT;
 
-    m_start_offset = (*m_iter).second;
+    m_start_offset = m_iter.value();
 
     dbuf.clear();
     append_as_byte_string(dbuf, m_end_row.c_str());
@@ -110,12 +129,12 @@ CellStoreScannerV0::CellStoreScannerV0(CellStorePtr &cellstore,
     if ((m_end_iter = m_index.upper_bound(bskey)) == m_index.end())
       m_end_offset = m_cell_store_v0->m_trailer.fix_index_offset;
     else {
-      CellStoreV0::IndexMap::iterator iter_next = m_end_iter;
+      CellStoreBlockIndex::iterator iter_next = m_end_iter;
       iter_next++;
       if (iter_next == m_index.end())
         m_end_offset = m_cell_store_v0->m_trailer.fix_index_offset;
       else
-        m_end_offset = (*iter_next).second;
+        m_end_offset = iter_next.value();
     }
 
     try {
@@ -138,8 +157,9 @@ CellStoreScannerV0::CellStoreScannerV0(CellStorePtr &cellstore,
   /**
    * Seek to start of range in block
    */
-  m_cur_key.ptr = m_block.ptr;
-  m_cur_value.ptr = m_block.ptr + m_cur_key.length();
+  if (m_version == CellStoreV0::VERSION_PREFIX_KEYS)
+    seek_restart(start_inclusive);
+  load_entry();
 
   if (start_inclusive) {
     while (strcmp(m_cur_key.str(), m_start_row.c_str()) < 0) {
@@ -149,8 +169,7 @@ CellStoreScannerV0::CellStoreScannerV0(CellStorePtr &cellstore,
         HT_ERRORF("Unable to find start of range (row='%s') in %s", m_start_row.c_str(), m_cell_store_ptr->get_filename().c_str());
         return;
       }
-      m_cur_key.ptr = m_block.ptr;
-      m_cur_value.ptr = m_block.ptr + m_cur_key.length();
+      load_entry();
     }
   }
   else {
@@ -164,8 +183,7 @@ CellStoreScannerV0::CellStoreScannerV0(CellStorePtr &cellstore,
         else if (!fetch_next_block())
           return;
       }
-      m_cur_key.ptr = m_block.ptr;
-      m_cur_value.ptr = m_block.ptr + m_cur_key.length();
+      load_entry();
     }
   }
 
@@ -202,6 +220,20 @@ CellStoreScannerV0::CellStoreScannerV0(CellStorePtr &cellstore,
 
 
 CellStoreScannerV0::~CellStoreScannerV0() {
+  release();
+#ifdef STAT
+  cout << flush;
+  cout << "STAT[~CellStoreScannerV0]\tget\t" << m_returned << "\t";
+  cout << m_cell_store_v0->get_filename() << "[" << m_start_row << ".." << m_end_row << "]" << endl;
+#endif
+}
+
+
+/**
+ * Closes the file and frees the block, codec and index pin
+ */
+void CellStoreScannerV0::release() {
+  m_cell_store_v0->release_index();
   try {
     if (m_fd != -1) {
       try { m_cell_store_v0->m_filesys->close(m_fd, 0); }
@@ -213,17 +245,11 @@ CellStoreScannerV0::~CellStoreScannerV0() {
 
     if (m_readahead)
       delete [] m_block.base;
-    else {
-      if (m_block.base != 0)
-        Global::block_cache->checkin(m_file_id, m_block.offset);
-    }
+    else if (m_block.uncached)
+      delete [] m_block.base;
+    else if (m_block.base != 0)
+      Global::block_cache->checkin(m_file_id, m_block.offset);
     delete m_zcodec;
-
-#ifdef STAT
-    cout << flush;
-    cout << "STAT[~CellStoreScannerV0]\tget\t" << m_returned << "\t";
-    cout << m_cell_store_v0->get_filename() << "[" << m_start_row << ".." << m_end_row << "]" << endl;
-#endif
   }
   catch (Exception &e) {
     HT_ERROR_OUT << e << HT_END;
@@ -270,8 +296,7 @@ void CellStoreScannerV0::forward() {
         return;
     }
 
-    m_cur_key.ptr = m_block.ptr;
-    m_cur_value.ptr = m_block.ptr + m_cur_key.length();
+    load_entry();
 
     if (m_check_for_range_end) {
       if (m_end_inclusive) {
@@ -317,7 +342,10 @@ void CellStoreScannerV0::forward() {
 bool CellStoreScannerV0::fetch_next_block() {
   // If we're at the end of the current block, deallocate and move to next
   if (m_block.base != 0 && m_block.ptr >= m_block.end) {
-    Global::block_cache->checkin(m_file_id, m_block.offset);
+    if (m_block.uncached)
+      delete [] m_block.base;
+    else
+      Global::block_cache->checkin(m_file_id, m_block.offset);
     memset(&m_block, 0, sizeof(m_block));
     m_iter++;
   }
@@ -326,9 +354,9 @@ bool CellStoreScannerV0::fetch_next_block() {
     DynamicBuffer expand_buf(0);
     uint32_t len;
 
-    m_block.offset = (*m_iter).second;
+    m_block.offset = m_iter.value();
 
-    CellStoreV0::IndexMap::iterator it_next = m_iter;
+    CellStoreBlockIndex::iterator it_next = m_iter;
     it_next++;
     if (it_next == m_index.end()) {
       m_block.zlength = m_cell_store_v0->m_trailer.fix_index_offset - m_block.offset;
@@ -336,9 +364,9 @@ bool CellStoreScannerV0::fetch_next_block() {
         m_check_for_range_end = true;
     }
     else {
-      if (strcmp((*it_next).first.str(), m_end_row.c_str()) >= 0)
+      if (strcmp(it_next.key().str(), m_end_row.c_str()) >= 0)
         m_check_for_range_end = true;
-      m_block.zlength = (*it_next).second - m_block.offset;
+      m_block.zlength = it_next.value() - m_block.offset;
     }
 
     /**
@@ -373,20 +401,27 @@ bool CellStoreScannerV0::fetch_next_block() {
       m_block.base = expand_buf.release(&fill);
       len = fill;
 
-      /** Insert block into cache  **/
+      /**
+       * Insert block into cache.  If another scanner got there first, use
+       * its copy; if the cache has no room (e.g. its shard is full of
+       * checked-out blocks), keep the block private to this scanner.
+       */
       if (!Global::block_cache->insert_and_checkout(m_file_id, m_block.offset,
                                          (uint8_t *)m_block.base, len)) {
-        delete [] m_block.base;
-
-        if (!Global::block_cache->checkout(m_file_id, m_block.offset,
-                                          (uint8_t **)&m_block.base, &len)) {
-          HT_FATALF("Problem checking out block from cache file_id=%d, "
-                    "offset=%ld", m_file_id, (uint32_t)m_block.offset);
+        uint8_t *cached_block;
+        uint32_t cached_len;
+
+        if (Global::block_cache->checkout(m_file_id, m_block.offset,
+                                          &cached_block, &cached_len)) {
+          delete [] m_block.base;
+          m_block.base = cached_block;
+          len = cached_len;
         }
+        else
+          m_block.uncached = true;
       }
     }
-    m_block.ptr = m_block.base;
-    m_block.end = m_block.base + len;
+    set_block_end(len);
 
     return true;
   }
@@ -421,10 +456,10 @@ bool CellStoreScannerV0::fetch_next_block_readahead() {
     uint32_t len;
     uint32_t nread;
 
-    m_block.offset = (*m_iter).second;
+    m_block.offset = m_iter.value();
     assert(m_block.offset == m_start_offset);
 
-    CellStoreV0::IndexMap::iterator it_next = m_iter;
+    CellStoreBlockIndex::iterator it_next = m_iter;
     it_next++;
     if (it_next == m_index.end()) {
       m_block.zlength = m_cell_store_v0->m_trailer.fix_index_offset - m_block.offset;
@@ -432,9 +467,9 @@ bool CellStoreScannerV0::fetch_next_block_readahead() {
         m_check_for_range_end = true;
     }
     else {
-      if (strcmp((*it_next).first.str(), m_end_row.c_str()) >= 0)
+      if (strcmp(it_next.key().str(), m_end_row.c_str()) >= 0)
         m_check_for_range_end = true;
-      m_block.zlength = (*it_next).second - m_block.offset;
+      m_block.zlength = it_next.value() - m_block.offset;
     }
 
     try {
@@ -466,10 +501,92 @@ bool CellStoreScannerV0::fetch_next_block_readahead() {
     m_block.base = expand_buf.release(&fill);
     len = fill;
 
-    m_block.ptr = m_block.base;
-    m_block.end = m_block.base + len;
+    set_block_end(len);
 
     return true;
   }
   return false;
 }
+
+
+
+/**
+ * Points m_block.ptr at the start of a freshly loaded block and sets its
+ * end.  Version 1 blocks end with the restart offsets, which are excluded.
+ */
+void CellStoreScannerV0::set_block_end(uint32_t len) {
+  m_block.ptr = m_block.base;
+  m_block.end = m_block.base + len;
+
+  if (m_version == CellStoreV0::VERSION_PREFIX_KEYS) {
+    const uint8_t *ptr = m_block.end - 4;
+    size_t remaining = 4;
+    m_block.restart_count = Serialization::decode_i32(&ptr, &remaining);
+    m_block.end -= 4 * (m_block.restart_count + 1);
+    m_block.restarts = m_block.end;
+  }
+}
+
+
+uint32_t CellStoreScannerV0::restart_offset(uint32_t i) {
+  const uint8_t *ptr = m_block.restarts + 4*i;
+  size_t remaining = 4;
+  return Serialization::decode_i32(&ptr, &remaining);
+}
+
+
+/**
+ * Binary searches the restart entries of the current block for the last
+ * one whose row sorts before the start row (or at it, if the start row is
+ * exclusive) and moves m_block.ptr there, so the linear seek that follows
+ * only has to cover one restart interval.
+ */
+void CellStoreScannerV0::seek_restart(bool inclusive) {
+  uint32_t lo = 0, hi = m_block.restart_count;
+
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    const uint8_t *ptr = m_block.base + restart_offset(mid);
+    Serialization::decode_vi32(&ptr);  // shared (zero)
+    Serialization::decode_vi32(&ptr);  // unshared
+    int cmp = strcmp((const char *)ptr, m_start_row.c_str());
+    if (cmp < 0 || (cmp == 0 && !inclusive))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo > 0)
+    m_block.ptr = m_block.base + restart_offset(lo - 1);
+}
+
+
+/**
+ * Decodes the entry at m_block.ptr into m_cur_key and m_cur_value.  For
+ * version 1 blocks the key is rebuilt in m_key_buf from the previous key
+ * and the unshared bytes, leaving KEY_LENGTH_RESERVE bytes in front of it
+ * for its vi32 length; it stays valid until the next entry is loaded.
+ */
+void CellStoreScannerV0::load_entry() {
+
+  if (m_version == CellStoreV0::VERSION_PLAIN) {
+    m_cur_key.ptr = m_block.ptr;
+    m_cur_value.ptr = m_block.ptr + m_cur_key.length();
+    return;
+  }
+
+  const uint8_t *ptr = m_block.ptr;
+  uint32_t shared = Serialization::decode_vi32(&ptr);
+  uint32_t unshared = Serialization::decode_vi32(&ptr);
+  uint32_t len = shared + unshared;
+
+  m_key_buf.ptr = m_key_buf.base + KEY_LENGTH_RESERVE + shared;
+  m_key_buf.ensure(unshared);
+  m_key_buf.add_unchecked(ptr, unshared);
+
+  uint8_t *kptr = m_key_buf.base + KEY_LENGTH_RESERVE
+                  - Serialization::encoded_length_vi32(len);
+  m_cur_key.ptr = kptr;
+  Serialization::encode_vi32(&kptr, len);
+  m_cur_value.ptr = ptr + unshared;
+}
@@ -47,18 +47,28 @@ namespace Hypertable {
       const uint8_t *base;
       const uint8_t *ptr;
       const uint8_t *end;
+      const uint8_t *restarts;
+      uint32_t restart_count;
+      bool uncached;  // block cache refused it; base is owned here
     };
 
+    enum { KEY_LENGTH_RESERVE = 5 };
+
     bool fetch_next_block();
     bool fetch_next_block_readahead();
-    bool initialize();
+    void initialize(ScanContextPtr &scan_ctx);
+    void release();
+    void set_block_end(uint32_t len);
+    uint32_t restart_offset(uint32_t i);
+    void seek_restart(bool inclusive);
+    void load_entry();
 
     CellStorePtr            m_cell_store_ptr;
     CellStoreV0            *m_cell_store_v0;
-    CellStoreV0::IndexMap  &m_index;
+    CellStoreBlockIndex    &m_index;
 
-    CellStoreV0::IndexMap::iterator m_iter;
-    CellStoreV0::IndexMap::iterator m_end_iter;
+    CellStoreBlockIndex::iterator m_iter;
+    CellStoreBlockIndex::iterator m_end_iter;
 
     BlockInfo             m_block;
     ByteString            m_cur_key;
@@ -74,6 +84,8 @@ namespace Hypertable {
     uint32_t              m_start_offset;
     uint32_t              m_end_offset;
     uint32_t              m_returned;
+    uint16_t              m_version;
+    DynamicBuffer         m_key_buf;
   };
 
 }
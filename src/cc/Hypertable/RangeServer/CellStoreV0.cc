@@ -21,6 +21,7 @@
 
 #include "Common/Compat.h"
 #include <cassert>
+#include <ctime>
 
 #include <boost/algorithm/string.hpp>
 
@@ -37,6 +38,7 @@
 #include "CellStoreScannerV0.h"
 #include "CellStoreV0.h"
 #include "FileBlockCache.h"
+#include "Global.h"
 
 using namespace std;
 using namespace Hypertable;
@@ -44,14 +46,18 @@ using namespace Hypertable;
 const char CellStoreV0::DATA_BLOCK_MAGIC[10]           = { 'D','a','t','a','-','-','-','-','-','-' };
 const char CellStoreV0::INDEX_FIXED_BLOCK_MAGIC[10]    = { 'I','d','x','F','i','x','-','-','-','-' };
 const char CellStoreV0::INDEX_VARIABLE_BLOCK_MAGIC[10] = { 'I','d','x','V','a','r','-','-','-','-' };
+const char CellStoreV0::BLOOM_FILTER_BLOCK_MAGIC[10]   = { 'B','l','o','o','m','F','l','t','-','-' };
 
 namespace {
   const uint32_t MAX_APPENDS_OUTSTANDING = 3;
+  const float BLOOM_FILTER_FALSE_POSITIVE_PROB = 0.01;
 }
 
 CellStoreV0::CellStoreV0(Filesystem *filesys) : m_filesys(filesys), m_filename(), m_fd(-1), m_index(),
-  m_compressor(0), m_buffer(0), m_fix_index_buffer(0), m_var_index_buffer(0),
-  m_outstanding_appends(0), m_offset(0), m_last_key(0), m_file_length(0), m_disk_usage(0), m_file_id(0), m_uncompressed_blocksize(0) {
+  m_compressor(0), m_compressor_pool(0), m_buffer(0), m_fix_index_buffer(0), m_var_index_buffer(0),
+  m_outstanding_appends(0), m_offset(0), m_last_key(0), m_key_buf(0), m_block_entries(0), m_file_length(0), m_disk_usage(0), m_file_id(0), m_uncompressed_blocksize(0),
+  m_bloom_filter_mode(BLOOM_FILTER_DISABLED), m_bloom_filter(0),
+  m_index_loaded(false), m_index_refcount(0), m_index_last_used(0) {
   m_file_id = FileBlockCache::get_next_file_id();
   assert(sizeof(float) == 4);
 }
@@ -60,7 +66,9 @@ CellStoreV0::CellStoreV0(Filesystem *filesys) : m_filesys(filesys), m_filename()
 
 CellStoreV0::~CellStoreV0() {
   try {
+    delete m_compressor_pool;
     delete m_compressor;
+    delete m_bloom_filter;
 
     if (m_fd != -1)
       m_filesys->close(m_fd);
@@ -96,9 +104,13 @@ CellListScanner *CellStoreV0::create_scanner(ScanContextPtr &scan_ctx) {
 }
 
 
-int CellStoreV0::create(const char *fname, uint32_t blocksize, const std::string &compressor) {
+int CellStoreV0::create(const char *fname, uint32_t blocksize, const std::string &compressor,
+                        BloomFilterMode bloom_filter_mode) {
   m_buffer.reserve(blocksize*4);
 
+  m_bloom_filter_mode = bloom_filter_mode;
+  m_bloom_filter_items.clear();
+
   m_fd = -1;
   m_offset = 0;
   m_last_key = 0;
@@ -110,6 +122,7 @@ int CellStoreV0::create(const char *fname, uint32_t blocksize, const std::string
 
   m_trailer.clear();
   m_trailer.blocksize = blocksize;
+  m_trailer.version = std::min(Global::cellstore_version, (uint16_t)VERSION_PREFIX_KEYS);
   m_uncompressed_blocksize = blocksize;
 
   m_filename = fname;
@@ -128,6 +141,11 @@ int CellStoreV0::create(const char *fname, uint32_t blocksize, const std::string
       (BlockCompressionCodec::Type)m_trailer.compression_type,
       m_compressor_args);
 
+  if (Global::cellstore_compression_threads > 0)
+    m_compressor_pool = new BlockCompressorPool(Global::cellstore_compression_threads,
+        DATA_BLOCK_MAGIC, (BlockCompressionCodec::Type)m_trailer.compression_type,
+        m_compressor_args);
+
   try { m_fd = m_filesys->create(m_filename, true, -1, -1, -1); }
   catch (Exception &e) {
     HT_ERRORF("Error creating cellstore: %s", e.what());
@@ -138,55 +156,31 @@ int CellStoreV0::create(const char *fname, uint32_t blocksize, const std::string
 
 
 int CellStoreV0::add(const ByteString key, const ByteString value, int64_t real_timestamp) {
-  EventPtr event_ptr;
-  DynamicBuffer zbuf;
 
   (void)real_timestamp;
 
   if (m_buffer.fill() > m_uncompressed_blocksize) {
-    BlockCompressionHeader header(DATA_BLOCK_MAGIC);
-
-    add_index_entry(m_last_key, m_offset);
-
-    m_uncompressed_data += (float)m_buffer.fill();
-    m_compressor->deflate(m_buffer, zbuf, header);
-    m_compressed_data += (float)zbuf.fill();
-    m_buffer.clear();
-
-    uint64_t llval = ((uint64_t)m_trailer.blocksize * (uint64_t)m_uncompressed_data) / (uint64_t)m_compressed_data;
-    m_uncompressed_blocksize = (uint32_t)llval;
-
-    if (m_outstanding_appends >= MAX_APPENDS_OUTSTANDING) {
-      if (!m_sync_handler.wait_for_reply(event_ptr)) {
-        HT_ERRORF("Problem writing to DFS file '%s' : %s", m_filename.c_str(), Hypertable::Protocol::string_format_message(event_ptr).c_str());
-        return -1;
-      }
-      m_outstanding_appends--;
-    }
-
-    size_t zlen = zbuf.fill();
-    StaticBuffer send_buf(zbuf);
-
-    try { m_filesys->append(m_fd, send_buf, 0, &m_sync_handler); }
-    catch (Exception &e) {
-      HT_ERRORF("Problem writing to DFS file '%s' : %s",
-                m_filename.c_str(), e.what());
+    if (flush_block() != 0)
       return -1;
-    }
-    m_outstanding_appends++;
-    m_offset += zlen;
   }
 
-  size_t key_len = key.length();
-  size_t value_len = value.length();
+  if (m_trailer.version == VERSION_PREFIX_KEYS)
+    add_prefix_entry(key, value);
+  else {
+    size_t key_len = key.length();
+    size_t value_len = value.length();
 
-  m_buffer.ensure(key_len + value_len);
+    m_buffer.ensure(key_len + value_len);
 
-  m_last_key.ptr = m_buffer.add_unchecked(key.ptr, key_len);
-  m_buffer.add_unchecked(value.ptr, value_len);
+    m_last_key.ptr = m_buffer.add_unchecked(key.ptr, key_len);
+    m_buffer.add_unchecked(value.ptr, value_len);
+  }
 
   m_trailer.total_entries++;
 
+  if (m_bloom_filter_mode != BLOOM_FILTER_DISABLED)
+    add_bloom_filter_entry(key);
+
   return 0;
 }
 
@@ -199,43 +193,23 @@ int CellStoreV0::finalize(Timestamp &timestamp) {
   DynamicBuffer zbuf(0);
   size_t len;
   uint8_t *base;
-  ByteString key;
   StaticBuffer send_buf;
 
   if (m_buffer.fill() > 0) {
-    BlockCompressionHeader header(DATA_BLOCK_MAGIC);
-
-    add_index_entry(m_last_key, m_offset);
-
-    m_uncompressed_data += (float)m_buffer.fill();
-    m_compressor->deflate(m_buffer, zbuf, header);
-    m_compressed_data += (float)zbuf.fill();
-
-    zlen = zbuf.fill();
-    send_buf = zbuf;
-
-    if (m_outstanding_appends >= MAX_APPENDS_OUTSTANDING) {
-      if (!m_sync_handler.wait_for_reply(event_ptr)) {
-        HT_ERRORF("Problem writing to DFS file '%s' : %s", m_filename.c_str(), Protocol::string_format_message(event_ptr).c_str());
-        goto abort;
-      }
-      m_outstanding_appends--;
-    }
+    if (flush_block() != 0)
+      goto abort;
+  }
 
-    try { m_filesys->append(m_fd, send_buf, 0, &m_sync_handler); }
-    catch (Exception &e) {
-      HT_ERRORF("Problem writing to DFS file '%s' : %s", m_filename.c_str(),
-                e.what());
+  if (m_compressor_pool) {
+    if (drain_blocks(true) != 0)
       goto abort;
-    }
-    m_outstanding_appends++;
-    m_offset += zlen;
+    delete m_compressor_pool;
+    m_compressor_pool = 0;
   }
 
   m_trailer.fix_index_offset = m_offset;
   m_trailer.timestamp = timestamp;
   m_trailer.compression_ratio = m_compressed_data / m_uncompressed_data;
-  m_trailer.version = 0;
 
   /**
    * Chop the Index buffers down to the exact length
@@ -269,40 +243,63 @@ int CellStoreV0::finalize(Timestamp &timestamp) {
   m_offset += zlen;
 
   /**
-   * Write variable index + trailer
+   * Write variable index
    */
   {
     BlockCompressionHeader header(INDEX_VARIABLE_BLOCK_MAGIC);
     m_trailer.var_index_offset = m_offset;
-    m_compressor->deflate(m_var_index_buffer, zbuf, header, m_trailer.size());
+    m_compressor->deflate(m_var_index_buffer, zbuf, header);
+  }
+
+  zlen = zbuf.fill();
+  send_buf = zbuf;
+
+  try { m_filesys->append(m_fd, send_buf, 0, &m_sync_handler); }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    goto abort;
+  }
+  m_outstanding_appends++;
+  m_offset += zlen;
+
+  /**
+   * Write bloom filter (if any) + trailer
+   */
+  m_trailer.filter_offset = m_offset;
+
+  if (m_bloom_filter_mode != BLOOM_FILTER_DISABLED) {
+    BlockCompressionHeader header(BLOOM_FILTER_BLOCK_MAGIC);
+    create_bloom_filter();
+    DynamicBuffer filter_buf(1 + m_bloom_filter->encoded_length());
+    *filter_buf.ptr++ = (uint8_t)m_bloom_filter_mode;
+    m_bloom_filter->encode(&filter_buf.ptr);
+    m_compressor->deflate(filter_buf, zbuf, header, m_trailer.size());
+  }
+  else {
+    zbuf.clear();
+    zbuf.reserve(m_trailer.size());
   }
 
   /**
-   * Set up m_index map
+   * Set up block index
    */
-  uint32_t offset;
-  m_fix_index_buffer.ptr = m_fix_index_buffer.base;
-  m_var_index_buffer.ptr = m_var_index_buffer.base;
-  for (size_t i=0; i<m_trailer.index_entries; i++) {
-    // variable portion
-    key.ptr = m_var_index_buffer.ptr;
-    m_var_index_buffer.ptr += key.length();
-    // fixed portion (e.g. offset)
-    memcpy(&offset, m_fix_index_buffer.ptr, sizeof(offset));
-    m_fix_index_buffer.ptr += sizeof(offset);
-    m_index.insert(m_index.end(), IndexMap::value_type(key, offset));
-    if (i == m_trailer.index_entries/2) {
-      record_split_row(ByteString(m_var_index_buffer.ptr));
-    }
+  {
+    boost::mutex::scoped_lock lock(m_index_mutex);
+    m_index.load(m_fix_index_buffer, m_var_index_buffer, m_trailer.index_entries);
+    m_index_loaded = true;
+    m_index_last_used = time(0);
+  }
+  {
+    CellStoreBlockIndex::iterator iter = m_index.begin();
+    for (size_t i=0; i<m_trailer.index_entries/2; i++)
+      ++iter;
+    if (iter != m_index.end())
+      record_split_row(iter.key());
   }
 
   // deallocate fix index data
   delete [] m_fix_index_buffer.release();
 
-  // write filter_offset (empty for now)
-  m_trailer.filter_offset = m_offset + zbuf.fill();
-
-  //
   m_trailer.serialize(zbuf.ptr);
   zbuf.ptr += m_trailer.size();
 
@@ -338,6 +335,8 @@ int CellStoreV0::finalize(Timestamp &timestamp) {
   error = 0;
 
  abort:
+  delete m_compressor_pool;
+  m_compressor_pool = 0;
   delete m_compressor;
   m_compressor = 0;
 
@@ -346,6 +345,148 @@ int CellStoreV0::finalize(Timestamp &timestamp) {
 
 
 
+/**
+ * Appends a version 1 entry, storing only the part of the key that
+ * differs from the previous key unless the entry is a restart point.
+ * The full key is kept in m_key_buf for the next comparison and for the
+ * block index.
+ */
+void CellStoreV0::add_prefix_entry(const ByteString key, const ByteString value) {
+  const uint8_t *kptr;
+  size_t klen = key.decode_length(&kptr);
+  size_t key_len = key.length();
+  size_t value_len = value.length();
+  size_t shared = 0;
+
+  if (m_block_entries++ % RESTART_INTERVAL == 0)
+    m_restarts.push_back(m_buffer.fill());
+  else {
+    const uint8_t *lptr;
+    size_t llen = m_last_key.decode_length(&lptr);
+    size_t limit = std::min(klen, llen);
+    while (shared < limit && kptr[shared] == lptr[shared])
+      shared++;
+  }
+
+  m_buffer.ensure(10 + (klen - shared) + value_len);
+  Serialization::encode_vi32(&m_buffer.ptr, shared);
+  Serialization::encode_vi32(&m_buffer.ptr, klen - shared);
+  m_buffer.add_unchecked(kptr + shared, klen - shared);
+  m_buffer.add_unchecked(value.ptr, value_len);
+
+  m_key_buf.clear();
+  m_key_buf.ensure(key_len);
+  m_last_key.ptr = m_key_buf.add_unchecked(key.ptr, key_len);
+}
+
+
+
+/**
+ * Hands the buffered block to the compressor pool, or compresses and
+ * writes it inline if there is no pool.
+ */
+int CellStoreV0::flush_block() {
+
+  if (m_trailer.version == VERSION_PREFIX_KEYS) {
+    m_buffer.ensure(4 * (m_restarts.size() + 1));
+    foreach(uint32_t offset, m_restarts)
+      Serialization::encode_i32(&m_buffer.ptr, offset);
+    Serialization::encode_i32(&m_buffer.ptr, m_restarts.size());
+    m_restarts.clear();
+    m_block_entries = 0;
+  }
+
+  if (m_compressor_pool == 0) {
+    BlockCompressionHeader header(DATA_BLOCK_MAGIC);
+    DynamicBuffer zbuf(0);
+    m_compressor->deflate(m_buffer, zbuf, header);
+    int error = write_block(zbuf, m_buffer.fill(), m_last_key);
+    m_buffer.clear();
+    return error;
+  }
+
+  BlockCompressorPool::Block *block = new BlockCompressorPool::Block();
+  block->raw.base = m_buffer.base;
+  block->raw.ptr = m_buffer.ptr;
+  block->raw.size = m_buffer.size;
+  block->last_key.set(m_last_key.ptr, m_last_key.length());
+  m_buffer.release();
+  m_buffer.reserve(m_trailer.blocksize*4);
+  m_last_key = 0;
+
+  m_compressor_pool->add(block);
+
+  return drain_blocks(false);
+}
+
+
+/**
+ * Writes out compressed blocks in the order they were added to the pool.
+ * Unless waiting for all of them, this only waits while more than two
+ * blocks per worker are in the pool, so compression overlaps with both
+ * the caller and the appends in flight.
+ */
+int CellStoreV0::drain_blocks(bool wait_for_all) {
+  size_t max_queued = 2 * m_compressor_pool->get_worker_count();
+  BlockCompressorPool::Block *block;
+  int error = 0;
+
+  while ((block = m_compressor_pool->next(wait_for_all || m_compressor_pool->size() > max_queued)) != 0) {
+    if (error == 0) {
+      if (block->error != Error::OK) {
+        HT_ERRORF("Problem compressing block for '%s' : %s - %s", m_filename.c_str(),
+                  Error::get_text(block->error), block->error_msg.c_str());
+        error = -1;
+      }
+      else
+        error = write_block(block->zbuf, block->raw.fill(),
+                            ByteString(block->last_key.base));
+    }
+    delete block;
+  }
+
+  return error;
+}
+
+
+/**
+ * Appends a compressed data block and indexes it under its last key
+ */
+int CellStoreV0::write_block(DynamicBuffer &zbuf, size_t uncompressed_len, const ByteString last_key) {
+  EventPtr event_ptr;
+
+  add_index_entry(last_key, m_offset);
+
+  m_uncompressed_data += (float)uncompressed_len;
+  m_compressed_data += (float)zbuf.fill();
+
+  uint64_t llval = ((uint64_t)m_trailer.blocksize * (uint64_t)m_uncompressed_data) / (uint64_t)m_compressed_data;
+  m_uncompressed_blocksize = (uint32_t)llval;
+
+  if (m_outstanding_appends >= MAX_APPENDS_OUTSTANDING) {
+    if (!m_sync_handler.wait_for_reply(event_ptr)) {
+      HT_ERRORF("Problem writing to DFS file '%s' : %s", m_filename.c_str(), Protocol::string_format_message(event_ptr).c_str());
+      return -1;
+    }
+    m_outstanding_appends--;
+  }
+
+  size_t zlen = zbuf.fill();
+  StaticBuffer send_buf(zbuf);
+
+  try { m_filesys->append(m_fd, send_buf, 0, &m_sync_handler); }
+  catch (Exception &e) {
+    HT_ERRORF("Problem writing to DFS file '%s' : %s",
+              m_filename.c_str(), e.what());
+    return -1;
+  }
+  m_outstanding_appends++;
+  m_offset += zlen;
+
+  return 0;
+}
+
+
 /**
  *
  */
@@ -427,13 +568,14 @@ int CellStoreV0::open(const char *fname, const char *start_row, const char *end_
   }
 
   /** Sanity check trailer **/
-  if (m_trailer.version != 0) {
+  if (m_trailer.version > VERSION_PREFIX_KEYS) {
     HT_ERRORF("Unsupported CellStore version (%d) for file '%s'",
               m_trailer.version, fname);
     goto abort;
   }
   if (!(m_trailer.fix_index_offset < m_trailer.var_index_offset &&
-        m_trailer.var_index_offset < m_file_length)) {
+        m_trailer.var_index_offset < m_trailer.filter_offset &&
+        m_trailer.filter_offset <= m_file_length - m_trailer.size())) {
     HT_ERRORF("Bad index offsets in CellStore trailer fix=%lld, var=%lld, "
               "length=%lld, file='%s'", m_trailer.fix_index_offset,
               m_trailer.var_index_offset, m_file_length, fname);
@@ -448,17 +590,69 @@ int CellStoreV0::open(const char *fname, const char *start_row, const char *end_
 
 
 int CellStoreV0::load_index() {
+
+  {
+    boost::mutex::scoped_lock lock(m_index_mutex);
+    if (read_index(true) != 0)
+      return -1;
+  }
+
+  /**
+   * Compute disk usage
+   */
+  {
+    uint32_t start = 0;
+    uint32_t end = (uint32_t)m_file_length;
+    size_t start_row_length = m_start_row.length() + 1;
+    size_t end_row_length = m_end_row.length() + 1;
+    DynamicBuffer dbuf(7 + std::max(start_row_length, end_row_length));
+    ByteString bs;
+    CellStoreBlockIndex::iterator iter, mid_iter, end_iter;
+
+    dbuf.clear();
+    append_as_byte_string(dbuf, m_start_row.c_str(), start_row_length);
+    bs.ptr = dbuf.base;
+    iter = m_index.upper_bound(bs);
+    start = iter.value();
+
+    dbuf.clear();
+    append_as_byte_string(dbuf, m_end_row.c_str(), end_row_length);
+    bs.ptr = dbuf.base;
+    if ((end_iter = m_index.lower_bound(bs)) == m_index.end())
+      end = m_file_length;
+    else
+      end = end_iter.value();
+
+    m_disk_usage = end - start;
+
+    size_t i=0;
+    for (mid_iter=iter; iter!=end_iter; ++iter,++i) {
+      if ((i%2)==0)
+        ++mid_iter;
+    }
+    if (mid_iter != m_index.end())
+      record_split_row(mid_iter.key());
+  }
+
+  return 0;
+}
+
+
+/**
+ * Reads and inflates the block index, and the bloom filter if load_filter
+ * is set.  Called with m_index_mutex held.
+ */
+int CellStoreV0::read_index(bool load_filter) {
   int error = -1;
   uint32_t amount;
-  uint8_t *fix_end;
-  uint8_t *var_end;
   uint32_t len;
   BlockCompressionHeader header;
-  ByteString key;
-
-  m_compressor = create_block_compression_codec();
+  BlockCompressionCodec *codec = create_block_compression_codec();
 
-  amount = (m_file_length-m_trailer.size()) - m_trailer.fix_index_offset;
+  if (load_filter)
+    amount = (m_file_length-m_trailer.size()) - m_trailer.fix_index_offset;
+  else
+    amount = m_trailer.filter_offset - m_trailer.fix_index_offset;
 
   try {
     DynamicBuffer buf(amount);
@@ -471,21 +665,41 @@ int CellStoreV0::load_index() {
                 m_filename.c_str(), amount, len);
     /** inflate fixed index **/
     buf.ptr += (m_trailer.var_index_offset - m_trailer.fix_index_offset);
-    m_compressor->inflate(buf, m_fix_index_buffer, header);
+    codec->inflate(buf, m_fix_index_buffer, header);
 
     if (!header.check_magic(INDEX_FIXED_BLOCK_MAGIC))
       HT_THROW(Error::BLOCK_COMPRESSOR_BAD_MAGIC, "");
 
     /** inflate variable index **/
     DynamicBuffer vbuf(0, false);
-    amount = (m_file_length-m_trailer.size()) - m_trailer.var_index_offset;
+    amount = m_trailer.filter_offset - m_trailer.var_index_offset;
     vbuf.base = buf.ptr;
     vbuf.ptr = buf.ptr + amount;
 
-    m_compressor->inflate(vbuf, m_var_index_buffer, header);
+    codec->inflate(vbuf, m_var_index_buffer, header);
 
     if (!header.check_magic(INDEX_VARIABLE_BLOCK_MAGIC))
       HT_THROW(Error::BLOCK_COMPRESSOR_BAD_MAGIC, "");
+
+    /** inflate bloom filter (stores written without one have none) **/
+    amount = (m_file_length-m_trailer.size()) - m_trailer.filter_offset;
+    if (load_filter && amount > 0) {
+      DynamicBuffer fbuf(0, false);
+      DynamicBuffer filter_buf;
+      fbuf.base = vbuf.ptr;
+      fbuf.ptr = vbuf.ptr + amount;
+
+      codec->inflate(fbuf, filter_buf, header);
+
+      if (!header.check_magic(BLOOM_FILTER_BLOCK_MAGIC))
+        HT_THROW(Error::BLOCK_COMPRESSOR_BAD_MAGIC, "");
+
+      const uint8_t *ptr = filter_buf.base;
+      size_t remaining = filter_buf.fill();
+      m_bloom_filter_mode = (BloomFilterMode)Serialization::decode_i8(&ptr, &remaining);
+      delete m_bloom_filter;
+      m_bloom_filter = new BloomFilter(&ptr, &remaining);
+    }
   }
   catch (Exception &e) {
     HT_ERROR_OUT <<"Error reading trailer for cellstore '"<< m_filename
@@ -493,75 +707,47 @@ int CellStoreV0::load_index() {
     goto abort;
   }
 
-  m_index.clear();
-
-  uint32_t offset;
+  assert(m_fix_index_buffer.fill() == m_trailer.index_entries * sizeof(uint32_t));
 
-  // record end offsets for sanity checking and reset ptr
-  fix_end = m_fix_index_buffer.ptr;
-  m_fix_index_buffer.ptr = m_fix_index_buffer.base;
-  var_end = m_var_index_buffer.ptr;
-  m_var_index_buffer.ptr = m_var_index_buffer.base;
+  m_index.load(m_fix_index_buffer, m_var_index_buffer, m_trailer.index_entries);
+  m_index_loaded = true;
+  m_index_last_used = time(0);
 
-  for (size_t i=0; i< m_trailer.index_entries; i++) {
-    assert(m_fix_index_buffer.ptr < fix_end);
-    assert(m_var_index_buffer.ptr < var_end);
+  error = 0;
 
-    // Deserialized cell key (variable portion)
-    key.ptr = m_var_index_buffer.ptr;
-    m_var_index_buffer.ptr += key.length();
+ abort:
+  delete codec;
+  delete [] m_fix_index_buffer.release();
+  return error;
+}
 
-    // Deserialize offset
-    memcpy(&offset, m_fix_index_buffer.ptr, sizeof(offset));
-    m_fix_index_buffer.ptr += sizeof(offset);
 
-    m_index.insert(m_index.end(), IndexMap::value_type(key, offset));
-  }
-
-  /**
-   * Compute disk usage
-   */
-  {
-    uint32_t start = 0;
-    uint32_t end = (uint32_t)m_file_length;
-    size_t start_row_length = m_start_row.length() + 1;
-    size_t end_row_length = m_end_row.length() + 1;
-    DynamicBuffer dbuf(7 + std::max(start_row_length, end_row_length));
-    ByteString bs;
-    CellStoreV0::IndexMap::const_iterator iter, mid_iter, end_iter;
+/**
+ * Pins the block index for a scanner, reading it back in if it was purged
+ */
+void CellStoreV0::acquire_index() {
+  boost::mutex::scoped_lock lock(m_index_mutex);
+  if (!m_index_loaded && read_index(false) != 0)
+    HT_THROWF(Error::DFSBROKER_IO_ERROR, "Problem reloading index for "
+              "CellStore '%s'", m_filename.c_str());
+  m_index_refcount++;
+  m_index_last_used = time(0);
+}
 
-    dbuf.clear();
-    append_as_byte_string(dbuf, m_start_row.c_str(), start_row_length);
-    bs.ptr = dbuf.base;
-    iter = m_index.upper_bound(bs);
-    start = (*iter).second;
 
-    dbuf.clear();
-    append_as_byte_string(dbuf, m_end_row.c_str(), end_row_length);
-    bs.ptr = dbuf.base;
-    if ((end_iter = m_index.lower_bound(bs)) == m_index.end())
-      end = m_file_length;
-    else
-      end = (*end_iter).second;
+void CellStoreV0::release_index() {
+  boost::mutex::scoped_lock lock(m_index_mutex);
+  m_index_refcount--;
+  m_index_last_used = time(0);
+}
 
-    m_disk_usage = end - start;
 
-    size_t i=0;
-    for (mid_iter=iter; iter!=end_iter; ++iter,++i) {
-      if ((i%2)==0)
-        ++mid_iter;
-    }
-    if (mid_iter != m_index.end())
-      record_split_row((*mid_iter).first);
+void CellStoreV0::purge_index(time_t expire_time) {
+  boost::mutex::scoped_lock lock(m_index_mutex);
+  if (m_index_loaded && m_index_refcount == 0 && m_index_last_used < expire_time) {
+    m_index.clear();
+    m_index_loaded = false;
   }
-
-  error = 0;
-
- abort:
-  delete m_compressor;
-  m_compressor = 0;
-  delete [] m_fix_index_buffer.release();
-  return error;
 }
 
 
@@ -573,17 +759,17 @@ void CellStoreV0::display_block_info() {
   uint32_t last_offset = 0;
   uint32_t block_size;
   size_t i=0;
-  for (IndexMap::const_iterator iter = m_index.begin(); iter != m_index.end(); iter++) {
+  for (CellStoreBlockIndex::iterator iter = m_index.begin(); iter != m_index.end(); iter++) {
     if (last_key) {
-      block_size = (*iter).second - last_offset;
+      block_size = iter.value() - last_offset;
       cout << i << ": offset=" << last_offset << " size=" << block_size << " row=" << last_key.str() << endl;
       i++;
     }
-    last_offset = (*iter).second;
-    last_key = (*iter).first;
+    last_offset = iter.value();
+    last_key = iter.key();
   }
   if (last_key) {
-    block_size = m_trailer.filter_offset - last_offset;
+    block_size = m_trailer.fix_index_offset - last_offset;
     cout << i << ": offset=" << last_offset << " size=" << block_size << " row=" << last_key.str() << endl;
   }
 }
@@ -598,3 +784,62 @@ void CellStoreV0::record_split_row(const ByteString key) {
     m_split_row = split_row;
   //cout << "record_split_row = " << m_split_row << endl;
 }
+
+
+
+/**
+ * Records the hash of the row (or row + column family) of a key.  Keys
+ * arrive in sorted order, so a repeat of the previous hash is dropped.
+ */
+void CellStoreV0::add_bloom_filter_entry(const ByteString key) {
+  const uint8_t *ptr;
+  key.decode_length(&ptr);
+  size_t len = strlen((const char *)ptr);
+
+  // row + NUL + column family code are contiguous in the key
+  if (m_bloom_filter_mode == BLOOM_FILTER_ROWS_COLS)
+    len += 2;
+
+  uint64_t hash = BloomFilter::hash(ptr, len);
+  if (m_bloom_filter_items.empty() || m_bloom_filter_items.back() != hash)
+    m_bloom_filter_items.push_back(hash);
+}
+
+
+
+void CellStoreV0::create_bloom_filter() {
+  delete m_bloom_filter;
+  m_bloom_filter = new BloomFilter(m_bloom_filter_items.size(),
+                                   BLOOM_FILTER_FALSE_POSITIVE_PROB);
+  foreach(uint64_t hash, m_bloom_filter_items)
+    m_bloom_filter->insert_hash(hash);
+  std::vector<uint64_t>().swap(m_bloom_filter_items);
+}
+
+
+
+bool CellStoreV0::may_contain(ScanContextPtr &scan_ctx) {
+
+  if (m_bloom_filter == 0 || !scan_ctx->single_row)
+    return true;
+
+  const char *row = scan_ctx->start_row.c_str();
+  size_t row_len = strlen(row);
+
+  if (m_bloom_filter_mode == BLOOM_FILTER_ROWS)
+    return m_bloom_filter->may_contain(row, row_len);
+
+  /**
+   * Check each family in the scan, plus family 0 which holds row deletes
+   */
+  String buf(row, row_len + 1);
+  buf.append(1, (char)0);
+  for (size_t i=0; i<256; i++) {
+    if (i == 0 || scan_ctx->family_mask[i]) {
+      buf[row_len+1] = (char)i;
+      if (m_bloom_filter->may_contain(buf.data(), row_len + 2))
+        return true;
+    }
+  }
+  return false;
+}
@@ -22,17 +22,22 @@
 #ifndef HYPERTABLE_CELLSTOREV0_H
 #define HYPERTABLE_CELLSTOREV0_H
 
-#include <map>
+#include <ctime>
 #include <string>
 #include <vector>
 
+#include <boost/thread/mutex.hpp>
+
 #include "AsyncComm/DispatchHandlerSynchronizer.h"
+#include "Common/BloomFilter.h"
 #include "Common/DynamicBuffer.h"
 
 #include "Hypertable/Lib/BlockCompressionCodec.h"
 #include "Hypertable/Lib/Filesystem.h"
 
+#include "BlockCompressorPool.h"
 #include "CellStore.h"
+#include "CellStoreBlockIndex.h"
 #include "CellStoreTrailerV0.h"
 
 
@@ -47,14 +52,31 @@ namespace Hypertable {
 
 namespace Hypertable {
 
+  /**
+   * CellStore file.  The trailer version selects the data block format:
+   *
+   *   0 - each entry is a key ByteString followed by a value ByteString
+   *   1 - keys share a prefix with the key before them.  Each entry is
+   *       vi32 shared, vi32 unshared, the unshared key bytes (the key
+   *       without its length) and the value ByteString.  The first entry
+   *       of a block and every RESTART_INTERVAL-th one after it store the
+   *       full key (shared is zero); the block ends with the 32-bit
+   *       offsets of these restart entries followed by their count.
+   *
+   * Files of either version can be read; new files are written with
+   * Global::cellstore_version.
+   */
   class CellStoreV0 : public CellStore {
 
   public:
 
+    enum { VERSION_PLAIN = 0, VERSION_PREFIX_KEYS = 1, RESTART_INTERVAL = 16 };
+
     CellStoreV0(Filesystem *filesys);
     virtual ~CellStoreV0();
 
-    virtual int create(const char *fname, uint32_t blocksize, const std::string &compressor);
+    virtual int create(const char *fname, uint32_t blocksize, const std::string &compressor,
+                       BloomFilterMode bloom_filter_mode);
     virtual int add(const ByteString key, const ByteString value, int64_t real_timestamp);
     virtual int finalize(Timestamp &timestamp);
     virtual int open(const char *fname, const char *start_row, const char *end_row);
@@ -78,23 +100,36 @@ namespace Hypertable {
 
     virtual CellStoreTrailer *get_trailer() { return &m_trailer; }
 
+    virtual bool may_contain(ScanContextPtr &scan_ctx);
+
+    virtual void purge_index(time_t expire_time);
+
   protected:
 
+    int read_index(bool load_filter);
+    void acquire_index();
+    void release_index();
+    void add_prefix_entry(const ByteString key, const ByteString value);
     void add_index_entry(const ByteString key, uint32_t offset);
+    int flush_block();
+    int drain_blocks(bool wait_for_all);
+    int write_block(DynamicBuffer &zbuf, size_t uncompressed_len, const ByteString last_key);
     void record_split_row(const ByteString key);
+    void add_bloom_filter_entry(const ByteString key);
+    void create_bloom_filter();
 
     static const char DATA_BLOCK_MAGIC[10];
     static const char INDEX_FIXED_BLOCK_MAGIC[10];
     static const char INDEX_VARIABLE_BLOCK_MAGIC[10];
-
-    typedef std::map<ByteString, uint32_t, LtByteString> IndexMap;
+    static const char BLOOM_FILTER_BLOCK_MAGIC[10];
 
     Filesystem            *m_filesys;
     std::string            m_filename;
     int32_t                m_fd;
-    IndexMap               m_index;
+    CellStoreBlockIndex    m_index;
     CellStoreTrailerV0     m_trailer;
     BlockCompressionCodec *m_compressor;
+    BlockCompressorPool   *m_compressor_pool;
     DynamicBuffer          m_buffer;
     DynamicBuffer          m_fix_index_buffer;
     DynamicBuffer          m_var_index_buffer;
@@ -102,6 +137,9 @@ namespace Hypertable {
     uint32_t               m_outstanding_appends;
     uint32_t               m_offset;
     ByteString             m_last_key;
+    DynamicBuffer          m_key_buf;
+    std::vector<uint32_t>  m_restarts;
+    uint32_t               m_block_entries;
     uint64_t               m_file_length;
     uint32_t               m_disk_usage;
     std::string            m_split_row;
@@ -110,6 +148,13 @@ namespace Hypertable {
     float                  m_compressed_data;
     uint32_t               m_uncompressed_blocksize;
     BlockCompressionCodec::Args m_compressor_args;
+    BloomFilterMode        m_bloom_filter_mode;
+    BloomFilter           *m_bloom_filter;
+    std::vector<uint64_t>  m_bloom_filter_items;
+    boost::mutex           m_index_mutex;
+    bool                   m_index_loaded;
+    uint32_t               m_index_refcount;
+    time_t                 m_index_last_used;
   };
   typedef boost::intrusive_ptr<CellStoreV0> CellStoreV0Ptr;
 
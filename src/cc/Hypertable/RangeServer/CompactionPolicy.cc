@@ -0,0 +1,210 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <algorithm>
+
+#include "Common/Sweetener.h"
+#include "Common/Time.h"
+
+#include "CompactionPolicy.h"
+#include "Global.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  /** Orders stores largest (and normally oldest) first */
+  struct GtCellStoreSize {
+    bool operator()(const CellStorePtr &x, const CellStorePtr &y) const {
+      return x->disk_usage() > y->disk_usage();
+    }
+  };
+
+  size_t merge_files() {
+    return (Global::access_group_merge_files > 1) ? (size_t)Global::access_group_merge_files : 2;
+  }
+
+  /** Stores whose data was written before a given time */
+  struct WrittenBefore {
+    WrittenBefore(int64_t cutoff_) : cutoff(cutoff_) { return; }
+    bool operator()(const CellStorePtr &cs) const {
+      Timestamp timestamp;
+      cs->get_timestamp(timestamp);
+      return timestamp.real < cutoff;
+    }
+    int64_t cutoff;
+  };
+
+  /** Stores whose data was written in [begin, end) */
+  struct WrittenBetween {
+    WrittenBetween(int64_t begin_, int64_t end_) : begin(begin_), end(end_) { return; }
+    bool operator()(const CellStorePtr &cs) const {
+      Timestamp timestamp;
+      cs->get_timestamp(timestamp);
+      return timestamp.real >= begin && timestamp.real < end;
+    }
+    int64_t begin, end;
+  };
+
+  /** Orders stores oldest first */
+  struct LtCellStoreTime {
+    bool operator()(const CellStorePtr &x, const CellStorePtr &y) const {
+      Timestamp tx, ty;
+      x->get_timestamp(tx);
+      y->get_timestamp(ty);
+      return tx.real < ty.real;
+    }
+  };
+
+}
+
+
+CompactionPolicy *CompactionPolicy::create(Schema::AccessGroup *ag) {
+
+  if (ag->compaction == "tiered")
+    return new CompactionPolicyTiered();
+  else if (ag->compaction == "leveled")
+    return new CompactionPolicyLeveled();
+  else if (ag->compaction == "timewindow") {
+    uint64_t window = Global::access_group_compaction_window;
+    time_t max_ttl = 0;
+    bool all_expire = !ag->columns.empty();
+    foreach(Schema::ColumnFamily *cf, ag->columns) {
+      if (cf->ttl == 0)
+        all_expire = false;
+      else if (cf->ttl > max_ttl)
+        max_ttl = cf->ttl;
+    }
+    if (all_expire && Global::access_group_max_files > 0)
+      window = (uint64_t)max_ttl / Global::access_group_max_files;
+    return new CompactionPolicyTimeWindow(window, all_expire ? max_ttl : 0);
+  }
+  return new CompactionPolicyMerge();
+}
+
+
+size_t CompactionPolicyMerge::select(std::vector<CellStorePtr> &stores, uint64_t cache_bytes) {
+  if (stores.size() > (size_t)Global::access_group_max_files) {
+    sort(stores.begin(), stores.end(), GtCellStoreSize());
+    return stores.size() - std::min(merge_files(), stores.size());
+  }
+  return stores.size();
+}
+
+
+/**
+ * Tiers are found starting from the smallest stores, so the cheapest full
+ * tier is merged first.  If no tier is full but there are more than
+ * AccessGroup.MaxFiles stores, the smallest stores are merged as with the
+ * "merge" policy.
+ */
+size_t CompactionPolicyTiered::select(std::vector<CellStorePtr> &stores, uint64_t cache_bytes) {
+  size_t count = stores.size();
+  size_t begin, end;
+  uint64_t tier_limit;
+
+  sort(stores.begin(), stores.end(), GtCellStoreSize());
+
+  for (end = count; end > 0; end = begin) {
+    begin = end - 1;
+    tier_limit = 2 * std::max(stores[begin]->disk_usage(), (uint64_t)1);
+    while (begin > 0 && stores[begin-1]->disk_usage() <= tier_limit)
+      begin--;
+    if (end - begin >= merge_files()) {
+      std::rotate(stores.begin()+begin, stores.begin()+end, stores.end());
+      return count - (end - begin);
+    }
+  }
+
+  if (count > (size_t)Global::access_group_max_files)
+    return count - std::min(merge_files(), count);
+  return count;
+}
+
+
+/**
+ * Merges from the largest store that is less than AccessGroup.MergeFiles
+ * times the size of all newer data, including the cell cache.
+ */
+size_t CompactionPolicyLeveled::select(std::vector<CellStorePtr> &stores, uint64_t cache_bytes) {
+  size_t count = stores.size();
+  size_t first = count;
+  uint64_t newer = cache_bytes;
+  uint64_t size;
+
+  sort(stores.begin(), stores.end(), GtCellStoreSize());
+
+  for (size_t i=count; i>0; i--) {
+    size = stores[i-1]->disk_usage();
+    if (size < merge_files() * newer)
+      first = i-1;
+    newer += size;
+  }
+
+  if (count > (size_t)Global::access_group_max_files)
+    first = std::min(first, count - std::min(merge_files(), count));
+
+  return first;
+}
+
+
+CompactionPolicyTimeWindow::CompactionPolicyTimeWindow(uint64_t window_seconds, uint64_t ttl_seconds)
+  : m_window((window_seconds > 0) ? window_seconds * 1000000000LL : 1000000000LL),
+    m_ttl(ttl_seconds * 1000000000LL) {
+}
+
+
+/**
+ * Stores from earlier windows go first and are not touched, except that
+ * stores written more than the TTL ago hold nothing but expired cells and
+ * are merged away as soon as there are any.  The stores of the current
+ * window are merged once they and the cell cache would make
+ * AccessGroup.MergeFiles stores.  If there are still more than
+ * AccessGroup.MaxFiles stores, the oldest windows are merged in as well.
+ */
+size_t CompactionPolicyTimeWindow::select(std::vector<CellStorePtr> &stores, uint64_t cache_bytes) {
+  int64_t now = get_ts64();
+  int64_t window_start = (int64_t)((now / m_window) * m_window);
+  int64_t expire_time = (m_ttl > 0 && (int64_t)m_ttl < now) ? now - (int64_t)m_ttl : 0;
+  size_t count = stores.size();
+  size_t kept, expired, first;
+
+  std::stable_sort(stores.begin(), stores.end(), LtCellStoreTime());
+  kept = std::stable_partition(stores.begin(), stores.end(),
+             WrittenBetween(expire_time, window_start)) - stores.begin();
+  expired = std::count_if(stores.begin()+kept, stores.end(), WrittenBefore(window_start));
+
+  if (expired > 0 || (count - kept) + 1 >= merge_files())
+    first = kept;
+  else
+    first = count;
+
+  if (count > (size_t)Global::access_group_max_files) {
+    size_t merging = (first < count) ? count - first : 0;
+    size_t oldest = (merging < merge_files()) ? merge_files() - merging : 0;
+    oldest = std::min(oldest, kept);
+    std::rotate(stores.begin(), stores.begin()+oldest, stores.end());
+    first = kept - oldest;
+  }
+
+  return first;
+}
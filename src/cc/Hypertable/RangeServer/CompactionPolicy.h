@@ -0,0 +1,128 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_COMPACTIONPOLICY_H
+#define HYPERTABLE_COMPACTIONPOLICY_H
+
+#include <vector>
+
+#include "Common/ReferenceCount.h"
+
+#include "Hypertable/Lib/Schema.h"
+
+#include "CellStore.h"
+
+namespace Hypertable {
+
+  /**
+   * Decides which cell stores of an access group a non-major compaction
+   * merges together with the cell cache.  An access group picks its policy
+   * with the compaction attribute of its schema.
+   */
+  class CompactionPolicy : public ReferenceCount {
+  public:
+    virtual ~CompactionPolicy() { return; }
+
+    /**
+     * Reorders stores so that the ones to merge are at the end.
+     *
+     * @param stores cell stores of the access group
+     * @param cache_bytes estimated size of the cell cache once written out
+     * @return index of the first store to merge, or stores.size() for a
+     *         minor compaction
+     */
+    virtual size_t select(std::vector<CellStorePtr> &stores, uint64_t cache_bytes) = 0;
+
+    virtual const char *name() = 0;
+
+    /**
+     * Creates the policy named by the access group's compaction attribute.
+     * An empty or unknown name gives the "merge" policy.
+     */
+    static CompactionPolicy *create(Schema::AccessGroup *ag);
+  };
+
+  typedef boost::intrusive_ptr<CompactionPolicy> CompactionPolicyPtr;
+
+
+  /**
+   * Once there are more than AccessGroup.MaxFiles stores, merges the
+   * AccessGroup.MergeFiles smallest ones.
+   */
+  class CompactionPolicyMerge : public CompactionPolicy {
+  public:
+    virtual size_t select(std::vector<CellStorePtr> &stores, uint64_t cache_bytes);
+    virtual const char *name() { return "merge"; }
+  };
+
+
+  /**
+   * Size-tiered.  Stores within a factor of two in size form a tier, and a
+   * tier is merged once it holds AccessGroup.MergeFiles stores.  Each cell
+   * gets rewritten about once per tier, which suits append-mostly tables.
+   */
+  class CompactionPolicyTiered : public CompactionPolicy {
+  public:
+    virtual size_t select(std::vector<CellStorePtr> &stores, uint64_t cache_bytes);
+    virtual const char *name() { return "tiered"; }
+  };
+
+
+  /**
+   * Size-ratio leveled.  Stores are kept so that each one is at least
+   * AccessGroup.MergeFiles times the size of everything newer, so there
+   * are only a few stores to read and overwritten cells are dropped soon,
+   * at the cost of rewriting data more often.
+   */
+  class CompactionPolicyLeveled : public CompactionPolicy {
+  public:
+    virtual size_t select(std::vector<CellStorePtr> &stores, uint64_t cache_bytes);
+    virtual const char *name() { return "leveled"; }
+  };
+
+
+  /**
+   * Time-windowed, for time-series data.  Only stores written in the
+   * current time window are merged, so older windows are written once and
+   * then left alone until their cells have expired or there are more than
+   * AccessGroup.MaxFiles stores.  When every column family of the access
+   * group has a TTL, the window is the largest TTL divided by
+   * AccessGroup.MaxFiles, otherwise it is AccessGroup.CompactionWindow
+   * seconds.
+   */
+  class CompactionPolicyTimeWindow : public CompactionPolicy {
+  public:
+    /**
+     * @param window_seconds length of a time window
+     * @param ttl_seconds largest TTL of the access group's column families,
+     *        or 0 if some of them keep cells forever
+     */
+    CompactionPolicyTimeWindow(uint64_t window_seconds, uint64_t ttl_seconds = 0);
+    virtual size_t select(std::vector<CellStorePtr> &stores, uint64_t cache_bytes);
+    virtual const char *name() { return "timewindow"; }
+  private:
+    uint64_t m_window;
+    uint64_t m_ttl;
+  };
+
+}
+
+#endif // HYPERTABLE_COMPACTIONPOLICY_H
@@ -23,6 +23,8 @@
 #include <cassert>
 #include <iostream>
 
+#include "Common/Logger.h"
+
 #include "FileBlockCache.h"
 
 using namespace Hypertable;
@@ -30,79 +32,135 @@ using std::pair;
 
 atomic_t FileBlockCache::ms_next_file_id = ATOMIC_INIT(0);
 
+
+FileBlockCache::FileBlockCache(uint64_t max_memory, size_t shard_count)
+  : m_shard_count(shard_count ? shard_count : 1), m_max_memory(max_memory) {
+  uint64_t shard_memory = m_max_memory / m_shard_count;
+
+  m_shards = new Shard [m_shard_count];
+  for (size_t i=0; i<m_shard_count; i++) {
+    m_shards[i].avail_memory = shard_memory;
+    m_shards[i].max_protected_memory = (shard_memory * PROTECTED_PERCENT) / 100;
+    m_shards[i].stats.max_memory = shard_memory;
+  }
+}
+
+
 FileBlockCache::~FileBlockCache() {
-  for (BlockCache::const_iterator iter = m_cache.begin();
-       iter != m_cache.end(); ++iter)
-    delete [] (*iter).block;
+  for (size_t i=0; i<m_shard_count; i++) {
+    for (BlockCache::const_iterator iter = m_shards[i].probation.begin();
+         iter != m_shards[i].probation.end(); ++iter)
+      delete [] (*iter).block;
+    for (BlockCache::const_iterator iter = m_shards[i].protected_segment.begin();
+         iter != m_shards[i].protected_segment.end(); ++iter)
+      delete [] (*iter).block;
+  }
+  delete [] m_shards;
 }
 
+
 bool
 FileBlockCache::checkout(int file_id, uint32_t file_offset, uint8_t **blockp,
                          uint32_t *lengthp) {
-  boost::mutex::scoped_lock lock(m_mutex);
-  HashIndex &hash_index = m_cache.get<1>();
+  uint64_t key = make_key(file_id, file_offset);
+  Shard &shard = get_shard(key);
+  boost::mutex::scoped_lock lock(shard.mutex);
+  HashIndex &protected_index = shard.protected_segment.get<1>();
+  HashIndex &probation_index = shard.probation.get<1>();
+  Sequence &protected_seq = shard.protected_segment.get<0>();
   HashIndex::iterator iter;
-  uint64_t key = ((uint64_t)file_id << 32) | file_offset;
 
-  if ((iter = hash_index.find(key)) == hash_index.end())
+  /**
+   * Hit in the protected segment, move it to the MRU end
+   */
+  if ((iter = protected_index.find(key)) != protected_index.end()) {
+    protected_index.modify(iter, IncrementRefCount());
+    protected_seq.relocate(protected_seq.end(),
+                           shard.protected_segment.project<0>(iter));
+    *blockp = (*iter).block;
+    *lengthp = (*iter).length;
+    shard.stats.hits++;
+    return true;
+  }
+
+  if ((iter = probation_index.find(key)) == probation_index.end()) {
+    shard.stats.misses++;
     return false;
+  }
 
+  /**
+   * Second touch, promote the block to the protected segment
+   */
   BlockCacheEntry entry = *iter;
   entry.ref_count++;
 
-  hash_index.erase(iter);
-  
-  pair<Sequence::iterator, bool> insert_result = m_cache.push_back(entry);
+  probation_index.erase(iter);
+
+  pair<Sequence::iterator, bool> insert_result = protected_seq.push_back(entry);
   assert(insert_result.second);
 
+  shard.protected_memory += entry.length;
+
   *blockp = (*insert_result.first).block;
   *lengthp = (*insert_result.first).length;
 
+  // demote LRU protected blocks back to the probationary segment
+  while (shard.protected_memory > shard.max_protected_memory &&
+         shard.protected_segment.size() > 1) {
+    entry = protected_seq.front();
+    protected_seq.pop_front();
+    shard.protected_memory -= entry.length;
+    shard.probation.push_back(entry);
+  }
+
+  shard.stats.hits++;
   return true;
 }
 
 
 void FileBlockCache::checkin(int file_id, uint32_t file_offset) {
-  boost::mutex::scoped_lock lock(m_mutex);
-  HashIndex &hash_index = m_cache.get<1>();
+  uint64_t key = make_key(file_id, file_offset);
+  Shard &shard = get_shard(key);
+  boost::mutex::scoped_lock lock(shard.mutex);
+  HashIndex &protected_index = shard.protected_segment.get<1>();
+  HashIndex &probation_index = shard.probation.get<1>();
   HashIndex::iterator iter;
-  uint64_t key = ((uint64_t)file_id << 32) | file_offset;
 
-  iter = hash_index.find(key);
+  if ((iter = protected_index.find(key)) != protected_index.end()) {
+    assert((*iter).ref_count > 0);
+    protected_index.modify(iter, DecrementRefCount());
+    return;
+  }
+
+  iter = probation_index.find(key);
 
-  assert(iter != hash_index.end() && (*iter).ref_count > 0);
+  assert(iter != probation_index.end() && (*iter).ref_count > 0);
 
-  hash_index.modify(iter, DecrementRefCount());
+  probation_index.modify(iter, DecrementRefCount());
 }
 
 
 bool
 FileBlockCache::insert_and_checkout(int file_id, uint32_t file_offset,
                                     uint8_t *block, uint32_t length) {
-  boost::mutex::scoped_lock lock(m_mutex);
-  HashIndex &hash_index = m_cache.get<1>();
-  uint64_t key = ((uint64_t)file_id << 32) | file_offset;
-
-  if (length > m_max_memory || hash_index.find(key) != hash_index.end())
+  uint64_t key = make_key(file_id, file_offset);
+  Shard &shard = get_shard(key);
+  boost::mutex::scoped_lock lock(shard.mutex);
+  HashIndex &protected_index = shard.protected_segment.get<1>();
+  HashIndex &probation_index = shard.probation.get<1>();
+
+  if (length > shard.stats.max_memory ||
+      protected_index.find(key) != protected_index.end() ||
+      probation_index.find(key) != probation_index.end())
     return false;
 
-  // make room
-  if (m_avail_memory < length) {
-    BlockCache::iterator iter = m_cache.begin();
-    while (iter != m_cache.end()) {
-      if ((*iter).ref_count == 0) {
-	m_avail_memory += (*iter).length;
-	delete [] (*iter).block;
-	iter = m_cache.erase(iter);
-	if (m_avail_memory >= length)
-	  break;
-      }
-      else
-	++iter;
-    }
-  }
+  // make room, sacrificing blocks that have only been touched once first
+  if (shard.avail_memory < length)
+    evict(shard, shard.probation, length);
+  if (shard.avail_memory < length)
+    evict(shard, shard.protected_segment, length);
 
-  if (m_avail_memory < length)
+  if (shard.avail_memory < length)
     return false;
 
   BlockCacheEntry entry(file_id, file_offset);
@@ -110,19 +168,85 @@ FileBlockCache::insert_and_checkout(int file_id, uint32_t file_offset,
   entry.length = length;
   entry.ref_count = 1;
 
-  pair<Sequence::iterator, bool> insert_result = m_cache.push_back(entry);
+  pair<Sequence::iterator, bool> insert_result = shard.probation.push_back(entry);
   assert(insert_result.second);
 
-  m_avail_memory -= length;
-  
+  shard.avail_memory -= length;
+  shard.stats.inserts++;
+
   return true;
 }
 
 
 bool FileBlockCache::contains(int file_id, uint32_t file_offset) {
-  boost::mutex::scoped_lock lock(m_mutex);
-  HashIndex &hash_index = m_cache.get<1>();
-  uint64_t key = ((uint64_t)file_id << 32) | file_offset;
+  uint64_t key = make_key(file_id, file_offset);
+  Shard &shard = get_shard(key);
+  boost::mutex::scoped_lock lock(shard.mutex);
+  HashIndex &protected_index = shard.protected_segment.get<1>();
+  HashIndex &probation_index = shard.probation.get<1>();
+
+  return (protected_index.find(key) != protected_index.end() ||
+          probation_index.find(key) != probation_index.end());
+}
+
+
+void FileBlockCache::get_statistics(std::vector<Statistics> &stats) {
+  stats.resize(m_shard_count);
+  for (size_t i=0; i<m_shard_count; i++) {
+    boost::mutex::scoped_lock lock(m_shards[i].mutex);
+    stats[i] = m_shards[i].stats;
+    stats[i].memory_used = m_shards[i].stats.max_memory - m_shards[i].avail_memory;
+  }
+}
+
+
+void FileBlockCache::log_statistics() {
+  std::vector<Statistics> stats;
+  Statistics total;
 
-  return (hash_index.find(key) != hash_index.end());
+  get_statistics(stats);
+
+  for (size_t i=0; i<stats.size(); i++) {
+    HT_DEBUGF("BlockCache shard %d: hits=%llu misses=%llu inserts=%llu "
+              "evictions=%llu memory=%llu/%llu", (int)i, (Llu)stats[i].hits,
+              (Llu)stats[i].misses, (Llu)stats[i].inserts,
+              (Llu)stats[i].evictions, (Llu)stats[i].memory_used,
+              (Llu)stats[i].max_memory);
+    total.hits += stats[i].hits;
+    total.misses += stats[i].misses;
+    total.inserts += stats[i].inserts;
+    total.evictions += stats[i].evictions;
+    total.memory_used += stats[i].memory_used;
+  }
+
+  HT_INFOF("BlockCache: hits=%llu misses=%llu (%.1f%% hit rate) inserts=%llu "
+           "evictions=%llu memory=%llu/%llu", (Llu)total.hits,
+           (Llu)total.misses, (total.hits + total.misses) ?
+           (100.0 * total.hits) / (total.hits + total.misses) : 0.0,
+           (Llu)total.inserts, (Llu)total.evictions, (Llu)total.memory_used,
+           (Llu)m_max_memory);
+}
+
+
+/**
+ * Evicts unreferenced blocks from the LRU end of the given segment until
+ * the shard has room for the given number of bytes.  Called with the shard
+ * mutex held.
+ */
+void FileBlockCache::evict(Shard &shard, BlockCache &cache, uint32_t length) {
+  BlockCache::iterator iter = cache.begin();
+  while (iter != cache.end()) {
+    if ((*iter).ref_count == 0) {
+      shard.avail_memory += (*iter).length;
+      if (&cache == &shard.protected_segment)
+        shard.protected_memory -= (*iter).length;
+      delete [] (*iter).block;
+      iter = cache.erase(iter);
+      shard.stats.evictions++;
+      if (shard.avail_memory >= length)
+        break;
+    }
+    else
+      ++iter;
+  }
 }
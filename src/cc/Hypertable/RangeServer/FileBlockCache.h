@@ -22,6 +22,8 @@
 #ifndef HYPERTABLE_FILEBLOCKCACHE_H
 #define HYPERTABLE_FILEBLOCKCACHE_H
 
+#include <vector>
+
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
@@ -33,13 +35,37 @@
 namespace Hypertable {
   using namespace boost::multi_index;
 
+  /**
+   * Cache of uncompressed CellStore blocks.  The cache is split into
+   * shards, each with its own lock and an equal share of the memory, and a
+   * block lives in the shard selected by a hash of its (file id, offset)
+   * pair, so concurrent scanners rarely contend on the same lock.
+   *
+   * Each shard is a segmented LRU.  Blocks enter a probationary segment and
+   * are promoted to a protected segment, capped at PROTECTED_PERCENT of the
+   * shard, when they are checked out again.  Blocks that are touched only
+   * once, like those of a large scan, get evicted from the probationary
+   * segment first and can't push the hot working set out of the cache.
+   */
   class FileBlockCache {
 
     static atomic_t ms_next_file_id;
 
   public:
-    FileBlockCache(uint64_t max_memory)
-        : m_max_memory(max_memory), m_avail_memory(max_memory) {  }
+    enum { DEFAULT_SHARDS = 16, PROTECTED_PERCENT = 80 };
+
+    struct Statistics {
+      Statistics() : hits(0), misses(0), inserts(0), evictions(0),
+                     memory_used(0), max_memory(0) { }
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t inserts;
+      uint64_t evictions;
+      uint64_t memory_used;
+      uint64_t max_memory;
+    };
+
+    FileBlockCache(uint64_t max_memory, size_t shard_count = DEFAULT_SHARDS);
     ~FileBlockCache();
 
     bool checkout(int file_id, uint32_t file_offset, uint8_t **blockp,
@@ -49,6 +75,19 @@ namespace Hypertable {
                              uint8_t *block, uint32_t length);
     bool contains(int file_id, uint32_t file_offset);
 
+    /**
+     * Returns a snapshot of the counters of each shard
+     *
+     * @param stats vector to fill, one entry per shard
+     */
+    void get_statistics(std::vector<Statistics> &stats);
+
+    /**
+     * Logs the cache totals at INFO level and per-shard counters at DEBUG
+     * level
+     */
+    void log_statistics();
+
     static int get_next_file_id() {
       return atomic_inc_return(&ms_next_file_id);
     }
@@ -70,6 +109,12 @@ namespace Hypertable {
       uint64_t key() const { return ((uint64_t)file_id << 32) | file_offset; }
     };
 
+    struct IncrementRefCount {
+      void operator()(BlockCacheEntry &entry) {
+        entry.ref_count++;
+      }
+    };
+
     struct DecrementRefCount {
       void operator()(BlockCacheEntry &entry) {
         entry.ref_count--;
@@ -94,10 +139,35 @@ namespace Hypertable {
     typedef BlockCache::nth_index<0>::type Sequence;
     typedef BlockCache::nth_index<1>::type HashIndex;
 
-    boost::mutex  m_mutex;
-    BlockCache    m_cache;
-    uint64_t      m_max_memory;
-    uint64_t      m_avail_memory;
+    struct Shard {
+      Shard() : avail_memory(0), protected_memory(0),
+                max_protected_memory(0) { }
+      boost::mutex mutex;
+      BlockCache   probation;
+      BlockCache   protected_segment;
+      uint64_t     avail_memory;
+      uint64_t     protected_memory;
+      uint64_t     max_protected_memory;
+      Statistics   stats;
+    };
+
+    static uint64_t make_key(int file_id, uint32_t file_offset) {
+      return ((uint64_t)file_id << 32) | file_offset;
+    }
+
+    Shard &get_shard(uint64_t key) {
+      // mix the bits so consecutive blocks of a file spread across shards
+      key ^= key >> 33;
+      key *= 0xff51afd7ed558ccdULL;
+      key ^= key >> 33;
+      return m_shards[key % m_shard_count];
+    }
+
+    void evict(Shard &shard, BlockCache &cache, uint32_t length);
+
+    Shard    *m_shards;
+    size_t    m_shard_count;
+    uint64_t  m_max_memory;
   };
 
 }
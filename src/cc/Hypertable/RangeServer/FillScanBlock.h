@@ -28,7 +28,18 @@
 
 namespace Hypertable {
 
-  bool FillScanBlock(CellListScannerPtr &scanner, DynamicBuffer &dbuf);
+  /**
+   * Fills a scan block with cells from the scanner, stopping before the
+   * block would exceed the limit.  The first cell is always added, even if
+   * it is larger than the limit.
+   *
+   * @param scanner scanner to read cells from
+   * @param dbuf empty buffer to fill
+   * @param limit maximum number of key/value bytes to add
+   * @return true if the scanner has more cells
+   */
+  bool FillScanBlock(CellListScannerPtr &scanner, DynamicBuffer &dbuf,
+                     size_t limit);
 
 }
 
@@ -46,6 +46,10 @@ namespace Hypertable {
   int32_t                Global::access_group_max_files = 0;
   int32_t                Global::access_group_merge_files = 0;
   int32_t                Global::access_group_max_mem = 0;
+  int32_t                Global::access_group_compaction_window = 0;
+  int32_t                Global::cellstore_compression_threads = 0;
+  uint16_t               Global::cellstore_version = 1;
+  int32_t                Global::cellstore_index_ttl = 0;
   ScannerMap             Global::scanner_map;
   FileBlockCache        *Global::block_cache = 0;
   TablePtr               Global::metadata_table_ptr = 0;
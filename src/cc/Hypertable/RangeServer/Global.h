@@ -67,6 +67,10 @@ namespace Hypertable {
     static int32_t        access_group_max_files;
     static int32_t        access_group_merge_files;
     static int32_t        access_group_max_mem;
+    static int32_t        access_group_compaction_window;
+    static int32_t        cellstore_compression_threads;
+    static uint16_t       cellstore_version;
+    static int32_t        cellstore_index_ttl;
     static ScannerMap     scanner_map;
     static Hypertable::FileBlockCache *block_cache;
     static TablePtr       metadata_table_ptr;
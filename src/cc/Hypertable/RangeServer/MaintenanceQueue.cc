@@ -24,3 +24,5 @@
 bool Hypertable::MaintenanceQueue::ms_pause = false;
 boost::condition Hypertable::MaintenanceQueue::ms_cond;
 
+const double Hypertable::MaintenanceTask::SPLIT_PRIORITY = 10.0;
+const double Hypertable::MaintenanceTask::LOG_CLEANUP_PRIORITY = 1000.0;
@@ -24,6 +24,7 @@
 
 #include <cassert>
 #include <queue>
+#include <set>
 
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
@@ -38,6 +39,13 @@
 namespace Hypertable {
 
   /**
+   * Runs maintenance tasks (splits, compactions, log cleanup) on a fixed
+   * pool of threads.  Tasks wait in a delay queue until their start time
+   * and then move to a ready set ordered by priority.  A worker takes the
+   * highest priority ready task whose resources are under their limits:
+   * at most io_limit tasks that write cell stores and at most cpu_limit
+   * tasks that merge existing cell stores run at once, so that maintenance
+   * leaves disk and CPU for foreground requests.
    */
   class MaintenanceQueue : public ReferenceCount {
 
@@ -50,15 +58,30 @@ namespace Hypertable {
       }
     };
 
+    struct GtTaskPriority {
+      bool operator()(const MaintenanceTask *sm1, const MaintenanceTask *sm2) const {
+        if (sm1->priority != sm2->priority)
+          return sm1->priority > sm2->priority;
+        return xtime_cmp(sm1->start_time, sm2->start_time) < 0;
+      }
+    };
+
     typedef std::priority_queue<MaintenanceTask *, std::vector<MaintenanceTask *>, LtMaintenanceTask> TaskQueue;
+    typedef std::multiset<MaintenanceTask *, GtTaskPriority> ReadySet;
 
     class MaintenanceQueueState {
     public:
-      MaintenanceQueueState() : shutdown(false) { return; }
+      MaintenanceQueueState() : shutdown(false), io_active(0), cpu_active(0),
+                                io_limit(0), cpu_limit(0) { return; }
       TaskQueue          queue;
+      ReadySet           ready;
       boost::mutex       mutex;
       boost::condition   cond;
       bool               shutdown;
+      int                io_active;
+      int                cpu_active;
+      int                io_limit;
+      int                cpu_limit;
     };
 
     class Worker {
@@ -68,7 +91,7 @@ namespace Hypertable {
       Worker(MaintenanceQueueState &state) : m_state(state) { return; }
 
       void operator()() {
-        boost::xtime now, next_work;
+        boost::xtime next_work;
         MaintenanceTask *task = 0;
 
         while (true) {
@@ -76,9 +99,7 @@ namespace Hypertable {
           {
             boost::mutex::scoped_lock lock(m_state.mutex);
 
-            boost::xtime_get(&now, boost::TIME_UTC);
-
-            while (m_state.queue.empty() || xtime_cmp((m_state.queue.top())->start_time, now) > 0) {
+            while ((task = next_task()) == 0) {
 
               if (m_state.shutdown)
                 return;
@@ -89,11 +110,9 @@ namespace Hypertable {
                 next_work = (m_state.queue.top())->start_time;
                 m_state.cond.timed_wait(lock, next_work);
               }
-              boost::xtime_get(&now, boost::TIME_UTC);
             }
 
-            task = m_state.queue.top();
-            m_state.queue.pop();
+            acquire(task->resources, 1);
           }
 
           try {
@@ -104,18 +123,66 @@ namespace Hypertable {
 	      while (ms_pause)
 		ms_cond.wait(lock);
 	    }
-	    
+
+            HT_DEBUGF("Running maintenance task %s (priority %.3f)",
+                      task->name(), task->priority);
             task->execute();
           }
           catch(Hypertable::Exception &e) {
             HT_ERRORF("%s (%s)", Error::get_text(e.code()), e.what());
           }
 
+          {
+            boost::mutex::scoped_lock lock(m_state.mutex);
+            acquire(task->resources, -1);
+            // freed resources may unblock a task another worker passed over
+            m_state.cond.notify_all();
+          }
+
           delete task;
         }
       }
 
     private:
+
+      /**
+       * Moves tasks whose start time has passed to the ready set and takes
+       * the highest priority one that fits under the resource limits.
+       * Must be called with the state mutex held.
+       */
+      MaintenanceTask *next_task() {
+        boost::xtime now;
+        MaintenanceTask *task;
+
+        boost::xtime_get(&now, boost::TIME_UTC);
+        while (!m_state.queue.empty() &&
+               xtime_cmp((m_state.queue.top())->start_time, now) <= 0) {
+          m_state.ready.insert(m_state.queue.top());
+          m_state.queue.pop();
+        }
+
+        for (ReadySet::iterator iter = m_state.ready.begin();
+             iter != m_state.ready.end(); ++iter) {
+          task = *iter;
+          if ((task->resources & MaintenanceTask::RESOURCE_IO) &&
+              m_state.io_active >= m_state.io_limit)
+            continue;
+          if ((task->resources & MaintenanceTask::RESOURCE_CPU) &&
+              m_state.cpu_active >= m_state.cpu_limit)
+            continue;
+          m_state.ready.erase(iter);
+          return task;
+        }
+        return 0;
+      }
+
+      void acquire(int resources, int count) {
+        if (resources & MaintenanceTask::RESOURCE_IO)
+          m_state.io_active += count;
+        if (resources & MaintenanceTask::RESOURCE_CPU)
+          m_state.cpu_active += count;
+      }
+
       MaintenanceQueueState &m_state;
     };
 
@@ -126,25 +193,32 @@ namespace Hypertable {
   public:
 
     /**
-     * Constructor to set up the application queue.  It creates a number
+     * Constructor to set up the maintenance queue.  It creates a number
      * of worker threads specified by the worker_count argument.
      *
      * @param worker_count number of worker threads to create
+     * @param io_limit maximum number of running tasks that write cell
+     *        stores, or 0 for worker_count
+     * @param cpu_limit maximum number of running tasks that merge cell
+     *        stores, or 0 for worker_count
      */
-    MaintenanceQueue(int worker_count) : joined(false) {
+    MaintenanceQueue(int worker_count, int io_limit=0, int cpu_limit=0) : joined(false) {
       Worker Worker(m_state);
       assert (worker_count > 0);
+      m_state.io_limit = (io_limit > 0) ? io_limit : worker_count;
+      m_state.cpu_limit = (cpu_limit > 0) ? cpu_limit : worker_count;
       for (int i=0; i<worker_count; ++i)
         m_threads.create_thread(Worker);
       //threads
     }
 
     /**
-     * Shuts down the application queue.  All outstanding requests are carried
-     * out and then all threads exit.  #join can be called to wait for completion
+     * Shuts down the maintenance queue.  Runnable tasks are carried out and
+     * then all threads exit.  #join can be called to wait for completion
      * of the shutdown.
      */
     void shutdown() {
+      boost::mutex::scoped_lock lock(m_state.mutex);
       m_state.shutdown = true;
       m_state.cond.notify_all();
     }
@@ -176,10 +250,10 @@ namespace Hypertable {
     }
 
     /**
-     * Adds a request (application handler) to the request queue.  The request queue
-     * is designed to support the serialization of related requests.  Requests are
-     * related by the thread group ID value in the ApplicationHandler.  This thread
-     * group ID is constructed in the Event object
+     * Adds a task to the queue.  It runs once its start time has passed,
+     * ahead of any ready task with a lower priority.
+     *
+     * @param task task to add, the queue takes ownership of it
      */
     void add(MaintenanceTask *task) {
       boost::mutex::scoped_lock lock(m_state.mutex);
@@ -26,15 +26,37 @@
 
 namespace Hypertable {
 
+  /**
+   * Base class for work run by the MaintenanceQueue.  Once its start time
+   * has passed, a task competes with the other ready tasks on its priority,
+   * which measures how urgent it is (higher runs first).  The resources
+   * mask says which of the queue's concurrency limits the task counts
+   * against while it runs.
+   */
   class MaintenanceTask {
   public:
-    MaintenanceTask(boost::xtime start_time_) : start_time(start_time_), m_retry(false) { return; }
-    MaintenanceTask(boost::xtime start_time_, time_t retry_delay_seconds) : start_time(start_time_), m_retry(true), m_retry_delay_seconds(retry_delay_seconds) { return; }
-    MaintenanceTask() : m_retry(false) { boost::xtime_get(&start_time, boost::TIME_UTC); return; }
-    MaintenanceTask(time_t retry_delay_seconds) : m_retry(true), m_retry_delay_seconds(retry_delay_seconds) { boost::xtime_get(&start_time, boost::TIME_UTC); return; }
+    enum {
+      RESOURCE_IO  = 0x01,  // writes cell stores
+      RESOURCE_CPU = 0x02   // decompresses and merges existing cell stores
+    };
+
+    /**
+     * Compaction priorities are sums of a few ratios and rarely get much
+     * above 3, so these place splits and log cleanup ahead of them.
+     */
+    static const double SPLIT_PRIORITY;
+    static const double LOG_CLEANUP_PRIORITY;
+
+    MaintenanceTask(boost::xtime start_time_) : start_time(start_time_), priority(0.0), resources(RESOURCE_IO), m_retry(false) { return; }
+    MaintenanceTask(boost::xtime start_time_, time_t retry_delay_seconds) : start_time(start_time_), priority(0.0), resources(RESOURCE_IO), m_retry(true), m_retry_delay_seconds(retry_delay_seconds) { return; }
+    MaintenanceTask() : priority(0.0), resources(RESOURCE_IO), m_retry(false) { boost::xtime_get(&start_time, boost::TIME_UTC); return; }
+    MaintenanceTask(time_t retry_delay_seconds) : priority(0.0), resources(RESOURCE_IO), m_retry(true), m_retry_delay_seconds(retry_delay_seconds) { boost::xtime_get(&start_time, boost::TIME_UTC); return; }
     virtual ~MaintenanceTask() { return; }
     virtual void execute() = 0;
+    virtual const char *name() = 0;
     boost::xtime start_time;
+    double       priority;
+    int          resources;
   private:
     bool m_retry;
     time_t m_retry_delay_seconds;
@@ -20,14 +20,52 @@
  */
 
 #include "Common/Compat.h"
+#include <vector>
+
+#include "Global.h"
 #include "MaintenanceTaskCompaction.h"
 
 using namespace Hypertable;
 
 /**
+ * The priority adds up, over the access groups that will be compacted,
+ * the cell cache memory freed in units of the access group memory limit,
+ * the commit log space unpinned in units of the maximum prune threshold,
+ * and the read amplification of the group with the most cell stores in
+ * units of the maximum file count.  Major compactions, and compactions
+ * where an access group's compaction policy will merge stores, also count
+ * against the CPU limit.
  *
+ * @param range_ptr range to compact
+ * @param major true for a major compaction
+ * @param log_space_pinned commit log bytes that compacting frees for pruning
  */
-MaintenanceTaskCompaction::MaintenanceTaskCompaction(RangePtr &range_ptr, bool major) : MaintenanceTask(), m_range_ptr(range_ptr), m_major(major) {
+MaintenanceTaskCompaction::MaintenanceTaskCompaction(RangePtr &range_ptr, bool major, uint64_t log_space_pinned) : MaintenanceTask(), m_range_ptr(range_ptr), m_major(major) {
+  std::vector<AccessGroup::CompactionPriorityData> priority_data_vec;
+  uint64_t mem_used = 0;
+  uint32_t max_stores = 0;
+  bool merging = false;
+
+  range_ptr->get_compaction_priority_data(priority_data_vec);
+  for (size_t i=0; i<priority_data_vec.size(); i++) {
+    if (major || priority_data_vec[i].ag->needs_compaction()) {
+      mem_used += priority_data_vec[i].mem_used;
+      if (priority_data_vec[i].store_count > max_stores)
+        max_stores = priority_data_vec[i].store_count;
+      if (priority_data_vec[i].merge_count > 0)
+        merging = true;
+    }
+  }
+
+  if (Global::access_group_max_mem > 0)
+    priority += (double)mem_used / (double)Global::access_group_max_mem;
+  if (Global::log_prune_threshold_max > 0)
+    priority += (double)log_space_pinned / (double)Global::log_prune_threshold_max;
+  if (Global::access_group_max_files > 0)
+    priority += (double)max_stores / (double)Global::access_group_max_files;
+
+  if (major || merging)
+    resources |= RESOURCE_CPU;
 }
 
 
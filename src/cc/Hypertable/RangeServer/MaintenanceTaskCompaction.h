@@ -29,8 +29,9 @@ namespace Hypertable {
 
   class MaintenanceTaskCompaction : public MaintenanceTask {
   public:
-    MaintenanceTaskCompaction(RangePtr &range_ptr, bool major);
+    MaintenanceTaskCompaction(RangePtr &range_ptr, bool major, uint64_t log_space_pinned=0);
     virtual void execute();
+    virtual const char *name() { return "compaction"; }
   private:
     RangePtr m_range_ptr;
     bool     m_major;
@@ -27,9 +27,12 @@ using namespace Hypertable;
 
 
 /**
- *
+ * Log cleanup only decides which compactions to schedule, so it goes ahead
+ * of everything else and uses none of the limited resources.
  */
 MaintenanceTaskLogCleanup::MaintenanceTaskLogCleanup(RangeServer *range_server) : MaintenanceTask(), m_range_server(range_server) {
+  priority = LOG_CLEANUP_PRIORITY;
+  resources = 0;
 }
 
 
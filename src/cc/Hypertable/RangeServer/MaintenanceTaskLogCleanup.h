@@ -33,6 +33,7 @@ namespace Hypertable {
   public:
     MaintenanceTaskLogCleanup(RangeServer *range_server);
     virtual void execute();
+    virtual const char *name() { return "log cleanup"; }
   private:
     RangeServer *m_range_server;
   };
@@ -20,15 +20,34 @@
  */
 
 #include "Common/Compat.h"
+#include <vector>
+
 #include "MaintenanceTaskSplit.h"
 
 using namespace Hypertable;
 
 
 /**
- *
+ * Splits rank ahead of compactions since an oversized range keeps growing
+ * until it is split.  Among themselves, the further a range is over its
+ * size limit the sooner it is split.  A split rewrites every access group
+ * with a major compaction, so it counts against both limits.
  */
-MaintenanceTaskSplit::MaintenanceTaskSplit(RangePtr &range_ptr) : MaintenanceTask(), m_range_ptr(range_ptr) {
+MaintenanceTaskSplit::MaintenanceTaskSplit(RangePtr &range_ptr, bool by_load) : MaintenanceTask(), m_range_ptr(range_ptr), m_by_load(by_load) {
+  std::vector<AccessGroup::CompactionPriorityData> priority_data_vec;
+  uint64_t disk_used = 0;
+  uint64_t size_limit = range_ptr->get_size_limit();
+
+  range_ptr->get_compaction_priority_data(priority_data_vec);
+  for (size_t i=0; i<priority_data_vec.size(); i++)
+    disk_used += priority_data_vec[i].disk_used;
+
+  priority = SPLIT_PRIORITY;
+  if (by_load)
+    priority += 1.0;
+  else if (size_limit > 0)
+    priority += (double)disk_used / (double)size_limit;
+  resources = RESOURCE_IO | RESOURCE_CPU;
 }
 
 
@@ -37,5 +56,5 @@ MaintenanceTaskSplit::MaintenanceTaskSplit(RangePtr &range_ptr) : MaintenanceTas
  *
  */
 void MaintenanceTaskSplit::execute() {
-  m_range_ptr->split();
+  m_range_ptr->split(m_by_load);
 }
@@ -29,10 +29,12 @@ namespace Hypertable {
 
   class MaintenanceTaskSplit : public MaintenanceTask {
   public:
-    MaintenanceTaskSplit(RangePtr &range_ptr);
+    MaintenanceTaskSplit(RangePtr &range_ptr, bool by_load=false);
     virtual void execute();
+    virtual const char *name() { return "split"; }
   private:
     RangePtr m_range_ptr;
+    bool m_by_load;
   };
 
 }
@@ -22,10 +22,17 @@
 #ifndef HYPERTABLE_MEMORYTRACKER_H
 #define HYPERTABLE_MEMORYTRACKER_H
 
+#include <boost/thread/condition.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/xtime.hpp>
 
 namespace Hypertable {
 
+  /**
+   * Tracks the memory and number of cells held in the cell caches of all
+   * ranges on this server.  Threads that want to wait for memory to be
+   * released (e.g. throttled updates) can block in wait_for_memory().
+   */
   class MemoryTracker {
   public:
     MemoryTracker() : m_memory_used(0), m_item_count(0) { return; }
@@ -38,6 +45,7 @@ namespace Hypertable {
     void remove_memory(uint64_t amount) {
       boost::mutex::scoped_lock lock(m_mutex);
       m_memory_used -= amount;
+      m_cond.notify_all();
     }
 
     uint64_t get_memory() {
@@ -60,8 +68,25 @@ namespace Hypertable {
       return m_item_count;
     }
 
+    /**
+     * Waits until memory usage drops to or below the given level.
+     *
+     * @param limit memory level to wait for
+     * @param deadline absolute time at which to give up
+     * @return true if memory usage is at or below limit
+     */
+    bool wait_for_memory(uint64_t limit, const boost::xtime &deadline) {
+      boost::mutex::scoped_lock lock(m_mutex);
+      while (m_memory_used > limit) {
+        if (!m_cond.timed_wait(lock, deadline))
+          return m_memory_used <= limit;
+      }
+      return true;
+    }
+
   private:
     boost::mutex m_mutex;
+    boost::condition m_cond;
     uint64_t m_memory_used;
     uint64_t m_item_count;
   };
@@ -20,12 +20,11 @@
  */
 
 #include "Common/Compat.h"
+#include <algorithm>
 #include <cassert>
 
 #include "Common/Logger.h"
 
-#include "Hypertable/Lib/Key.h"
-
 #include "MergeScanner.h"
 
 using namespace Hypertable;
@@ -33,9 +32,15 @@ using namespace Hypertable;
 /**
  *
  */
-MergeScanner::MergeScanner(ScanContextPtr &scan_ctx, bool return_everything) : CellListScanner(scan_ctx), m_done(false), m_initialized(false), m_scanners(), m_queue(), m_delete_present(false), m_deleted_row(0), m_deleted_column_family(0), m_deleted_cell(0), m_return_everything(return_everything), m_row_count(0), m_row_limit(0), m_cell_count(0), m_cell_limit(0), m_cell_cutoff(0), m_prev_key(0) {
+MergeScanner::MergeScanner(ScanContextPtr &scan_ctx, bool return_everything) : CellListScanner(scan_ctx), m_done(false), m_initialized(false), m_scanners(), m_states(), m_tree(), m_delete_present(false), m_deleted_row(0), m_deleted_column_family(0), m_deleted_cell(0), m_return_everything(return_everything), m_row_count(0), m_row_limit(0), m_cell_count(0), m_cell_limit(0), m_cell_cutoff(0), m_prev_key(0), m_filter(0), m_filter_row_count(0), m_filter_row_limit(0), m_filter_row(0) {
   if (scan_ctx->spec != 0)
     m_row_limit = scan_ctx->spec->row_limit;
+  if (!m_return_everything && scan_ctx->predicate_filter) {
+    // rows that are filtered out entirely don't count against the limit
+    m_filter = scan_ctx->predicate_filter;
+    m_filter_row_limit = m_row_limit;
+    m_row_limit = 0;
+  }
   m_start_timestamp = scan_ctx->interval.first;
   m_end_timestamp = scan_ctx->interval.second;
 }
@@ -58,34 +63,37 @@ MergeScanner::~MergeScanner() {
 
 
 void MergeScanner::forward() {
-  ScannerState sstate;
-  Key key;
+  advance();
+  if (m_filter)
+    apply_filter();
+}
+
+
+
+void MergeScanner::advance() {
+  ScannerState *sstate;
+  Key &key = m_key;
   size_t len;
 
-  if (m_queue.empty())
+  if (empty())
     return;
 
-  sstate = m_queue.top();
-
   /**
-   * Pop the top element, forward it, re-insert it back into the queue;
+   * Forward the winning scanner and replay its path up the tree
    */
 
   while (true) {
 
     while (true) {
 
-      m_queue.pop();
-      sstate.scanner->forward();
-      if (sstate.scanner->get(sstate.key, sstate.value))
-        m_queue.push(sstate);
+      forward_top();
 
-      if (m_queue.empty())
+      if (empty())
         return;
 
-      sstate = m_queue.top();
+      sstate = &top();
 
-      if (!key.load(sstate.key)) {
+      if (!key.load(sstate->key)) {
         HT_ERROR("Problem decoding key!");
       }
       else if (key.timestamp < m_start_timestamp && !m_return_everything) {
@@ -180,7 +188,7 @@ void MergeScanner::forward() {
     }
 
     const uint8_t *prev_key;
-    size_t prev_key_len = sstate.key.decode_length(&prev_key);
+    size_t prev_key_len = sstate->key.decode_length(&prev_key);
 
     if (m_prev_key.fill() != 0) {
 
@@ -235,8 +243,8 @@ bool MergeScanner::get(ByteString &key, ByteString &value) {
   if (!m_initialized)
     initialize();
 
-  if (!m_queue.empty() && !m_done) {
-    const ScannerState &sstate = m_queue.top();
+  if (!empty() && !m_done) {
+    const ScannerState &sstate = top();
     // check for row or cell limit
     key = sstate.key;
     value = sstate.value;
@@ -248,27 +256,43 @@ bool MergeScanner::get(ByteString &key, ByteString &value) {
 
 
 void MergeScanner::initialize() {
-  ScannerState sstate;
-  while (!m_queue.empty())
-    m_queue.pop();
-  for (size_t i=0; i<m_scanners.size(); i++) {
-    if (m_scanners[i]->get(sstate.key, sstate.value)) {
-      sstate.scanner = m_scanners[i];
-      m_queue.push(sstate);
+  size_t count = m_scanners.size();
+  Key &key = m_key;
+
+  m_states.resize(count);
+  for (size_t i=0; i<count; i++) {
+    m_states[i].scanner = m_scanners[i];
+    load_state(m_states[i]);
+  }
+
+  /**
+   * Build the loser tree bottom up.  Leaf i is node count+i and internal
+   * node n has children 2n and 2n+1; winners[n] is the winner of the
+   * subtree under n, m_tree[n] the loser at n and m_tree[0] the winner.
+   */
+  m_tree.resize(count);
+  if (count > 0) {
+    std::vector<uint32_t> winners(2*count);
+    for (size_t i=0; i<count; i++)
+      winners[count+i] = i;
+    for (size_t n=count-1; n>0; n--) {
+      uint32_t s1 = winners[2*n], s2 = winners[2*n+1];
+      if (less(s2, s1))
+        std::swap(s1, s2);
+      winners[n] = s1;
+      m_tree[n] = s2;
     }
+    m_tree[0] = (count == 1) ? 0 : winners[1];
   }
-  while (!m_queue.empty()) {
-    sstate = m_queue.top();
-    Key key;
+
+  while (!empty()) {
+    ScannerState &sstate = top();
     if (!key.load(sstate.key)) {
       assert(!"MergeScanner::initialize() - Problem decoding key!");
     }
 
     if (key.timestamp < m_start_timestamp && !m_return_everything) {
-      m_queue.pop();
-      sstate.scanner->forward();
-      if (sstate.scanner->get(sstate.key, sstate.value))
-        m_queue.push(sstate);
+      forward_top();
       continue;
     }
 
@@ -281,7 +305,7 @@ void MergeScanner::initialize() {
       m_deleted_row_timestamp = key.timestamp;
       m_delete_present = true;
       if (!m_return_everything)
-        forward();
+        advance();
     }
     else if (key.flag == FLAG_DELETE_COLUMN_FAMILY) {
       size_t len = key.column_qualifier - key.row;
@@ -292,7 +316,7 @@ void MergeScanner::initialize() {
       m_deleted_column_family_timestamp = key.timestamp;
       m_delete_present = true;
       if (!m_return_everything)
-        forward();
+        advance();
     }
     else if (key.flag == FLAG_DELETE_CELL) {
       size_t len = (key.column_qualifier - key.row) + strlen(key.column_qualifier) + 1;
@@ -303,14 +327,11 @@ void MergeScanner::initialize() {
       m_deleted_cell_timestamp = key.timestamp;
       m_delete_present = true;
       if (!m_return_everything)
-        forward();
+        advance();
     }
     else {
       if (key.timestamp >= m_end_timestamp && !m_return_everything) {
-        m_queue.pop();
-        sstate.scanner->forward();
-        if (sstate.scanner->get(sstate.key, sstate.value))
-          m_queue.push(sstate);
+        forward_top();
         continue;
       }
       m_delete_present = false;
@@ -324,6 +345,102 @@ void MergeScanner::initialize() {
     break;
   }
 
+  if (m_filter)
+    apply_filter();
+
   m_initialized = true;
 }
 
+
+
+/**
+ * Skips forward until the current cell satisfies the scan predicates.
+ * Row limit accounting happens here when a filter is present, so that
+ * only rows with at least one matching cell are counted.
+ */
+void MergeScanner::apply_filter() {
+  const Key &key = m_key;
+
+  while (!m_done && !empty()) {
+    const ScannerState &sstate = top();
+    if (m_filter->matches(key, sstate.value)) {
+      if (m_filter_row_limit &&
+          (m_filter_row.fill() == 0 || strcmp(key.row, (const char *)m_filter_row.base))) {
+        if (m_filter_row_count >= m_filter_row_limit) {
+          m_done = true;
+          return;
+        }
+        m_filter_row_count++;
+        m_filter_row.set(key.row, strlen(key.row) + 1);
+      }
+      return;
+    }
+    advance();
+  }
+}
+
+
+
+
+/**
+ * Fetches the scanner's current cell and caches the key's length and
+ * its first eight bytes as a big-endian integer
+ */
+void MergeScanner::load_state(ScannerState &sstate) {
+  if (!sstate.scanner->get(sstate.key, sstate.value)) {
+    sstate.exhausted = true;
+    return;
+  }
+  sstate.exhausted = false;
+  sstate.len = sstate.key.decode_length(&sstate.data);
+  sstate.prefix = 0;
+  for (size_t i=0; i<8; i++) {
+    sstate.prefix <<= 8;
+    if (i < sstate.len)
+      sstate.prefix |= sstate.data[i];
+  }
+}
+
+
+/**
+ * Orders sources by key, exhausted sources last and ties by index.  Keys
+ * shorter than eight bytes are zero padded in the prefix, so equal
+ * prefixes still need the full comparison.
+ */
+bool MergeScanner::less(uint32_t s1, uint32_t s2) {
+  const ScannerState &ss1 = m_states[s1];
+  const ScannerState &ss2 = m_states[s2];
+
+  if (ss1.exhausted || ss2.exhausted)
+    return ss1.exhausted == ss2.exhausted ? s1 < s2 : ss2.exhausted;
+
+  if (ss1.prefix != ss2.prefix)
+    return ss1.prefix < ss2.prefix;
+
+  uint32_t len = (ss1.len < ss2.len) ? ss1.len : ss2.len;
+  int cmp = memcmp(ss1.data, ss2.data, len);
+  if (cmp != 0)
+    return cmp < 0;
+  if (ss1.len != ss2.len)
+    return ss1.len < ss2.len;
+  return s1 < s2;
+}
+
+
+/**
+ * Moves the winning source to its next cell and replays the matches on
+ * its path to the root
+ */
+void MergeScanner::forward_top() {
+  uint32_t winner = m_tree[0];
+  size_t count = m_states.size();
+
+  m_states[winner].scanner->forward();
+  load_state(m_states[winner]);
+
+  for (size_t n=(count+winner)/2; n>0; n/=2) {
+    if (less(m_tree[n], winner))
+      std::swap(m_tree[n], winner);
+  }
+  m_tree[0] = winner;
+}
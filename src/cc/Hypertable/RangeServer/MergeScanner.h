@@ -22,19 +22,31 @@
 #ifndef HYPERTABLE_MERGESCANNER_H
 #define HYPERTABLE_MERGESCANNER_H
 
-#include <queue>
 #include <string>
 #include <vector>
 
 #include "Common/ByteString.h"
 #include "Common/DynamicBuffer.h"
 
+#include "Hypertable/Lib/Key.h"
+
 #include "CellListScanner.h"
+#include "CellPredicateFilter.h"
 #include "CellStoreReleaseCallback.h"
 
 
 namespace Hypertable {
 
+  /**
+   * Merges the cells of several scanners in key order, applying deletes,
+   * version limits, the timestamp interval and the row limit on the way.
+   *
+   * The sources are merged with a loser tree: each internal node holds the
+   * source that lost the comparison there, so moving the winner forward
+   * takes one comparison per level on the path back to the root.  Each
+   * source caches the first eight bytes of its current key as an integer,
+   * so most comparisons don't need to touch the keys themselves.
+   */
   class MergeScanner : public CellListScanner {
   public:
 
@@ -42,12 +54,10 @@ namespace Hypertable {
       CellListScanner *scanner;
       ByteString key;
       ByteString value;
-    };
-
-    struct LtScannerState {
-      bool operator()(const ScannerState &ss1, const ScannerState &ss2) const {
-        return !(ss1.key < ss2.key);
-      }
+      const uint8_t *data;
+      uint32_t len;
+      uint64_t prefix;
+      bool exhausted;
     };
 
     MergeScanner(ScanContextPtr &scan_ctx, bool return_everything=true);
@@ -63,11 +73,22 @@ namespace Hypertable {
   private:
 
     void initialize();
+    void advance();
+    void apply_filter();
+
+    void load_state(ScannerState &sstate);
+    bool less(uint32_t s1, uint32_t s2);
+    void forward_top();
+
+    bool empty() { return m_states.empty() || m_states[m_tree[0]].exhausted; }
+    ScannerState &top() { return m_states[m_tree[0]]; }
 
     bool          m_done;
     bool          m_initialized;
     std::vector<CellListScanner *>  m_scanners;
-    std::priority_queue<ScannerState, std::vector<ScannerState>, LtScannerState> m_queue;
+    std::vector<ScannerState>       m_states;
+    std::vector<uint32_t>           m_tree;
+    Key           m_key;
     bool          m_delete_present;
     DynamicBuffer m_deleted_row;
     int64_t       m_deleted_row_timestamp;
@@ -84,6 +105,10 @@ namespace Hypertable {
     int64_t       m_start_timestamp;
     int64_t       m_end_timestamp;
     DynamicBuffer m_prev_key;
+    CellPredicateFilter *m_filter;
+    int32_t       m_filter_row_count;
+    int32_t       m_filter_row_limit;
+    DynamicBuffer m_filter_row;
     CellStoreReleaseCallback m_release_callback;
   };
 }
@@ -55,6 +55,7 @@ Range::Range(MasterClientPtr &master_client_ptr, const TableIdentifier *identifi
              SchemaPtr &schema_ptr, const RangeSpec *range, const RangeState *state)
     : m_master_client_ptr(master_client_ptr), m_identifier(*identifier),
       m_schema(schema_ptr), m_maintenance_in_progress(false),
+      m_relinquished(false),
       m_last_logical_timestamp(0), m_added_inserts(0), m_state(*state),
       m_error(Error::OK) {
   AccessGroup *ag;
@@ -250,6 +251,8 @@ int Range::add(const ByteString key, const ByteString value, int64_t real_timest
   else
     m_added_deletes[key_comps.flag]++;
 
+  m_load_tracker.record_update(key_comps.row);
+
   return Error::OK;
 }
 
@@ -296,6 +299,7 @@ CellListScanner *Range::create_scanner(ScanContextPtr &scan_ctx) {
     if ((*iter).second->include_in_scan(scan_ctx))
       mscanner->add_scanner((*iter).second->create_scanner(scan_ctx));
   }
+  m_load_tracker.record_read(scan_ctx->start_row);
   return mscanner;
 }
 
@@ -324,7 +328,18 @@ void Range::get_compaction_priority_data(std::vector<AccessGroup::CompactionPrio
 }
 
 
-void Range::split() {
+void Range::purge_store_indexes(time_t expire_time) {
+  for (size_t i=0; i<m_access_group_vector.size(); i++)
+    m_access_group_vector[i]->purge_store_indexes(expire_time);
+}
+
+
+/**
+ * If by_load is set, the range is split at the median of the rows recently
+ * updated or scanned instead of the middle of its data, so that a small
+ * range with a hot spot is split through the hot spot.
+ */
+void Range::split(bool by_load) {
   String old_start_row;
 
   HT_EXPECT(m_maintenance_in_progress, Error::FAILED_EXPECTATION);
@@ -335,7 +350,7 @@ void Range::split() {
     switch (m_state.state) {
 
     case (RangeState::STEADY):
-      split_install_log();
+      split_install_log(by_load);
 
     case (RangeState::SPLIT_LOG_INSTALLED):
       split_compact_and_shrink();
@@ -353,6 +368,8 @@ void Range::split() {
 
   HT_INFOF("Split Complete.  New Range end_row=%s", m_start_row.c_str());
 
+  m_load_tracker.reset();
+
   m_maintenance_in_progress = false;
 }
 
@@ -360,22 +377,29 @@ void Range::split() {
 
 /**
  */
-void Range::split_install_log() {
+void Range::split_install_log(bool by_load) {
   std::vector<String> split_rows;
+  String load_split_row;
   char md5DigestStr[33];
 
-  for (size_t i=0; i<m_access_group_vector.size(); i++)
-    m_access_group_vector[i]->get_split_rows(split_rows, false);
-
-  /**
-   * If we didn't get at least one row from each Access Group, then try again
-   * the hard way (scans CellCache for middle row)
-   */
-  if (split_rows.size() < m_access_group_vector.size()) {
+  if (by_load && m_load_tracker.get_split_row(start_row(), m_end_row, load_split_row)) {
+    HT_INFOF("Splitting hot range %s at load median '%s'", get_name().c_str(), load_split_row.c_str());
+    split_rows.push_back(load_split_row);
+  }
+  else {
     for (size_t i=0; i<m_access_group_vector.size(); i++)
-      m_access_group_vector[i]->get_split_rows(split_rows, true);
+      m_access_group_vector[i]->get_split_rows(split_rows, false);
+
+    /**
+     * If we didn't get at least one row from each Access Group, then try again
+     * the hard way (scans CellCache for middle row)
+     */
+    if (split_rows.size() < m_access_group_vector.size()) {
+      for (size_t i=0; i<m_access_group_vector.size(); i++)
+        m_access_group_vector[i]->get_split_rows(split_rows, true);
+    }
+    sort(split_rows.begin(), split_rows.end());
   }
-  sort(split_rows.begin(), split_rows.end());
 
   /**
   cout << flush;
@@ -668,6 +692,25 @@ void Range::compact(bool major) {
 }
 
 
+/**
+ * Takes the range out of service so that another server can load it.
+ * Updates that arrive after this point are turned away (see
+ * is_relinquished) and the cell caches are flushed to cell stores, so the
+ * new owner sees every update this server acknowledged.  The caller is
+ * expected to have removed the range from the live map and to have set the
+ * maintenance bit.
+ */
+void Range::relinquish() {
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_relinquished = true;
+  }
+  for (size_t i=0; i<m_access_group_vector.size(); i++)
+    m_access_group_vector[i]->set_compaction_bit();
+  compact(false);
+}
+
+
 void Range::run_compaction(bool major) {
   Timestamp timestamp;
 
@@ -701,6 +744,17 @@ void Range::dump_stats() {
   cout << "STAT\t" << range_str << "\tadded total\t" << (m_added_inserts + m_added_deletes[0] + m_added_deletes[1] + m_added_deletes[2]) << endl;
   cout << "STAT\t" << range_str << "\tcollisions\t" << collisions << endl;
   cout << "STAT\t" << range_str << "\tcached\t" << cached << endl;
+  for (size_t i=0; i<m_access_group_vector.size(); i++) {
+    AccessGroup *ag = m_access_group_vector[i];
+    std::string ag_str = range_str + "(" + ag->get_name() + ")";
+    cout << "STAT\t" << ag_str << "\tcompaction policy\t" << ag->get_compaction_policy_name() << endl;
+    cout << "STAT\t" << ag_str << "\twrite amplification\t" << ag->get_write_amplification() << endl;
+    cout << "STAT\t" << ag_str << "\tread amplification\t" << ag->get_read_amplification() << endl;
+  }
+  double update_rate, read_rate;
+  m_load_tracker.get_rates(&update_rate, &read_rate);
+  cout << "STAT\t" << range_str << "\tupdate rate\t" << update_rate << endl;
+  cout << "STAT\t" << range_str << "\tread rate\t" << read_rate << endl;
   cout << flush;
 }
 
@@ -40,6 +40,7 @@
 #include "CellStore.h"
 #include "MaintenanceTask.h"
 #include "Metadata.h"
+#include "RangeLoadTracker.h"
 #include "RangeUpdateBarrier.h"
 
 namespace Hypertable {
@@ -94,6 +95,8 @@ namespace Hypertable {
 
     void get_compaction_priority_data(std::vector<AccessGroup::CompactionPriorityData> &priority_data_vector);
 
+    void purge_store_indexes(time_t expire_time);
+
 
     bool test_and_set_maintenance() {
       boost::mutex::scoped_lock lock(m_mutex);
@@ -106,9 +109,16 @@ namespace Hypertable {
       return m_maintenance_in_progress;
     }
 
-    void split();
+    void split(bool by_load=false);
     void compact(bool major=false);
 
+    void relinquish();
+
+    bool is_relinquished() {
+      boost::mutex::scoped_lock lock(m_mutex);
+      return m_relinquished;
+    }
+
     void increment_update_counter() {
       m_update_barrier.enter();
     }
@@ -136,6 +146,13 @@ namespace Hypertable {
 
     uint64_t get_size_limit() { return m_state.soft_limit; }
 
+    /**
+     * Gets the decayed update rate (cells/s) and read rate (scans/s)
+     */
+    void get_load_rates(double *update_rate, double *read_rate) {
+      m_load_tracker.get_rates(update_rate, read_rate);
+    }
+
     bool is_root() { return m_is_root; }
 
     void drop() {
@@ -159,7 +176,7 @@ namespace Hypertable {
 
     void run_compaction(bool major=false);
 
-    void split_install_log();
+    void split_install_log(bool by_load);
     void split_compact_and_shrink();
     void split_notify_master();
 
@@ -174,6 +191,7 @@ namespace Hypertable {
     std::vector<AccessGroup *>  m_access_group_vector;
     ColumnFamilyVector      m_column_family_vector;
     bool       m_maintenance_in_progress;
+    bool       m_relinquished;
 
     Timestamp        m_timestamp;
     int64_t          m_last_logical_timestamp;
@@ -186,6 +204,7 @@ namespace Hypertable {
     uint64_t         m_added_inserts;
     RangeStateManaged m_state;
     int32_t          m_error;
+    RangeLoadTracker m_load_tracker;
   };
 
   typedef boost::intrusive_ptr<Range> RangePtr;
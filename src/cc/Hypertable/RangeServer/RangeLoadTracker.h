@@ -0,0 +1,150 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_RANGELOADTRACKER_H
+#define HYPERTABLE_RANGELOADTRACKER_H
+
+#include <algorithm>
+#include <ctime>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "Common/String.h"
+
+namespace Hypertable {
+
+  /**
+   * Tracks the update and read rate of a range and keeps a sample of the
+   * rows recently accessed, so that a range that is hot but small can be
+   * split where the accesses are rather than in the middle of its data.
+   *
+   * Rates are measured over WINDOW_SECONDS windows and averaged with the
+   * previous window's rate.  One in SAMPLE_INTERVAL updated cells and
+   * every scan puts its row into a ring of SAMPLE_SLOTS rows, so a scan
+   * weighs about as much as SAMPLE_INTERVAL cell updates.
+   */
+  class RangeLoadTracker {
+  public:
+    enum { SAMPLE_INTERVAL = 16, SAMPLE_SLOTS = 256, MIN_SAMPLES = 32,
+           WINDOW_SECONDS = 10 };
+
+    RangeLoadTracker() { reset(); }
+
+    /**
+     * Counts an updated cell.  Must be called with the range locked for
+     * updates, since only every SAMPLE_INTERVAL-th call takes the mutex.
+     */
+    void record_update(const char *row) {
+      if (++m_pending_updates < SAMPLE_INTERVAL)
+        return;
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_updates += m_pending_updates;
+      m_pending_updates = 0;
+      add_sample(row);
+    }
+
+    void record_read(const String &row) {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_reads++;
+      add_sample(row);
+    }
+
+    /**
+     * Gets the update rate in cells per second and the read rate in scans
+     * per second
+     */
+    void get_rates(double *update_rate, double *read_rate) {
+      boost::mutex::scoped_lock lock(m_mutex);
+      time_t now = time(0);
+      time_t elapsed = now - m_window_start;
+      if (elapsed >= WINDOW_SECONDS) {
+        m_update_rate = (m_update_rate + (double)m_updates / elapsed) / 2.0;
+        m_read_rate = (m_read_rate + (double)m_reads / elapsed) / 2.0;
+        m_updates = m_reads = 0;
+        m_window_start = now;
+      }
+      *update_rate = m_update_rate;
+      *read_rate = m_read_rate;
+    }
+
+    /**
+     * Picks the median of the sampled rows that fall inside the range.
+     *
+     * @param start_row start row of the range (exclusive)
+     * @param end_row end row of the range (inclusive)
+     * @param split_row filled in with the split row
+     * @return false if there are too few samples strictly inside the range
+     */
+    bool get_split_row(const String &start_row, const String &end_row,
+                       String &split_row) {
+      std::vector<String> rows;
+      {
+        boost::mutex::scoped_lock lock(m_mutex);
+        for (size_t i=0; i<m_samples.size(); i++) {
+          if (m_samples[i] > start_row && m_samples[i] < end_row)
+            rows.push_back(m_samples[i]);
+        }
+      }
+      if (rows.size() < MIN_SAMPLES)
+        return false;
+      std::nth_element(rows.begin(), rows.begin() + rows.size()/2, rows.end());
+      split_row = rows[rows.size()/2];
+      return true;
+    }
+
+    /**
+     * Forgets all samples and rates, e.g. after the range was split
+     */
+    void reset() {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_pending_updates = 0;
+      m_updates = m_reads = 0;
+      m_update_rate = m_read_rate = 0.0;
+      m_window_start = time(0);
+      m_samples.clear();
+      m_next_slot = 0;
+    }
+
+  private:
+
+    void add_sample(const String &row) {
+      if (m_samples.size() < SAMPLE_SLOTS)
+        m_samples.push_back(row);
+      else
+        m_samples[m_next_slot] = row;
+      m_next_slot = (m_next_slot + 1) % SAMPLE_SLOTS;
+    }
+
+    boost::mutex        m_mutex;
+    uint32_t            m_pending_updates;
+    uint64_t            m_updates;
+    uint64_t            m_reads;
+    double              m_update_rate;
+    double              m_read_rate;
+    time_t              m_window_start;
+    std::vector<String> m_samples;
+    size_t              m_next_slot;
+  };
+
+}
+
+#endif // HYPERTABLE_RANGELOADTRACKER_H
@@ -20,6 +20,7 @@
  */
 
 #include "Common/Compat.h"
+#include <algorithm>
 #include <cassert>
 #include <string>
 
@@ -42,6 +43,7 @@ extern "C" {
 #include "Hypertable/Lib/RangeServerMetaLogReader.h"
 #include "Hypertable/Lib/RangeServerMetaLogEntries.h"
 #include "Hypertable/Lib/RangeServerProtocol.h"
+#include "Hypertable/Lib/ScanBlock.h"
 
 #include "DfsBroker/Lib/Client.h"
 
@@ -50,6 +52,7 @@ extern "C" {
 #include "HandlerFactory.h"
 #include "MaintenanceQueue.h"
 #include "RangeServer.h"
+#include "ReplayDispatcher.h"
 #include "ScanContext.h"
 #include "MaintenanceTaskCompaction.h"
 #include "MaintenanceTaskLogCleanup.h"
@@ -68,21 +71,77 @@ namespace {
 /**
  * Constructor
  */
-RangeServer::RangeServer(PropertiesPtr &props_ptr, ConnectionManagerPtr &conn_manager_ptr, ApplicationQueuePtr &app_queue_ptr, Hyperspace::SessionPtr &hyperspace_ptr) : m_root_replay_finished(false), m_metadata_replay_finished(false), m_replay_finished(false), m_props_ptr(props_ptr), m_verbose(false), m_conn_manager_ptr(conn_manager_ptr), m_app_queue_ptr(app_queue_ptr), m_hyperspace_ptr(hyperspace_ptr), m_last_commit_log_clean(0), m_bytes_loaded(0) {
+RangeServer::RangeServer(PropertiesPtr &props_ptr, ConnectionManagerPtr &conn_manager_ptr, ApplicationQueuePtr &app_queue_ptr, Hyperspace::SessionPtr &hyperspace_ptr) : m_root_replay_finished(false), m_metadata_replay_finished(false), m_replay_finished(false), m_props_ptr(props_ptr), m_verbose(false), m_conn_manager_ptr(conn_manager_ptr), m_app_queue_ptr(app_queue_ptr), m_hyperspace_ptr(hyperspace_ptr), m_last_commit_log_clean(0), m_bytes_loaded(0), m_update_seq(0), m_update_apply_seq(0), m_last_memory_flush_scan(0), m_memory_flush_scan_in_progress(false) {
   uint16_t port;
   uint32_t maintenance_threads = 1;
+  int maintenance_io_limit, maintenance_cpu_limit;
   Comm *comm = conn_manager_ptr->get_comm();
 
   Global::range_max_bytes           = props_ptr->get_int64("Hypertable.RangeServer.Range.MaxBytes", 200000000LL);
   Global::access_group_max_files   = props_ptr->get_int("Hypertable.RangeServer.AccessGroup.MaxFiles", 10);
   Global::access_group_merge_files = props_ptr->get_int("Hypertable.RangeServer.AccessGroup.MergeFiles", 4);
   Global::access_group_max_mem  = props_ptr->get_int("Hypertable.RangeServer.AccessGroup.MaxMemory", 50000000);
+  Global::access_group_compaction_window = props_ptr->get_int("Hypertable.RangeServer.AccessGroup.CompactionWindow", 86400);
+  Global::cellstore_compression_threads = props_ptr->get_int("Hypertable.RangeServer.CellStore.CompressionThreads", 2);
+  Global::cellstore_version = (uint16_t)props_ptr->get_int("Hypertable.RangeServer.CellStore.Version", 1);
+  Global::cellstore_index_ttl = props_ptr->get_int("Hypertable.RangeServer.CellStore.IndexTtl", 0);
   maintenance_threads             = props_ptr->get_int("Hypertable.RangeServer.MaintenanceThreads", 1);
+  maintenance_io_limit            = props_ptr->get_int("Hypertable.RangeServer.Maintenance.IoLimit", 0);
+  maintenance_cpu_limit           = props_ptr->get_int("Hypertable.RangeServer.Maintenance.CpuLimit", 0);
   port                            = props_ptr->get_int("Hypertable.RangeServer.Port", DEFAULT_PORT);
   m_scanner_ttl                   = (time_t)props_ptr->get_int("Hypertable.RangeServer.Scanner.Ttl", 120);
+  m_scanner_max_block_size        = props_ptr->get_int("Hypertable.RangeServer.Scanner.MaxBlockSize", 4194304);
+
+  const char *scan_compression = props_ptr->get("Hypertable.RangeServer.Scanner.Compression", "quicklz");
+  int scan_compression_threshold = props_ptr->get_int("Hypertable.RangeServer.Scanner.CompressionThreshold", 4096);
+  m_scan_compressor = WireCompressor::create(scan_compression, scan_compression_threshold);
   m_timer_interval                = props_ptr->get_int("Hypertable.RangeServer.Timer.Interval", 60);
+  m_replay_threads                = props_ptr->get_int("Hypertable.RangeServer.ReplayThreads", System::get_processor_count());
+
+  if (m_replay_threads < 1)
+    m_replay_threads = 1;
   m_log_roll_limit                = props_ptr->get_int64("Hypertable.RangeServer.CommitLog.RollLimit", HYPERTABLE_RANGESERVER_COMMITLOG_ROLLLIMIT);
 
+  /**
+   * Server-wide cell cache memory budget.  Above the flush threshold the
+   * biggest caches get flushed, above the limit itself updates are throttled.
+   * Defaults to 40% of physical memory.
+   */
+  m_memory_limit = props_ptr->get_int64("Hypertable.RangeServer.MemoryLimit", 0);
+  if (m_memory_limit == 0) {
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0)
+      m_memory_limit = ((uint64_t)pages * (uint64_t)page_size * 2) / 5;
+    else
+      m_memory_limit = 1000000000LL;
+  }
+  int flush_threshold = props_ptr->get_int("Hypertable.RangeServer.MemoryLimit.FlushThreshold", 75);
+  int flush_target = props_ptr->get_int("Hypertable.RangeServer.MemoryLimit.FlushTarget", 50);
+  if (flush_threshold <= 0 || flush_threshold > 100) {
+    HT_WARNF("Bad value %d for Hypertable.RangeServer.MemoryLimit.FlushThreshold, using 75", flush_threshold);
+    flush_threshold = 75;
+  }
+  if (flush_target < 0 || flush_target >= flush_threshold) {
+    HT_WARNF("Bad value %d for Hypertable.RangeServer.MemoryLimit.FlushTarget, using %d", flush_target, (2*flush_threshold)/3);
+    flush_target = (2*flush_threshold)/3;
+  }
+  m_memory_flush_threshold = (m_memory_limit / 100) * flush_threshold;
+  m_memory_flush_target = (m_memory_limit / 100) * flush_target;
+  m_throttle_wait = props_ptr->get_int("Hypertable.RangeServer.MemoryLimit.ThrottleWait", 2000);
+
+  int interactive_weight = props_ptr->get_int("Hypertable.RangeServer.Requests.InteractiveWeight", 4);
+  m_app_queue_ptr->set_interactive_weight(interactive_weight);
+
+  /**
+   * Ranges whose update rate (cells/s) or read rate (scans/s) stays above
+   * these get split by load once they hold at least SplitMinBytes.  A rate
+   * of 0 disables the corresponding trigger.
+   */
+  m_split_update_rate = props_ptr->get_int("Hypertable.RangeServer.Range.SplitUpdateRate", 100000);
+  m_split_read_rate = props_ptr->get_int("Hypertable.RangeServer.Range.SplitReadRate", 2000);
+  m_split_min_bytes = props_ptr->get_int64("Hypertable.RangeServer.Range.SplitMinBytes", 10000000LL);
+
   if (m_timer_interval >= 1000) {
     HT_ERROR("Hypertable.RangeServer.Timer.Interval property too large, exiting ...");
     exit(1);
@@ -94,7 +153,10 @@ RangeServer::RangeServer(PropertiesPtr &props_ptr, ConnectionManagerPtr &conn_ma
   }
 
   uint64_t block_cacheMemory = props_ptr->get_int64("Hypertable.RangeServer.BlockCache.MaxMemory", 200000000LL);
-  Global::block_cache = new FileBlockCache(block_cacheMemory);
+  int block_cache_shards = props_ptr->get_int("Hypertable.RangeServer.BlockCache.Shards", FileBlockCache::DEFAULT_SHARDS);
+  if (block_cache_shards < 1)
+    block_cache_shards = 1;
+  Global::block_cache = new FileBlockCache(block_cacheMemory, block_cache_shards);
 
   assert(Global::access_group_merge_files <= Global::access_group_max_files);
 
@@ -104,9 +166,27 @@ RangeServer::RangeServer(PropertiesPtr &props_ptr, ConnectionManagerPtr &conn_ma
     cout << "Hypertable.RangeServer.AccessGroup.MaxFiles=" << Global::access_group_max_files << endl;
     cout << "Hypertable.RangeServer.AccessGroup.MaxMemory=" << Global::access_group_max_mem << endl;
     cout << "Hypertable.RangeServer.AccessGroup.MergeFiles=" << Global::access_group_merge_files << endl;
+    cout << "Hypertable.RangeServer.AccessGroup.CompactionWindow=" << Global::access_group_compaction_window << endl;
+    cout << "Hypertable.RangeServer.CellStore.CompressionThreads=" << Global::cellstore_compression_threads << endl;
+    cout << "Hypertable.RangeServer.CellStore.Version=" << Global::cellstore_version << endl;
+    cout << "Hypertable.RangeServer.CellStore.IndexTtl=" << Global::cellstore_index_ttl << endl;
     cout << "Hypertable.RangeServer.BlockCache.MaxMemory=" << block_cacheMemory << endl;
+    cout << "Hypertable.RangeServer.BlockCache.Shards=" << block_cache_shards << endl;
     cout << "Hypertable.RangeServer.Range.MaxBytes=" << Global::range_max_bytes << endl;
+    cout << "Hypertable.RangeServer.Range.SplitUpdateRate=" << m_split_update_rate << endl;
+    cout << "Hypertable.RangeServer.Range.SplitReadRate=" << m_split_read_rate << endl;
+    cout << "Hypertable.RangeServer.Range.SplitMinBytes=" << m_split_min_bytes << endl;
     cout << "Hypertable.RangeServer.MaintenanceThreads=" << maintenance_threads << endl;
+    cout << "Hypertable.RangeServer.Maintenance.IoLimit=" << maintenance_io_limit << endl;
+    cout << "Hypertable.RangeServer.Maintenance.CpuLimit=" << maintenance_cpu_limit << endl;
+    cout << "Hypertable.RangeServer.MemoryLimit=" << m_memory_limit << endl;
+    cout << "Hypertable.RangeServer.MemoryLimit.FlushThreshold=" << flush_threshold << endl;
+    cout << "Hypertable.RangeServer.MemoryLimit.FlushTarget=" << flush_target << endl;
+    cout << "Hypertable.RangeServer.Requests.InteractiveWeight=" << interactive_weight << endl;
+    cout << "Hypertable.RangeServer.MemoryLimit.ThrottleWait=" << m_throttle_wait << endl;
+    cout << "Hypertable.RangeServer.ReplayThreads=" << m_replay_threads << endl;
+    cout << "Hypertable.RangeServer.Scanner.Compression=" << scan_compression << endl;
+    cout << "Hypertable.RangeServer.Scanner.CompressionThreshold=" << scan_compression_threshold << endl;
     cout << "Hypertable.RangeServer.Port=" << port << endl;
     //cout << "Hypertable.RangeServer.workers=" << worker_count << endl;
   }
@@ -167,7 +247,7 @@ RangeServer::RangeServer(PropertiesPtr &props_ptr, ConnectionManagerPtr &conn_ma
   }
 
   // Create the maintenance queue
-  Global::maintenance_queue = new MaintenanceQueue(maintenance_threads);
+  Global::maintenance_queue = new MaintenanceQueue(maintenance_threads, maintenance_io_limit, maintenance_cpu_limit);
 
   // Create table info maps
   m_live_map_ptr = new TableInfoMap();
@@ -432,17 +512,23 @@ void RangeServer::local_recover() {
 
 
 
+/**
+ * Reads the commit log and replays every cell that belongs to a range in
+ * the replay map.  The log is read and inflated on this thread, while
+ * routed cells are applied by a ReplayDispatcher, which keeps each range on
+ * a single worker so cells reach a range in log order.
+ */
 void RangeServer::replay_log(CommitLogReaderPtr &log_reader_ptr) {
   BlockCompressionHeaderCommitLog header;
   uint8_t *base;
   size_t len;
   TableIdentifier table_id;
-  DynamicBuffer dbuf;
   const uint8_t *ptr, *end;
   int64_t timestamp;
   TableInfoPtr table_info_ptr;
   RangePtr range_ptr;
   ByteString key, value;
+  ReplayDispatcher dispatcher(m_replay_threads);
 
   while (log_reader_ptr->next((const uint8_t **)&base, &len, &header)) {
 
@@ -457,14 +543,6 @@ void RangeServer::replay_log(CommitLogReaderPtr &log_reader_ptr) {
     if (!m_replay_map_ptr->get(table_id.id, table_info_ptr))
       continue;
 
-    dbuf.ensure(table_id.encoded_length() + 12 + len);
-    dbuf.clear();
-
-    dbuf.ptr += 4;  // skip size
-    encode_i64(&dbuf.ptr, timestamp);
-    table_id.encode(&dbuf.ptr);
-    base = dbuf.ptr;
-
     while (ptr < end) {
 
       // extract the key
@@ -479,22 +557,15 @@ void RangeServer::replay_log(CommitLogReaderPtr &log_reader_ptr) {
       if (ptr > end)
 	HT_THROW(Error::REQUEST_TRUNCATED, "Problem decoding value");
 
-      // Look for containing range, add to stop mods if not found
+      // Look for containing range, skip the cell if not found
       if (!table_info_ptr->find_containing_range(key.str(), range_ptr))
 	continue;
 
-      // add key/value pair to buffer
-      memcpy(dbuf.ptr, key.ptr, ptr-key.ptr);
-      dbuf.ptr += ptr-key.ptr;
-
+      dispatcher.add(range_ptr.get(), key.ptr, ptr-key.ptr, timestamp);
     }
-
-    uint32_t block_size = dbuf.ptr - base;
-    base = dbuf.base;
-    encode_i32(&base, block_size);
-
-    replay_update(0, dbuf.base, dbuf.fill());
   }
+
+  dispatcher.finish();
 }
 
 
@@ -568,7 +639,7 @@ void RangeServer::compact(ResponseCallback *cb, TableIdentifier *table, RangeSpe
 /**
  *  CreateScanner
  */
-void RangeServer::create_scanner(ResponseCallbackCreateScanner *cb, TableIdentifier *table, RangeSpec *range, ScanSpec *scan_spec) {
+void RangeServer::create_scanner(ResponseCallbackCreateScanner *cb, TableIdentifier *table, RangeSpec *range, ScanSpec *scan_spec, uint32_t block_size, bool accept_compressed) {
   int error = Error::OK;
   String errmsg;
   TableInfoPtr table_info;
@@ -625,7 +696,12 @@ void RangeServer::create_scanner(ResponseCallbackCreateScanner *cb, TableIdentif
       throw Hypertable::Exception(Error::RANGESERVER_RANGE_NOT_FOUND,
                                   (String)"(b) " + table->name + "[" + range->start_row + ".." + range->end_row + "]");
 
-    more = FillScanBlock(scanner_ptr, rbuf);
+    if (!range_ptr->maintenance_in_progress() && is_hot(range_ptr)) {
+      if (!range_ptr->test_and_set_maintenance())
+        Global::maintenance_queue->add(new MaintenanceTaskSplit(range_ptr, true));
+    }
+
+    more = FillScanBlock(scanner_ptr, rbuf, scan_block_limit(block_size));
 
     id = (more) ? Global::scanner_map.put(scanner_ptr, range_ptr) : 0;
 
@@ -637,7 +713,9 @@ void RangeServer::create_scanner(ResponseCallbackCreateScanner *cb, TableIdentif
      *  Send back data
      */
     {
-      short moreflag = more ? 0 : 1;
+      short moreflag = more ? 0 : ScanBlock::FLAG_EOS;
+      if (accept_compressed)
+        compress_scan_block(rbuf, moreflag);
       StaticBuffer ext(rbuf);
       if ((error = cb->response(moreflag, id, ext)) != Error::OK) {
         HT_ERRORF("Problem sending OK response - %s", Error::get_text(error));
@@ -654,6 +732,38 @@ void RangeServer::create_scanner(ResponseCallbackCreateScanner *cb, TableIdentif
 }
 
 
+/**
+ * Returns the fill limit for a scan block of the size the client asked for.
+ * Zero means the client has no preference.  Requests are capped at
+ * Hypertable.RangeServer.Scanner.MaxBlockSize.
+ */
+size_t RangeServer::scan_block_limit(uint32_t requested_size) {
+  if (requested_size == 0)
+    return HYPERTABLE_DATA_TRANSFER_BLOCKSIZE;
+  return std::min(requested_size, m_scanner_max_block_size);
+}
+
+
+/**
+ * Replaces the data of a scan block filled by FillScanBlock with its
+ * compressed form, if Scanner.Compression is set, the block is at least
+ * Scanner.CompressionThreshold bytes and it gets smaller.
+ */
+void RangeServer::compress_scan_block(DynamicBuffer &rbuf, short &moreflag) {
+  DynamicBuffer zbuf;
+
+  if (!m_scan_compressor ||
+      !m_scan_compressor->compress(rbuf.base + 4, rbuf.fill() - 4, zbuf))
+    return;
+
+  rbuf.clear();
+  rbuf.reserve(zbuf.fill() + 4);
+  Serialization::encode_i32(&rbuf.ptr, zbuf.fill());
+  rbuf.add_unchecked(zbuf.base, zbuf.fill());
+  moreflag |= ScanBlock::FLAG_COMPRESSED;
+}
+
+
 void RangeServer::destroy_scanner(ResponseCallback *cb, uint32_t scanner_id) {
   HT_INFOF("destroying scanner id=%u", scanner_id);
   Global::scanner_map.remove(scanner_id);
@@ -661,7 +771,7 @@ void RangeServer::destroy_scanner(ResponseCallback *cb, uint32_t scanner_id) {
 }
 
 
-void RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb, uint32_t scanner_id) {
+void RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb, uint32_t scanner_id, uint32_t block_size, bool accept_compressed) {
   string errmsg;
   int error = Error::OK;
   CellListScannerPtr scanner_ptr;
@@ -675,14 +785,21 @@ void RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb, uint32_t s
   }
 
   if (!Global::scanner_map.get(scanner_id, scanner_ptr, range_ptr)) {
-    error = Error::RANGESERVER_INVALID_SCANNER_ID;
     char tbuf[32];
     sprintf(tbuf, "%d", scanner_id);
     errmsg = (string)tbuf;
-    goto abort;
+    /**
+     * Clients keep several fetches in flight, so the ones sent after the
+     * last block of a scan find the scanner gone.  That's expected and the
+     * client ignores them, so don't log it as an error.
+     */
+    HT_DEBUGF("fetch scanblock for unknown scanner id %u", scanner_id);
+    if ((error = cb->error(Error::RANGESERVER_INVALID_SCANNER_ID, errmsg)) != Error::OK)
+      HT_ERRORF("Problem sending error response - %s", Error::get_text(error));
+    return;
   }
 
-  more = FillScanBlock(scanner_ptr, rbuf);
+  more = FillScanBlock(scanner_ptr, rbuf, scan_block_limit(block_size));
 
   if (!more)
     Global::scanner_map.remove(scanner_id);
@@ -691,7 +808,9 @@ void RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb, uint32_t s
    *  Send back data
    */
   {
-    short moreflag = more ? 0 : 1;
+    short moreflag = more ? 0 : ScanBlock::FLAG_EOS;
+    if (accept_compressed)
+      compress_scan_block(rbuf, moreflag);
     StaticBuffer ext(rbuf);
 
     if ((error = cb->response(moreflag, scanner_id, ext)) != Error::OK) {
@@ -702,16 +821,6 @@ void RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb, uint32_t s
       HT_INFOF("Successfully fetched %d bytes of scan data", ext.size-4);
     }
   }
-
-  error = Error::OK;
-
- abort:
-  if (error != Error::OK) {
-    HT_ERRORF("%s '%s'", Error::get_text(error), errmsg.c_str());
-    if ((error = cb->error(error, errmsg)) != Error::OK) {
-      HT_ERRORF("Problem sending error response - %s", Error::get_text(error));
-    }
-  }
 }
 
 
@@ -936,6 +1045,8 @@ void RangeServer::update(ResponseCallbackUpdate *cb, TableIdentifier *table, Sta
   ByteString key, value;
   bool a_locked = false;
   bool b_locked = false;
+  bool sequenced = false;
+  uint64_t update_seq = 0;
   vector<SendBackRec> send_back_vector;
   const uint8_t *send_back_ptr = 0;
   uint32_t total_added = 0;
@@ -963,6 +1074,20 @@ void RangeServer::update(ResponseCallbackUpdate *cb, TableIdentifier *table, Sta
   if (!m_replay_finished)
     wait_for_recovery_finish();
 
+  /**
+   * Apply backpressure if the cell caches are over the memory limit and
+   * flushing hasn't caught up.  METADATA updates are never throttled since
+   * splits, which free up memory, depend on them.
+   */
+  if (table->id != 0 && !wait_for_memory()) {
+    errmsg = format("Cell cache memory (%llu bytes) over limit of %llu",
+                    (Llu)Global::memory_tracker.get_memory(), (Llu)m_memory_limit);
+    HT_WARNF("Throttling update to '%s' - %s", table->name, errmsg.c_str());
+    if ((error = cb->error(Error::RANGESERVER_THROTTLED, errmsg)) != Error::OK)
+      HT_ERRORF("Problem sending error response - %s", Error::get_text(error));
+    return;
+  }
+
   initial_timestamp = Global::user_log->get_timestamp();
 
   // TODO: Sanity check mod data (checksum validation)
@@ -1029,8 +1154,9 @@ void RangeServer::update(ResponseCallbackUpdate *cb, TableIdentifier *table, Sta
       /** Increment update count (block if maintenance in progress) **/
       rui.range_ptr->increment_update_counter();
 
-      // Make sure range didn't just shrink
-      if (strcmp(row, (rui.range_ptr->start_row()).c_str()) <= 0) {
+      // Make sure range didn't just shrink or get relinquished
+      if (strcmp(row, (rui.range_ptr->start_row()).c_str()) <= 0 ||
+          rui.range_ptr->is_relinquished()) {
         rui.range_ptr->decrement_update_counter();
         continue;
       }
@@ -1108,16 +1234,12 @@ void RangeServer::update(ResponseCallbackUpdate *cb, TableIdentifier *table, Sta
       rui.range_ptr = 0;
 
       if (split_extent.len > 0) {
-        DynamicBuffer dbuf(split_extent.len + table->encoded_length());
-
-        table->encode(&dbuf.ptr);
+        DynamicBuffer dbuf(0, false);
 
-	// compute items added
+        dbuf.base = (uint8_t *)split_extent.base;
+        dbuf.ptr = dbuf.base + split_extent.len;
 
-	memcpy(dbuf.ptr, split_extent.base, split_extent.len);
-	dbuf.ptr += split_extent.len;
-
-	if ((error = splitlog->write(dbuf, update_timestamp)) != Error::OK)
+	if ((error = splitlog->write(table, dbuf, update_timestamp)) != Error::OK)
 	  HT_THROW(error, (string)"Problem writing " + (int)dbuf.fill() + " bytes to split log");
 
 	memset(&split_extent, 0, sizeof(split_extent));
@@ -1138,56 +1260,47 @@ void RangeServer::update(ResponseCallbackUpdate *cb, TableIdentifier *table, Sta
       send_back_ptr = 0;
     }
 
-    m_update_mutex_b.lock();
-    b_locked = true;
+    /**
+     * Gather ROOT and valid (go) mutations into commit blocks and take a
+     * sequence number before releasing mutex a, so that updates get
+     * applied in the same order in which their timestamps were assigned
+     */
+    DynamicBuffer root_dbuf(rootsz);
+    for (size_t i=0; i<root_extents.size(); i++)
+      root_dbuf.add_unchecked(root_extents[i].base, root_extents[i].len);
+
+    DynamicBuffer go_dbuf(gosz);
+    for (size_t i=0; i<go_extents.size(); i++)
+      go_dbuf.add_unchecked(go_extents[i].base, go_extents[i].len);
+
+    update_seq = m_update_seq++;
+    sequenced = true;
 
     m_update_mutex_a.unlock();
     a_locked = false;
 
     /**
-     * Commit ROOT mutations
+     * Commit ROOT mutations.  No update lock is held here so concurrent
+     * updates get group committed into a single log write.
      */
     if (rootsz > 0) {
-      DynamicBuffer dbuf(rootsz + table->encoded_length());
-
-      table->encode(&dbuf.ptr);
-
-      // compute items added
-
-      for (size_t i=0; i<root_extents.size(); i++) {
-        memcpy(dbuf.ptr, root_extents[i].base, root_extents[i].len);
-        dbuf.ptr += root_extents[i].len;
-      }
-
-      HT_EXPECT(dbuf.fill() <= (rootsz + table->encoded_length()), Error::FAILED_EXPECTATION);
-
-      if ((error = Global::root_log->write(dbuf, initial_timestamp)) != Error::OK)
-	HT_THROW(error, (string)"Problem writing " + (int)dbuf.fill() + " bytes to ROOT commit log");
-
+      if ((error = Global::root_log->write(table, root_dbuf, initial_timestamp)) != Error::OK)
+	HT_THROW(error, (string)"Problem writing " + (int)root_dbuf.fill() + " bytes to ROOT commit log");
     }
 
     /**
      * Commit valid (go) mutations
      */
     if (gosz > 0) {
-      DynamicBuffer dbuf(gosz + table->encoded_length());
       CommitLog *log = (table->id == 0) ? Global::metadata_log : Global::user_log;
+      if ((error = log->write(table, go_dbuf, initial_timestamp)) != Error::OK)
+	HT_THROW(error, (string)"Problem writing " + (int)go_dbuf.fill() + " bytes to commit log (" + log->get_log_dir() + ")");
+    }
 
-      table->encode(&dbuf.ptr);
-
-      // compute items added
-
-      for (size_t i=0; i<go_extents.size(); i++) {
-        memcpy(dbuf.ptr, go_extents[i].base, go_extents[i].len);
-        dbuf.ptr += go_extents[i].len;
-      }
-
-      HT_EXPECT(dbuf.fill() <= (gosz + table->encoded_length()), Error::FAILED_EXPECTATION);
-
-      if ((error = log->write(dbuf, initial_timestamp)) != Error::OK)
-	HT_THROW(error, (string)"Problem writing " + (int)dbuf.fill() + " bytes to commit log (" + log->get_log_dir() + ")");
+    wait_for_update_turn(update_seq);
 
-    }
+    m_update_mutex_b.lock();
+    b_locked = true;
 
     for (size_t rangei=0; rangei<range_vector.size(); rangei++) {
 
@@ -1238,6 +1351,10 @@ void RangeServer::update(ResponseCallbackUpdate *cb, TableIdentifier *table, Sta
           if (!range_vector[rangei].range_ptr->test_and_set_maintenance())
             Global::maintenance_queue->add(new MaintenanceTaskSplit(range_vector[rangei].range_ptr));
         }
+        else if (is_hot(range_vector[rangei].range_ptr)) {
+          if (!range_vector[rangei].range_ptr->test_and_set_maintenance())
+            Global::maintenance_queue->add(new MaintenanceTaskSplit(range_vector[rangei].range_ptr, true));
+        }
         else if (!compactions.empty()) {
           if (!range_vector[rangei].range_ptr->test_and_set_maintenance()) {
             for (size_t i=0; i<compactions.size(); i++)
@@ -1259,10 +1376,15 @@ void RangeServer::update(ResponseCallbackUpdate *cb, TableIdentifier *table, Sta
     errmsg = e.what();
   }
 
-  if (b_locked)
-    m_update_mutex_b.unlock();
-  else if (a_locked)
+  if (a_locked)
     m_update_mutex_a.unlock();
+  else if (sequenced) {
+    if (b_locked)
+      m_update_mutex_b.unlock();
+    else
+      wait_for_update_turn(update_seq);
+    finish_update_turn();
+  }
 
   m_bytes_loaded += buffer.size;
 
@@ -1293,6 +1415,27 @@ void RangeServer::update(ResponseCallbackUpdate *cb, TableIdentifier *table, Sta
     if ((error = cb->error(error, errmsg)) != Error::OK)
       HT_ERRORF("Problem sending error response - %s", Error::get_text(error));
   }
+
+  if (Global::memory_tracker.get_memory() > m_memory_flush_threshold)
+    schedule_memory_flushes();
+}
+
+
+
+/**
+ * Blocks until all updates sequenced before seq have been applied
+ */
+void RangeServer::wait_for_update_turn(uint64_t seq) {
+  ScopedLock lock(m_update_apply_mutex);
+  while (m_update_apply_seq != seq)
+    m_update_apply_cond.wait(lock);
+}
+
+
+void RangeServer::finish_update_turn() {
+  ScopedLock lock(m_update_apply_mutex);
+  m_update_apply_seq++;
+  m_update_apply_cond.notify_all();
 }
 
 
@@ -1374,6 +1517,18 @@ void RangeServer::dump_stats(ResponseCallback *cb) {
     for (size_t i=0; i<range_vec.size(); i++)
       range_vec[i]->dump_stats();
   }
+
+  const char *class_names[] = { "ApplicationQueue(interactive)", "ApplicationQueue(bulk)" };
+  for (int pc=0; pc<ApplicationQueue::PRIORITY_CLASSES; pc++) {
+    ApplicationQueue::Stats qstats;
+    m_app_queue_ptr->get_stats(pc, qstats, true);
+    cout << "STAT\t" << class_names[pc] << "\tdepth\t" << qstats.depth << endl;
+    cout << "STAT\t" << class_names[pc] << "\tdequeued\t" << qstats.dequeued << endl;
+    cout << "STAT\t" << class_names[pc] << "\tavg wait usec\t" << (qstats.dequeued ? (qstats.total_wait / qstats.dequeued) / 1000 : 0) << endl;
+    cout << "STAT\t" << class_names[pc] << "\tmax wait usec\t" << qstats.max_wait / 1000 << endl;
+  }
+  cout << flush;
+
   cb->response_ok();
 }
 
@@ -1682,6 +1837,13 @@ void RangeServer::replay_commit(ResponseCallback *cb) {
 
 
 
+/**
+ * Relinquishes a range so that it can be loaded by another server.  The
+ * range is taken out of the live map, its cell caches are flushed to cell
+ * stores and a move-done entry is written to the range meta log, so that
+ * neither this server's commit log replay nor a later restart brings it
+ * back.
+ */
 void RangeServer::drop_range(ResponseCallback *cb, TableIdentifier *table, RangeSpec *range) {
   TableInfoPtr table_info_ptr;
   RangePtr range_ptr;
@@ -1693,18 +1855,39 @@ void RangeServer::drop_range(ResponseCallback *cb, TableIdentifier *table, Range
     cout << flush;
   }
 
+  if (!m_replay_finished)
+    wait_for_recovery_finish();
+
   /** Get TableInfo **/
   if (!m_live_map_ptr->get(table->id, table_info_ptr)) {
     cb->error(Error::RANGESERVER_RANGE_NOT_FOUND, String("No ranges loaded for table '") + table->name + "'");
     return;
   }
 
+  /** Don't pull the range out from under a split or compaction **/
+  if (!table_info_ptr->get_range(range, range_ptr)) {
+    cb->error(Error::RANGESERVER_RANGE_NOT_FOUND, (String)table->name + "[" + range->start_row + ".." + range->end_row + "]");
+    return;
+  }
+
+  if (range_ptr->test_and_set_maintenance()) {
+    cb->error(Error::RANGESERVER_RANGE_BUSY, (String)table->name + "[" + range->start_row + ".." + range->end_row + "]");
+    return;
+  }
+
   /** Remove the range **/
   if (!table_info_ptr->remove_range(range, range_ptr)) {
     cb->error(Error::RANGESERVER_RANGE_NOT_FOUND, (String)table->name + "[" + range->start_row + ".." + range->end_row + "]");
     return;
   }
 
+  range_ptr->relinquish();
+
+  if (Global::range_log)
+    Global::range_log->log_move_done(*table, *range);
+
+  HT_INFOF("Relinquished range %s[%s..%s]", table->name, range->start_row, range->end_row);
+
   cb->response_ok();
 }
 
@@ -1796,7 +1979,36 @@ void RangeServer::do_maintenance() {
     // schedule log cleanup
     Global::maintenance_queue->add(new MaintenanceTaskLogCleanup(this));
     m_last_commit_log_clean = tval.tv_sec;
+    Global::block_cache->log_statistics();
   }
+
+  /**
+   * Catch memory pressure that builds up without updates, e.g. from
+   * ranges that were loaded or replayed
+   */
+  if (Global::memory_tracker.get_memory() > m_memory_flush_threshold)
+    schedule_memory_flushes();
+
+  /**
+   * Free the block indexes of cell stores that have not been scanned
+   * lately
+   */
+  if (Global::cellstore_index_ttl > 0)
+    purge_store_indexes(tval.tv_sec - Global::cellstore_index_ttl);
+}
+
+
+void RangeServer::purge_store_indexes(time_t expire_time) {
+  std::vector<TableInfoPtr> table_vec;
+  std::vector<RangePtr> range_vec;
+
+  m_live_map_ptr->get_all(table_vec);
+
+  for (size_t i=0; i<table_vec.size(); i++)
+    table_vec[i]->get_range_vector(range_vec);
+
+  for (size_t i=0; i<range_vec.size(); i++)
+    range_vec[i]->purge_store_indexes(expire_time);
 }
 
 namespace {
@@ -1807,6 +2019,18 @@ namespace {
     }
   };
 
+  /**
+   * Orders access groups for memory pressure flushes, biggest cell
+   * cache first, ties broken by the age of the oldest cached update
+   */
+  struct LtMemoryPriorityData {
+    bool operator()(const AccessGroup::CompactionPriorityData &pd1, const AccessGroup::CompactionPriorityData &pd2) const {
+      if (pd1.mem_used != pd2.mem_used)
+        return pd1.mem_used > pd2.mem_used;
+      return pd1.oldest_cached_timestamp < pd2.oldest_cached_timestamp;
+    }
+  };
+
 
 }
 
@@ -1864,6 +2088,8 @@ void RangeServer::schedule_log_cleanup_compactions(std::vector<RangePtr> &range_
   std::vector<AccessGroup::CompactionPriorityData> priority_data_vec;
   LogFragmentPriorityMap log_frag_map;
   int64_t timestamp, oldest_cached_timestamp = 0;
+  std::vector<bool> scheduled(range_vec.size(), false);
+  std::vector<uint64_t> log_space_pinned(range_vec.size(), 0);
 
   // Load up a vector of compaction priority data
   for (size_t i=0; i<range_vec.size(); i++) {
@@ -1899,12 +2125,23 @@ void RangeServer::schedule_log_cleanup_compactions(std::vector<RangePtr> &range_
       if (priority_data_vec[i].mem_used > 0)
         priority_data_vec[i].ag->set_compaction_bit();
       size_t rangei = (size_t)priority_data_vec[i].user_data;
-      if (!range_vec[rangei]->test_and_set_maintenance()) {
-        Global::maintenance_queue->add(new MaintenanceTaskCompaction(range_vec[rangei], false));
+      if (scheduled[rangei] || !range_vec[rangei]->test_and_set_maintenance()) {
+        scheduled[rangei] = true;
+        if ((*map_iter).second.cumulative_size > log_space_pinned[rangei])
+          log_space_pinned[rangei] = (*map_iter).second.cumulative_size;
       }
     }
   }
 
+  /**
+   * Queue the compactions once all the compaction bits are set, ranked by
+   * the most log space any of the range's access groups is pinning
+   */
+  for (size_t i=0; i<range_vec.size(); i++) {
+    if (scheduled[i])
+      Global::maintenance_queue->add(new MaintenanceTaskCompaction(range_vec[i], false, log_space_pinned[i]));
+  }
+
   // Purge the commit log
   if (oldest_cached_timestamp != 0)
     log->purge(oldest_cached_timestamp);
@@ -1913,6 +2150,144 @@ void RangeServer::schedule_log_cleanup_compactions(std::vector<RangePtr> &range_
 
 
 
+/**
+ * Schedules cell cache flushes across all ranges when cell cache memory is
+ * over the flush threshold.  Flushes are chosen biggest first until the
+ * memory expected to remain, not counting ranges that already have
+ * maintenance in progress, is at or below the flush target.  At most one
+ * scan runs at a time and scans are at least a second apart.
+ */
+void RangeServer::schedule_memory_flushes() {
+  std::vector<TableInfoPtr> table_vec;
+  std::vector<RangePtr> range_vec;
+  std::vector<AccessGroup::CompactionPriorityData> priority_data_vec;
+  std::vector<AccessGroup::CompactionPriorityData> candidates;
+  std::vector<bool> scheduled;
+  uint64_t memory_used, projected, in_progress = 0;
+  size_t flush_count = 0;
+  struct timeval tval;
+  int64_t now;
+
+  gettimeofday(&tval, 0);
+  now = (int64_t)tval.tv_sec * 1000LL + tval.tv_usec / 1000;
+
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_memory_flush_scan_in_progress || now - m_last_memory_flush_scan < 1000)
+      return;
+    m_memory_flush_scan_in_progress = true;
+    m_last_memory_flush_scan = now;
+  }
+
+  try {
+
+    m_live_map_ptr->get_all(table_vec);
+    for (size_t i=0; i<table_vec.size(); i++)
+      table_vec[i]->get_range_vector(range_vec);
+
+    memory_used = Global::memory_tracker.get_memory();
+
+    for (size_t i=0; i<range_vec.size(); i++) {
+      priority_data_vec.clear();
+      range_vec[i]->get_compaction_priority_data(priority_data_vec);
+      for (size_t j=0; j<priority_data_vec.size(); j++) {
+        if (range_vec[i]->maintenance_in_progress())
+          in_progress += priority_data_vec[j].mem_used;
+        else if (!priority_data_vec[j].in_memory && priority_data_vec[j].mem_used > 0) {
+          priority_data_vec[j].user_data = (void *)i;
+          candidates.push_back(priority_data_vec[j]);
+        }
+      }
+    }
+
+    projected = (in_progress < memory_used) ? memory_used - in_progress : 0;
+
+    if (projected > m_memory_flush_target) {
+      LtMemoryPriorityData lt_memory;
+      sort(candidates.begin(), candidates.end(), lt_memory);
+      scheduled.resize(range_vec.size(), false);
+
+      /**
+       * Set the compaction bits before queueing any task, so that a
+       * range's single compaction picks up all of its chosen access groups
+       */
+      for (size_t i=0; i<candidates.size() && projected > m_memory_flush_target; i++) {
+        size_t rangei = (size_t)candidates[i].user_data;
+        if (!scheduled[rangei]) {
+          if (range_vec[rangei]->test_and_set_maintenance())
+            continue;
+          scheduled[rangei] = true;
+        }
+        candidates[i].ag->set_compaction_bit();
+        projected -= std::min(projected, candidates[i].mem_used);
+        flush_count++;
+      }
+
+      for (size_t i=0; i<scheduled.size(); i++) {
+        if (scheduled[i])
+          Global::maintenance_queue->add(new MaintenanceTaskCompaction(range_vec[i], false));
+      }
+    }
+
+    if (flush_count)
+      HT_INFOF("Memory pressure (%llu bytes cached, limit %llu), scheduled %d access group flushes",
+               (Llu)memory_used, (Llu)m_memory_limit, (int)flush_count);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+  }
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_memory_flush_scan_in_progress = false;
+}
+
+
+/**
+ * Waits for cell cache memory to drop to the memory limit, scheduling
+ * flushes if it is over.  Gives up after the throttle wait.
+ *
+ * @return true if memory is at or below the limit
+ */
+bool RangeServer::wait_for_memory() {
+  boost::xtime deadline;
+
+  if (Global::memory_tracker.get_memory() <= m_memory_limit)
+    return true;
+
+  schedule_memory_flushes();
+
+  boost::xtime_get(&deadline, boost::TIME_UTC);
+  deadline.sec += m_throttle_wait / 1000;
+  deadline.nsec += (m_throttle_wait % 1000) * 1000000;
+  if (deadline.nsec >= 1000000000) {
+    deadline.sec++;
+    deadline.nsec -= 1000000000;
+  }
+  return Global::memory_tracker.wait_for_memory(m_memory_limit, deadline);
+}
+
+
+/**
+ * Checks whether a range takes enough updates or scans to be split by load.
+ * The root range is never split and ranges under Range.SplitMinBytes are
+ * left alone, so that splitting cannot go on forever.
+ */
+bool RangeServer::is_hot(RangePtr &range_ptr) {
+  double update_rate, read_rate;
+
+  if (range_ptr->is_root())
+    return false;
+
+  range_ptr->get_load_rates(&update_rate, &read_rate);
+
+  if ((m_split_update_rate > 0 && update_rate > m_split_update_rate) ||
+      (m_split_read_rate > 0 && read_rate > m_split_read_rate))
+    return range_ptr->disk_usage() >= m_split_min_bytes;
+
+  return false;
+}
+
+
 /**
  */
 uint64_t RangeServer::get_timer_interval() {
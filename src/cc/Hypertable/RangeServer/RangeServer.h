@@ -39,6 +39,7 @@
 #include "Hypertable/Lib/MasterClient.h"
 #include "Hypertable/Lib/RangeState.h"
 #include "Hypertable/Lib/Types.h"
+#include "Hypertable/Lib/WireCompressor.h"
 
 #include "Global.h"
 #include "ResponseCallbackCreateScanner.h"
@@ -64,9 +65,11 @@ namespace Hypertable {
     void compact(ResponseCallback *, TableIdentifier *, RangeSpec *,
                  uint8_t compaction_type);
     void create_scanner(ResponseCallbackCreateScanner *, TableIdentifier *,
-                        RangeSpec *, ScanSpec *);
+                        RangeSpec *, ScanSpec *, uint32_t block_size,
+                        bool accept_compressed=false);
     void destroy_scanner(ResponseCallback *cb, uint32_t scanner_id);
-    void fetch_scanblock(ResponseCallbackFetchScanblock *, uint32_t scanner_id);
+    void fetch_scanblock(ResponseCallbackFetchScanblock *, uint32_t scanner_id,
+                         uint32_t block_size, bool accept_compressed=false);
     void load_range(ResponseCallback *, const TableIdentifier *, const RangeSpec *,
                     const char *transfer_log_dir, const RangeState *);
     void update(ResponseCallbackUpdate *, TableIdentifier *, StaticBuffer &);
@@ -104,6 +107,14 @@ namespace Hypertable {
     void replay_log(CommitLogReaderPtr &log_reader_ptr);
     void verify_schema(TableInfoPtr &, int generation);
     void schedule_log_cleanup_compactions(std::vector<RangePtr> &range_vec, CommitLog *log, uint64_t prune_threshold);
+    void wait_for_update_turn(uint64_t seq);
+    void finish_update_turn();
+    size_t scan_block_limit(uint32_t requested_size);
+    void compress_scan_block(DynamicBuffer &rbuf, short &moreflag);
+    void schedule_memory_flushes();
+    void purge_store_indexes(time_t expire_time);
+    bool wait_for_memory();
+    bool is_hot(RangePtr &range_ptr);
 
     Mutex                  m_mutex;
     boost::condition       m_root_replay_finished_cond;
@@ -114,6 +125,8 @@ namespace Hypertable {
     bool                   m_replay_finished;
     Mutex                  m_update_mutex_a;
     Mutex                  m_update_mutex_b;
+    Mutex                  m_update_apply_mutex;
+    boost::condition       m_update_apply_cond;
     PropertiesPtr          m_props_ptr;
     bool                   m_verbose;
     Comm                  *m_comm;
@@ -129,11 +142,25 @@ namespace Hypertable {
     MasterClientPtr        m_master_client_ptr;
     Hyperspace::SessionPtr m_hyperspace_ptr;
     time_t                 m_scanner_ttl;
+    uint32_t               m_scanner_max_block_size;
+    WireCompressorPtr      m_scan_compressor;
     long                   m_last_commit_log_clean;
     uint64_t               m_timer_interval;
+    int                    m_replay_threads;
     uint64_t               m_bytes_loaded;
     uint64_t               m_log_roll_limit;
+    uint64_t               m_update_seq;
+    uint64_t               m_update_apply_seq;
     int                    m_replay_group;
+    uint64_t               m_memory_limit;
+    int                    m_split_update_rate;
+    int                    m_split_read_rate;
+    uint64_t               m_split_min_bytes;
+    uint64_t               m_memory_flush_threshold;
+    uint64_t               m_memory_flush_target;
+    uint32_t               m_throttle_wait;
+    int64_t                m_last_memory_flush_scan;
+    bool                   m_memory_flush_scan_in_progress;
   };
 
   typedef intrusive_ptr<RangeServer> RangeServerPtr;
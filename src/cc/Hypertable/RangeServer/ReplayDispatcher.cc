@@ -0,0 +1,180 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cassert>
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "Global.h"
+#include "ReplayDispatcher.h"
+
+using namespace Hypertable;
+
+
+ReplayDispatcher::ReplayDispatcher(int worker_count) : m_finished(false) {
+  assert(worker_count > 0);
+  for (int i=0; i<worker_count; i++) {
+    m_workers.push_back(new WorkerState());
+    m_threads.create_thread(Worker(*m_workers.back()));
+  }
+}
+
+
+ReplayDispatcher::~ReplayDispatcher() {
+  if (!m_finished) {
+    try { finish(); }
+    catch (Exception &e) {
+      HT_ERROR_OUT << e << HT_END;
+    }
+  }
+  for (size_t i=0; i<m_workers.size(); i++) {
+    foreach(Batch *batch, m_workers[i]->queue)
+      delete batch;
+    delete m_workers[i]->batch;
+    delete m_workers[i];
+  }
+}
+
+
+void
+ReplayDispatcher::add(Range *range, const uint8_t *key, size_t len,
+                      int64_t timestamp) {
+  uint64_t hash = (uint64_t)(uintptr_t)range * 0x9e3779b97f4a7c15ULL;
+  WorkerState &state = *m_workers[(hash >> 32) % m_workers.size()];
+  Entry entry;
+
+  assert(!m_finished);
+
+  if (state.batch == 0)
+    state.batch = new Batch();
+
+  entry.range = range;
+  entry.timestamp = timestamp;
+  entry.offset = state.batch->buf.fill();
+  state.batch->buf.add(key, len);
+  state.batch->entries.push_back(entry);
+
+  if (state.batch->buf.fill() >= BATCH_SIZE)
+    enqueue(state);
+}
+
+
+void ReplayDispatcher::finish() {
+  uint64_t memory_added = 0;
+  uint64_t items_added = 0;
+  int error = Error::OK;
+  String error_msg;
+
+  if (m_finished)
+    return;
+
+  for (size_t i=0; i<m_workers.size(); i++) {
+    if (m_workers[i]->batch)
+      enqueue(*m_workers[i]);
+    boost::mutex::scoped_lock lock(m_workers[i]->mutex);
+    m_workers[i]->done = true;
+    m_workers[i]->cond.notify_all();
+  }
+
+  m_threads.join_all();
+  m_finished = true;
+
+  for (size_t i=0; i<m_workers.size(); i++) {
+    memory_added += m_workers[i]->memory_added;
+    items_added += m_workers[i]->items_added;
+    if (error == Error::OK && m_workers[i]->error != Error::OK) {
+      error = m_workers[i]->error;
+      error_msg = m_workers[i]->error_msg;
+    }
+  }
+
+  Global::memory_tracker.add_memory(memory_added);
+  Global::memory_tracker.add_items(items_added);
+
+  if (error != Error::OK)
+    HT_THROW(error, error_msg);
+}
+
+
+void ReplayDispatcher::enqueue(WorkerState &state) {
+  boost::mutex::scoped_lock lock(state.mutex);
+  while (state.queue.size() >= MAX_QUEUED_BATCHES)
+    state.cond.wait(lock);
+  state.queue.push_back(state.batch);
+  state.batch = 0;
+  state.cond.notify_all();
+}
+
+
+void ReplayDispatcher::Worker::operator()() {
+  Batch *batch;
+
+  while (true) {
+    {
+      boost::mutex::scoped_lock lock(m_state.mutex);
+      while (m_state.queue.empty() && !m_state.done)
+        m_state.cond.wait(lock);
+      if (m_state.queue.empty())
+        return;
+      batch = m_state.queue.front();
+      m_state.queue.pop_front();
+      m_state.cond.notify_all();
+    }
+
+    // after an error keep draining so the producer never blocks forever
+    if (m_state.error == Error::OK) {
+      try {
+        apply(batch);
+      }
+      catch (Exception &e) {
+        m_state.error = e.code();
+        m_state.error_msg = e.what();
+      }
+    }
+    delete batch;
+  }
+}
+
+
+void ReplayDispatcher::Worker::apply(Batch *batch) {
+  ByteString key, value;
+  uint32_t count;
+  int error;
+
+  foreach(const Entry &entry, batch->entries) {
+    key.ptr = batch->buf.base + entry.offset;
+    value.ptr = key.ptr + key.length();
+
+    if ((error = entry.range->replay_add(key, value, entry.timestamp, &count)) != Error::OK) {
+      m_state.error = error;
+      m_state.error_msg = format("Problem replaying key '%s' into range %s",
+                                 key.str(), entry.range->get_name().c_str());
+      return;
+    }
+
+    if (count) {
+      m_state.items_added += count;
+      m_state.memory_added += count * ((value.ptr + value.length()) - key.ptr);
+    }
+  }
+}
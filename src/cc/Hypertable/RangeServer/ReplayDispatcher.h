@@ -0,0 +1,121 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_REPLAYDISPATCHER_H
+#define HYPERTABLE_REPLAYDISPATCHER_H
+
+#include <deque>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "Common/ByteString.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Thread.h"
+
+#include "Range.h"
+
+namespace Hypertable {
+
+  /**
+   * Applies recovered commit log cells to their ranges on a pool of worker
+   * threads.  Each range is owned by exactly one worker, chosen by hashing
+   * the range, and each worker applies its cells in the order they were
+   * added.  Replay order within a range is therefore the same as log order,
+   * while different ranges are replayed in parallel.
+   *
+   * Cells are collected into per-worker batches and handed off when a batch
+   * fills up.  The number of queued batches per worker is bounded, so add()
+   * blocks if the workers fall behind.
+   */
+  class ReplayDispatcher : boost::noncopyable {
+  public:
+    enum { BATCH_SIZE = 256 * 1024, MAX_QUEUED_BATCHES = 8 };
+
+    ReplayDispatcher(int worker_count);
+    ~ReplayDispatcher();
+
+    /**
+     * Queues a key/value pair for replay into the given range.  The range
+     * must stay alive until finish() returns.
+     *
+     * @param range range that contains the key
+     * @param key serialized key, immediately followed by its value
+     * @param len total length of the key and value
+     * @param timestamp commit log block timestamp
+     */
+    void add(Range *range, const uint8_t *key, size_t len, int64_t timestamp);
+
+    /**
+     * Flushes the partial batches, waits for the workers to drain their
+     * queues and stops them.  Throws the first error hit by any worker.
+     */
+    void finish();
+
+  private:
+
+    struct Entry {
+      Range   *range;
+      int64_t  timestamp;
+      uint32_t offset;
+    };
+
+    struct Batch {
+      Batch() : buf(BATCH_SIZE) { }
+      DynamicBuffer      buf;
+      std::vector<Entry> entries;
+    };
+
+    struct WorkerState {
+      WorkerState() : batch(0), done(false), error(Error::OK),
+                      memory_added(0), items_added(0) { }
+      boost::mutex        mutex;
+      boost::condition    cond;
+      std::deque<Batch *> queue;
+      Batch              *batch;
+      bool                done;
+      int                 error;
+      String              error_msg;
+      uint64_t            memory_added;
+      uint64_t            items_added;
+    };
+
+    class Worker {
+    public:
+      Worker(WorkerState &state) : m_state(state) { }
+      void operator()();
+    private:
+      void apply(Batch *batch);
+      WorkerState &m_state;
+    };
+
+    void enqueue(WorkerState &state);
+
+    std::vector<WorkerState *> m_workers;
+    ThreadGroup                m_threads;
+    bool                       m_finished;
+  };
+
+}
+
+#endif // HYPERTABLE_REPLAYDISPATCHER_H
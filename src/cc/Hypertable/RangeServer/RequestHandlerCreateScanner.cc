@@ -32,6 +32,7 @@
 #include "RequestHandlerCreateScanner.h"
 
 using namespace Hypertable;
+using namespace Serialization;
 
 /**
  *
@@ -41,6 +42,8 @@ void RequestHandlerCreateScanner::run() {
   TableIdentifier table;
   RangeSpec range;
   ScanSpec scan_spec;
+  uint32_t block_size = 0;
+  bool accept_compressed = false;
   size_t remaining = m_event_ptr->message_len - 2;
   const uint8_t *p = m_event_ptr->message + 2;
 
@@ -49,7 +52,15 @@ void RequestHandlerCreateScanner::run() {
     range.decode(&p, &remaining);
     scan_spec.decode(&p, &remaining);
 
-    m_range_server->create_scanner(&cb, &table, &range, &scan_spec);
+    // older clients don't send a block size
+    if (remaining >= 4)
+      block_size = decode_i32(&p, &remaining);
+
+    // or whether they take compressed scan blocks
+    if (remaining >= 1)
+      accept_compressed = decode_bool(&p, &remaining);
+
+    m_range_server->create_scanner(&cb, &table, &range, &scan_spec, block_size, accept_compressed);
   }
   catch (Exception &e) {
     HT_ERROR_OUT << e << HT_END;
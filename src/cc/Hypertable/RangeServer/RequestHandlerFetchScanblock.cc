@@ -44,8 +44,18 @@ void RequestHandlerFetchScanblock::run() {
 
   try {
     uint32_t scanner_id = decode_i32(&msg, &remaining);
+    uint32_t block_size = 0;
+    bool accept_compressed = false;
 
-    m_range_server->fetch_scanblock(&cb, scanner_id);
+    // older clients don't send a block size
+    if (remaining >= 4)
+      block_size = decode_i32(&msg, &remaining);
+
+    // or whether they take compressed scan blocks
+    if (remaining >= 1)
+      accept_compressed = decode_bool(&msg, &remaining);
+
+    m_range_server->fetch_scanblock(&cb, scanner_id, block_size, accept_compressed);
   }
   catch (Exception &e) {
     HT_ERROR_OUT << e << HT_END;
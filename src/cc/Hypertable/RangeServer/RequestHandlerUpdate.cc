@@ -27,6 +27,7 @@
 #include "Common/Serialization.h"
 
 #include "Hypertable/Lib/Types.h"
+#include "Hypertable/Lib/WireCompressor.h"
 
 #include "RangeServer.h"
 #include "RequestHandlerUpdate.h"
@@ -42,9 +43,17 @@ void RequestHandlerUpdate::run() {
   size_t remaining = m_event_ptr->message_len - 2;
   const uint8_t *p = m_event_ptr->message + 2;
   StaticBuffer mods;
+  DynamicBuffer inflated;
 
   try {
     table.decode(&p, &remaining);
+
+    if (m_event_ptr->header->flags & Header::FLAGS_BIT_COMPRESSED) {
+      WireCompressor::decompress(p, remaining, inflated);
+      p = inflated.base;
+      remaining = inflated.fill();
+    }
+
     mods.base = (uint8_t *)p;
     mods.size = remaining;
     mods.own = false;
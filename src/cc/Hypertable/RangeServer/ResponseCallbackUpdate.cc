@@ -24,8 +24,14 @@
 
 using namespace Hypertable;
 
+/**
+ * Responses advertise that compressed update payloads are accepted.
+ * Clients never set this flag on requests, so a response from an older
+ * server, which echoes the request flags, doesn't carry it.
+ */
 int ResponseCallbackUpdate::response(StaticBuffer &ext) {
   m_header_builder.initialize_from_request(m_event_ptr->header);
+  m_header_builder.add_flag(Header::FLAGS_BIT_ACCEPTS_COMPRESSED);
   CommBufPtr cbp(new CommBuf(m_header_builder, 4, ext));
   cbp->append_i32(Error::OK);
   return m_comm->send_response(m_event_ptr->addr, cbp);
@@ -39,6 +39,9 @@ void ScanContext::initialize(int64_t ts, ScanSpec *ss, RangeSpec *range_, Schema
   Schema::ColumnFamily *cf;
   uint32_t max_versions = 0;
 
+  predicate_filter = 0;
+  snapshot_timestamp = (ts == 0) ? END_OF_TIME : ts;
+
   // set time interval
   if (ss) {
     interval.first = ss->time_interval.first;
@@ -119,12 +122,20 @@ void ScanContext::initialize(int64_t ts, ScanSpec *ss, RangeSpec *range_, Schema
     }
   }
 
+  single_row = false;
+
   /**
    * Create Start Key and End Key
    */
   if (spec) {
     if (!spec->row_intervals.empty()) {
 
+      if (spec->row_intervals.size() == 1 &&
+          spec->row_intervals[0].start_inclusive &&
+          spec->row_intervals[0].end_inclusive &&
+          !strcmp(spec->row_intervals[0].start, spec->row_intervals[0].end))
+        single_row = true;
+
       // start row
       start_row = spec->row_intervals[0].start;
       if (!spec->row_intervals[0].start_inclusive)
@@ -148,6 +159,10 @@ void ScanContext::initialize(int64_t ts, ScanSpec *ss, RangeSpec *range_, Schema
       std::string column_family_str;
       Schema::ColumnFamily *cf;
 
+      if (spec->cell_intervals.size() == 1 &&
+          !strcmp(spec->cell_intervals[0].start_row, spec->cell_intervals[0].end_row))
+        single_row = true;
+
       if (*spec->cell_intervals[0].start_column) {
 	const char *ptr = strchr(spec->cell_intervals[0].start_column, ':');
 	if (ptr == 0)
@@ -199,4 +214,6 @@ void ScanContext::initialize(int64_t ts, ScanSpec *ss, RangeSpec *range_, Schema
     end_row = Key::END_ROW_MARKER;
   }
 
+  if (spec && !spec->predicates.empty())
+    predicate_filter = new CellPredicateFilter(spec->predicates);
 }
@@ -34,6 +34,8 @@
 #include "Hypertable/Lib/ScanSpec.h"
 #include "Hypertable/Lib/Types.h"
 
+#include "CellPredicateFilter.h"
+
 namespace Hypertable {
 
   struct CellFilterInfo {
@@ -52,9 +54,12 @@ namespace Hypertable {
     RangeSpec *range;
     std::string start_row;
     std::string end_row;
+    bool single_row;
+    int64_t snapshot_timestamp;
     std::pair<int64_t, int64_t> interval;
     bool family_mask[256];
     CellFilterInfo family_info[256];
+    CellPredicateFilter *predicate_filter;
 
     /**
      * Constructor.
@@ -88,6 +93,10 @@ namespace Hypertable {
       initialize(ts, 0, 0, schema_ptr);
     }
 
+    ~ScanContext() {
+      delete predicate_filter;
+    }
+
   private:
 
     /**
@@ -96,7 +105,12 @@ namespace Hypertable {
      * up family_info entries for the column families that are included in the scan
      * which contains cell garbage collection info for each family (e.g. cutoff
      * timestamp and number of copies to keep).  Also sets up end_row to be the
-     * last possible key in spec->end_row.
+     * last possible key in spec->end_row and sets single_row if the scan is
+     * restricted to a single row (start_row then holds that row).
+     * snapshot_timestamp is set to ts (or END_OF_TIME if ts is zero); cells
+     * at or beyond it were added after the scan began and are not visible.
+     * If the scan spec has predicates, predicate_filter is set to a filter
+     * that evaluates them, otherwise it is 0.
      *
      * @param ts scan timestamp (point in time when scan began)
      * @param ss scan specification
@@ -0,0 +1,199 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Common/ByteString.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/System.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/Schema.h"
+#include "Hypertable/Lib/ScanSpec.h"
+
+#include "Hypertable/RangeServer/CellCache.h"
+#include "Hypertable/RangeServer/CellPredicateFilter.h"
+#include "Hypertable/RangeServer/MergeScanner.h"
+#include "Hypertable/RangeServer/ScanContext.h"
+
+using namespace Hypertable;
+using namespace std;
+
+#define NUM_ROWS 10
+
+namespace {
+
+  const char *schema_str =
+    "<Schema>\n"
+    "  <AccessGroup name=\"default\">\n"
+    "    <ColumnFamily>\n"
+    "      <Name>data</Name>\n"
+    "    </ColumnFamily>\n"
+    "  </AccessGroup>\n"
+    "</Schema>\n";
+
+  /**
+   * Returns whether a filter over the given predicate rejects the pattern
+   * with RANGESERVER_BAD_SCAN_SPEC
+   */
+  bool rejected(uint8_t type, const char *pattern) {
+    vector<CellPredicate> predicates;
+    predicates.push_back(CellPredicate(CellPredicate::VALUE_PREFIX, "ok"));
+    predicates.push_back(CellPredicate(type, pattern));
+    try {
+      CellPredicateFilter filter(predicates);
+    }
+    catch (Exception &e) {
+      return e.code() == Error::RANGESERVER_BAD_SCAN_SPEC;
+    }
+    return false;
+  }
+
+  bool filter_matches(uint8_t type, const char *pattern, const Key &key,
+                      const ByteString value) {
+    vector<CellPredicate> predicates;
+    predicates.push_back(CellPredicate(type, pattern));
+    CellPredicateFilter filter(predicates);
+    return filter.matches(key, value);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  SchemaPtr schema_ptr;
+  uint8_t cf_id;
+  Key key;
+  char row[32];
+
+  System::initialize(System::locate_install_dir(argv[0]));
+
+  schema_ptr = Schema::new_instance(schema_str, strlen(schema_str));
+  HT_EXPECT(schema_ptr->is_valid(), -1);
+  schema_ptr->assign_ids();
+  cf_id = (uint8_t)schema_ptr->get_column_family("data")->id;
+
+  /**
+   * Bad regular expressions and unknown types fail construction
+   */
+  HT_EXPECT(rejected(CellPredicate::VALUE_REGEX, "(unbalanced"), -1);
+  HT_EXPECT(rejected(CellPredicate::QUALIFIER_REGEX, "[z-a]"), -1);
+  HT_EXPECT(rejected(CellPredicate::ROW_REGEX, "*"), -1);
+  HT_EXPECT(rejected(99, "x"), -1);
+  HT_EXPECT(!rejected(CellPredicate::ROW_REGEX, "^row0[0-9]$"), -1);
+
+  /**
+   * Values are length prefixed and not NUL terminated; put bytes after
+   * the value that would change the result if they were looked at
+   */
+  {
+    ByteString bskey = create_key(FLAG_INSERT, "row01", cf_id, "qual", 1);
+    DynamicBuffer value_buf(0);
+    append_as_byte_string(value_buf, "abc", 3);
+    value_buf.add("defg", 5);
+    ByteString value(value_buf.base);
+
+    HT_EXPECT(key.load(bskey), -1);
+
+    HT_EXPECT(filter_matches(CellPredicate::VALUE_REGEX, "^abc$", key, value), -1);
+    HT_EXPECT(!filter_matches(CellPredicate::VALUE_REGEX, "abcd", key, value), -1);
+    HT_EXPECT(filter_matches(CellPredicate::VALUE_EQUALS, "abc", key, value), -1);
+    HT_EXPECT(!filter_matches(CellPredicate::VALUE_EQUALS, "abcd", key, value), -1);
+    HT_EXPECT(filter_matches(CellPredicate::VALUE_PREFIX, "ab", key, value), -1);
+    HT_EXPECT(!filter_matches(CellPredicate::VALUE_PREFIX, "abcd", key, value), -1);
+    HT_EXPECT(filter_matches(CellPredicate::QUALIFIER_PREFIX, "qu", key, value), -1);
+    HT_EXPECT(filter_matches(CellPredicate::QUALIFIER_REGEX, "^q.*l$", key, value), -1);
+    HT_EXPECT(!filter_matches(CellPredicate::ROW_REGEX, "^row02$", key, value), -1);
+
+    delete [] bskey.ptr;
+  }
+
+  /**
+   * Odd rows have no matching cell.  With a row limit of three, the scan
+   * must return every matching cell of the first three even rows; rows
+   * that were filtered out entirely must not count against the limit.
+   */
+  {
+    CellCachePtr cache = new CellCache();
+    DynamicBuffer keep_buf(0), skip_buf(0);
+    int64_t timestamp = 1;
+
+    append_as_byte_string(keep_buf, "keep");
+    append_as_byte_string(skip_buf, "skip");
+
+    cache->lock();
+    for (int i=0; i<NUM_ROWS; i++) {
+      sprintf(row, "row%02d", i);
+      ByteString bskey = create_key(FLAG_INSERT, row, cf_id, "a", timestamp++);
+      cache->add(bskey, ByteString(skip_buf.base), 0);
+      delete [] bskey.ptr;
+      if ((i % 2) == 0) {
+        bskey = create_key(FLAG_INSERT, row, cf_id, "b", timestamp++);
+        cache->add(bskey, ByteString(keep_buf.base), 0);
+        delete [] bskey.ptr;
+        bskey = create_key(FLAG_INSERT, row, cf_id, "c", timestamp++);
+        cache->add(bskey, ByteString(keep_buf.base), 0);
+        delete [] bskey.ptr;
+      }
+    }
+    cache->unlock();
+
+    ScanSpec scan_spec;
+    scan_spec.row_limit = 3;
+    scan_spec.predicates.push_back(CellPredicate(CellPredicate::VALUE_EQUALS, "keep"));
+
+    ScanContextPtr scan_ctx = new ScanContext(0, &scan_spec, 0, schema_ptr);
+    HT_EXPECT(scan_ctx->predicate_filter != 0, -1);
+
+    vector<string> cells;
+    {
+      MergeScanner mscanner(scan_ctx, false);
+      ByteString bskey, value;
+      mscanner.add_scanner(cache->create_scanner(scan_ctx));
+      while (mscanner.get(bskey, value)) {
+        HT_EXPECT(key.load(bskey), -1);
+        cells.push_back(string(key.row) + ":" + key.column_qualifier);
+        mscanner.forward();
+      }
+    }
+
+    const char *expected[] = { "row00:b", "row00:c", "row02:b", "row02:c",
+                               "row04:b", "row04:c" };
+    if (cells.size() != sizeof(expected)/sizeof(const char *)) {
+      HT_ERRORF("Expected 6 cells, got %d", (int)cells.size());
+      return 1;
+    }
+    for (size_t i=0; i<cells.size(); i++) {
+      if (cells[i] != expected[i]) {
+        HT_ERRORF("Expected cell %s, got %s", expected[i], cells[i].c_str());
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,151 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <string>
+
+extern "C" {
+#include <sys/types.h>
+#include <unistd.h>
+}
+
+#include <boost/thread/thread.hpp>
+
+#include "Common/ByteString.h"
+#include "Common/CharArena.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Logger.h"
+
+#include "Hypertable/RangeServer/CellSkipList.h"
+
+using namespace Hypertable;
+using namespace std;
+
+#define NUM_KEYS 50000
+
+namespace {
+
+  /**
+   * Walks the list without locking while another thread inserts into it,
+   * checking that keys always come back in order.
+   */
+  struct ConcurrentReader {
+    ConcurrentReader(CellSkipList &skip_list, volatile bool &done, bool &ok)
+      : m_skip_list(skip_list), m_done(done), m_ok(ok) { }
+    void operator()() {
+      while (!m_done) {
+        CellSkipList::Node *node = m_skip_list.first();
+        string last_key;
+        while (node) {
+          string key = node->key().str();
+          if (key <= last_key && last_key != "") {
+            m_ok = false;
+            return;
+          }
+          last_key = key;
+          node = CellSkipList::next(node);
+        }
+      }
+    }
+    CellSkipList &m_skip_list;
+    volatile bool &m_done;
+    bool &m_ok;
+  };
+
+}
+
+int main(int argc, char **argv) {
+  unsigned long seed = (unsigned long)getpid();
+  CharArena arena(4096);
+  CellSkipList skip_list(arena);
+  set<string> keys;
+  DynamicBuffer kbuf(0), vbuf(0);
+  char row[64];
+
+  for (int i=1; i<argc; i++) {
+    if (!strncmp(argv[i], "--seed=", 7))
+      seed = atoi(&argv[i][7]);
+  }
+
+  srandom(seed);
+
+  cout << "CellSkipList_test SEED = " << seed << endl;
+
+  volatile bool done = false;
+  bool reader_ok = true;
+  boost::thread reader((ConcurrentReader(skip_list, done, reader_ok)));
+
+  for (size_t i=0; i<NUM_KEYS; i++) {
+    // every so often insert a long key to exercise the big page path
+    if (i % 1000 == 0)
+      sprintf(row, "%08ld%s", random() % (NUM_KEYS*2),
+              string(40, 'x').c_str());
+    else
+      sprintf(row, "%08ld", random() % (NUM_KEYS*2));
+    kbuf.clear();
+    append_as_byte_string(kbuf, row);
+    vbuf.clear();
+    append_as_byte_string(vbuf, (i % 1000 == 0) ? string(8192, 'v').c_str() : row);
+    bool inserted = skip_list.insert(ByteString(kbuf.base), ByteString(vbuf.base)) != 0;
+    HT_EXPECT(inserted == keys.insert(row).second, -1);
+  }
+
+  done = true;
+  reader.join();
+  HT_EXPECT(reader_ok, -1);
+
+  HT_EXPECT(skip_list.size() == keys.size(), -1);
+
+  /**
+   * Walk the list and make sure it matches the set, in order, with values
+   * intact
+   */
+  CellSkipList::Node *node = skip_list.first();
+  for (set<string>::iterator iter = keys.begin(); iter != keys.end(); ++iter) {
+    HT_EXPECT(node != 0, -1);
+    HT_EXPECT(*iter == node->key().str(), -1);
+    const char *value = node->value().str();
+    HT_EXPECT(!strncmp(value, iter->c_str(), 8) || value[0] == 'v', -1);
+    node = CellSkipList::next(node);
+  }
+  HT_EXPECT(node == 0, -1);
+
+  /**
+   * Check lower_bound against the set
+   */
+  for (size_t i=0; i<1000; i++) {
+    sprintf(row, "%08ld", random() % (NUM_KEYS*2));
+    kbuf.clear();
+    append_as_byte_string(kbuf, row);
+    node = skip_list.lower_bound(ByteString(kbuf.base));
+    set<string>::iterator iter = keys.lower_bound(row);
+    if (iter == keys.end())
+      HT_EXPECT(node == 0, -1);
+    else
+      HT_EXPECT(node != 0 && *iter == node->key().str(), -1);
+  }
+
+  return 0;
+}
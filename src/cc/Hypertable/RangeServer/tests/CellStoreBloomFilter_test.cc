@@ -0,0 +1,163 @@
+/** -*- c++ -*-
+ * Copyright (C) 2008 Doug Judd (Zvents, Inc.)
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of the
+ * License.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include <cstdio>
+#include <cstdlib>
+
+#include "AsyncComm/Comm.h"
+#include "AsyncComm/ConnectionManager.h"
+#include "AsyncComm/ReactorFactory.h"
+
+#include "Common/Error.h"
+#include "Common/InetAddr.h"
+#include "Common/Logger.h"
+#include "Common/System.h"
+#include "Common/Usage.h"
+
+#include "Hypertable/Lib/Defaults.h"
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/ScanSpec.h"
+
+#include "DfsBroker/Lib/Client.h"
+
+#include "Hypertable/RangeServer/CellStoreV0.h"
+#include "Hypertable/RangeServer/ScanContext.h"
+
+using namespace Hypertable;
+
+#define NUM_ROWS 1000
+
+namespace {
+
+  const char *usage[] = {
+    "usage: CellStoreBloomFilter_test",
+    "",
+    "  Writes a CellStore with a row bloom filter through the DFS broker,",
+    "  reopens it and checks that single-row scans for absent rows skip it.",
+    "",
+    (const char *)0
+  };
+
+  /**
+   * Returns whether a single-row scan for row would read the store
+   */
+  bool scan_reads_store(CellStoreV0 *cellstore, const char *row) {
+    ScanSpec scan_spec;
+    RowInterval ri;
+    ri.start = ri.end = row;
+    ri.start_inclusive = ri.end_inclusive = true;
+    scan_spec.row_intervals.push_back(ri);
+    SchemaPtr schema_ptr;
+    ScanContextPtr scan_ctx = new ScanContext(0, &scan_spec, 0, schema_ptr);
+    HT_EXPECT(scan_ctx->single_row, -1);
+    return cellstore->may_contain(scan_ctx);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  ConnectionManagerPtr conn_manager_ptr;
+  DfsBroker::Client *dfs_client;
+  const char *fname = "/hypertable/test_cellstore/bloom";
+  DynamicBuffer value_buf(0);
+  Timestamp timestamp;
+  char row[32];
+  size_t false_positives = 0;
+
+  if (argc == 2 && !strcmp(argv[1], "--help"))
+    Usage::dump_and_exit(usage);
+
+  try {
+
+    System::initialize(System::locate_install_dir(argv[0]));
+    ReactorFactory::initialize(System::get_processor_count());
+
+    conn_manager_ptr = new ConnectionManager();
+
+    /**
+     * connect to DFS broker
+     */
+    {
+      struct sockaddr_in addr;
+      InetAddr::initialize(&addr, "localhost", HYPERTABLE_RANGESERVER_COMMITLOG_DFSBROKER_PORT);
+      dfs_client = new DfsBroker::Client(conn_manager_ptr, addr, 60);
+      if (!dfs_client->wait_for_connection(10)) {
+        HT_ERROR("Unable to connect to DFS Broker, exiting...");
+        exit(1);
+      }
+    }
+
+    dfs_client->mkdirs("/hypertable/test_cellstore");
+
+    append_as_byte_string(value_buf, "value");
+
+    /**
+     * Write the even rows
+     */
+    {
+      CellStoreV0 cellstore(dfs_client);
+
+      HT_EXPECT(cellstore.create(fname, 4096, "none", CellStore::BLOOM_FILTER_ROWS) == 0, -1);
+      for (size_t i=0; i<NUM_ROWS; i++) {
+        sprintf(row, "row%08d", (int)(2*i));
+        ByteString key = create_key(FLAG_INSERT, row, 1, "", (int64_t)i+1);
+        HT_EXPECT(cellstore.add(key, ByteString(value_buf.base), 0) == 0, -1);
+        delete [] key.ptr;
+      }
+      HT_EXPECT(cellstore.finalize(timestamp) == 0, -1);
+    }
+
+    /**
+     * Reopen the store; it must be found for every row it holds and
+     * skipped for (nearly) every row it doesn't
+     */
+    {
+      CellStoreV0 cellstore(dfs_client);
+
+      HT_EXPECT(cellstore.open(fname, 0, 0) == 0, -1);
+      HT_EXPECT(cellstore.load_index() == 0, -1);
+
+      for (size_t i=0; i<NUM_ROWS; i++) {
+        sprintf(row, "row%08d", (int)(2*i));
+        HT_EXPECT(scan_reads_store(&cellstore, row), -1);
+        sprintf(row, "row%08d", (int)(2*i+1));
+        if (scan_reads_store(&cellstore, row))
+          false_positives++;
+      }
+
+      HT_INFOF("%d of %d absent rows read the store", (int)false_positives, NUM_ROWS);
+      HT_EXPECT(false_positives < NUM_ROWS / 20, -1);
+    }
+
+    dfs_client->rmdir("/hypertable/test_cellstore");
+
+  }
+  catch (Hypertable::Exception &e) {
+    HT_ERRORF("%s - %s", e.what(), Error::get_text(e.code()));
+    ReactorFactory::destroy();
+    return 1;
+  }
+
+  ReactorFactory::destroy();
+  return 0;
+}
@@ -48,17 +48,6 @@ namespace {
     uint32_t file_offset;
     uint32_t length;
   };
-  struct LtBufferRecord {
-    bool operator()(const struct BufferRecord &br1,
-                    const struct BufferRecord &br2) const {
-      if (br1.file_id == br2.file_id) {
-	if (br1.file_offset == br2.file_offset)
-	  return br1.length < br2.length;
-	return br1.file_offset < br2.file_offset;
-      }
-      return br1.file_id < br2.file_id;
-    }
-  };
 }
 
 #define MAX_MEMORY 50000000
@@ -66,6 +55,12 @@ namespace {
 #define TARGET_BUFSIZE 65536
 #define MAX_FILE_ID 10
 #define MAX_FILE_OFFSET 100
+#define SCAN_BLOCK_SIZE 1000
+#define SCAN_CACHE_BLOCKS 20
+#define SCAN_HOT_BLOCKS 8
+#define PINNED_SHARDS 4
+#define PINNED_BLOCK_SIZE 400
+#define PINNED_BLOCKS 20
 
 int main(int argc, char **argv) {
   FileBlockCache *cache;
@@ -80,7 +75,6 @@ int main(int argc, char **argv) {
   uint8_t *block;
   uint32_t length;
   int index;
-  set<BufferRecord, LtBufferRecord> lru;
   
   System::initialize(System::locate_install_dir(argv[0]));
 
@@ -132,46 +126,100 @@ int main(int argc, char **argv) {
   }
 
   /**
-   * Now verify that our idea of LRU is actually in the cache
+   * The cache must stay within its memory limit and hold on to the block
+   * that was touched last
+   */
+  total_alloc = 0;
+  for (size_t i=0; i<input_data.size(); i++) {
+    if (cache->contains(input_data[i].file_id, input_data[i].file_offset))
+      total_alloc += input_data[i].length;
+  }
+  if (total_alloc > MAX_MEMORY) {
+    HT_ERRORF("cache holds %llu bytes, limit is %llu", (Llu)total_alloc,
+              (Llu)MAX_MEMORY);
+    return 1;
+  }
+  rec = history.front();
+  if (!cache->contains(rec.file_id, rec.file_offset)) {
+    HT_ERRORF("most recently used block missing (id=%d, offset=%u)",
+              rec.file_id, rec.file_offset);
+    return 1;
+  }
+
+  delete cache;
+
+  /**
+   * A one-pass scan must not evict blocks that have been read repeatedly
    */
-  total_alloc = 0; 
-  list<BufferRecord>::iterator history_iter = history.begin();
-  while (total_alloc < MAX_MEMORY) {
-    rec.file_id = (*history_iter).file_id;
-    rec.file_offset = (*history_iter).file_offset;
-    rec.length = (*history_iter).length;
-    if (lru.find(rec) == lru.end()) {
-      if (total_alloc + (*history_iter).length > MAX_MEMORY)
-	break;
-      lru.insert(rec);
-      total_alloc += rec.length;
-      if (!cache->contains(rec.file_id, rec.file_offset)) {
-	HT_ERRORF("computed LRU does not match cache's (id=%d, offset=%u)", rec.file_id, rec.file_offset);
-	return 1;
+  cache = new FileBlockCache(SCAN_BLOCK_SIZE * SCAN_CACHE_BLOCKS, 1);
+
+  for (int pass=0; pass<2; pass++) {
+    for (uint32_t i=0; i<SCAN_HOT_BLOCKS; i++) {
+      if (cache->checkout(0, i, &block, &length))
+        cache->checkin(0, i);
+      else {
+        block = new uint8_t [ SCAN_BLOCK_SIZE ];
+        HT_EXPECT(cache->insert_and_checkout(0, i, block, SCAN_BLOCK_SIZE),
+                  Error::FAILED_EXPECTATION);
+        cache->checkin(0, i);
       }
     }
-    history_iter++;
   }
 
+  for (uint32_t i=0; i<SCAN_CACHE_BLOCKS*10; i++) {
+    block = new uint8_t [ SCAN_BLOCK_SIZE ];
+    HT_EXPECT(cache->insert_and_checkout(1, i, block, SCAN_BLOCK_SIZE),
+              Error::FAILED_EXPECTATION);
+    cache->checkin(1, i);
+  }
+
+  for (uint32_t i=0; i<SCAN_HOT_BLOCKS; i++) {
+    if (!cache->contains(0, i)) {
+      HT_ERRORF("hot block %u evicted by scan", i);
+      return 1;
+    }
+  }
+
+  std::vector<FileBlockCache::Statistics> stats;
+  cache->get_statistics(stats);
+  HT_EXPECT(stats.size() == 1, Error::FAILED_EXPECTATION);
+  HT_EXPECT(stats[0].hits == SCAN_HOT_BLOCKS, Error::FAILED_EXPECTATION);
+  HT_EXPECT(stats[0].inserts == SCAN_HOT_BLOCKS + SCAN_CACHE_BLOCKS*10,
+            Error::FAILED_EXPECTATION);
+
+  delete cache;
+
   /**
-   * Now verify that all of the remaining items that
-   * should *not* be in our LRU are, indeed, not in the cache
+   * With more bytes checked out than the shards hold, inserts into full
+   * shards must fail cleanly (scanners then keep the block privately),
+   * and the cache must take blocks again once they are checked in
    */
-  if (cache->contains(rec.file_id, rec.file_offset)) {
-    HT_ERROR("computed LRU does not match cache's");
-    return 1;
-  }
-  while (history_iter != history.end()) {
-    rec.file_id = (*history_iter).file_id;
-    rec.file_offset = (*history_iter).file_offset;
-    rec.length = (*history_iter).length;
-    if (lru.find(rec) == lru.end()) {
-      if (cache->contains(rec.file_id, rec.file_offset)) {
-	HT_ERROR("computed LRU does not match cache's");
-	return 1;
-      }
+  cache = new FileBlockCache(PINNED_SHARDS * PINNED_BLOCK_SIZE * 2,
+                             PINNED_SHARDS);
+  vector<uint32_t> pinned;
+  size_t refused = 0;
+
+  for (uint32_t i=0; i<PINNED_BLOCKS; i++) {
+    block = new uint8_t [ PINNED_BLOCK_SIZE ];
+    if (cache->insert_and_checkout(2, i, block, PINNED_BLOCK_SIZE))
+      pinned.push_back(i);
+    else {
+      delete [] block;
+      refused++;
     }
-    history_iter++;
+  }
+  HT_EXPECT(refused > 0, Error::FAILED_EXPECTATION);
+  HT_EXPECT(pinned.size() * PINNED_BLOCK_SIZE <= PINNED_SHARDS * PINNED_BLOCK_SIZE * 2,
+            Error::FAILED_EXPECTATION);
+
+  for (size_t i=0; i<pinned.size(); i++)
+    cache->checkin(2, pinned[i]);
+
+  for (uint32_t i=0; i<PINNED_BLOCKS; i++) {
+    block = new uint8_t [ PINNED_BLOCK_SIZE ];
+    HT_EXPECT(cache->insert_and_checkout(3, i, block, PINNED_BLOCK_SIZE),
+              Error::FAILED_EXPECTATION);
+    cache->checkin(3, i);
   }
 
   delete cache;
@@ -257,6 +257,10 @@ void RangeServerCommandInterpreter::execute_line(const String &line) {
       scan_spec.time_interval.second = state.scan.end_time;
       scan_spec.return_deletes = state.scan.return_deletes;
 
+      for (size_t i=0; i<state.scan.predicates.size(); i++)
+        scan_spec.predicates.push_back(CellPredicate(state.scan.predicates[i].first,
+            state.scan.predicates[i].second.c_str()));
+
       /**
        */
       m_range_server_ptr->create_scanner(m_addr, *table, range, scan_spec, scanblock);